@@ -0,0 +1,140 @@
+#include "./generate.h"
+
+#include "../include/util/file.h"
+#include "../include/util/integer.h"
+#include "../include/util/memory.h"
+#include "../include/util/guard.h"
+#include "../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+
+/**
+ * The size of the buffer generated lines are written through.
+ */
+#define BENCH_GENERATE_BUFFER_CAPACITY (1024 * 1024)
+
+static int nextBenchValue(enum BenchDistribution distribution, uint64_t *statePtr);
+static uint64_t splitMix64(uint64_t *statePtr);
+
+/**
+ * Get the name of the given distribution, as accepted by tryParseBenchDistribution.
+ *
+ * @param distribution The distribution.
+ *
+ * @returns The name.
+ */
+char const *benchDistributionName(enum BenchDistribution const distribution) {
+    switch (distribution) {
+        case BENCH_DISTRIBUTION_MIXED:
+            return "mixed";
+        case BENCH_DISTRIBUTION_ODD:
+            return "odd";
+        case BENCH_DISTRIBUTION_EVEN:
+            return "even";
+        case BENCH_DISTRIBUTION_NARROW:
+            return "narrow";
+        case BENCH_DISTRIBUTION_WIDE:
+            return "wide";
+        case BENCH_DISTRIBUTION_NEGATIVE:
+            return "negative";
+        default:
+            abortWithErrorFmt("benchDistributionName: Unknown distribution: %d", (int)distribution);
+            return "";
+    }
+}
+
+/**
+ * Find the distribution with the given name.
+ *
+ * @param name The name (see benchDistributionName).
+ * @param distributionOutPtr Where to write the distribution.
+ *
+ * @returns Whether a distribution has that name.
+ */
+bool tryParseBenchDistribution(char const * const name, enum BenchDistribution * const distributionOutPtr) {
+    guardNotNull(name, "name", "tryParseBenchDistribution");
+    guardNotNull(distributionOutPtr, "distributionOutPtr", "tryParseBenchDistribution");
+
+    for (int distributionIndex = 0; distributionIndex < BENCH_DISTRIBUTION_COUNT; distributionIndex += 1) {
+        enum BenchDistribution const distribution = (enum BenchDistribution)distributionIndex;
+        if (strcmp(name, benchDistributionName(distribution)) == 0) {
+            *distributionOutPtr = distribution;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Write an HW4 input of about `length` bytes, one value per line, drawn from the given distribution. The same
+ * distribution, length, and seed always produce the same bytes, so inputs can be regenerated rather than stored. The
+ * input is streamed through a fixed buffer, so any length (tens of GB included) takes constant memory.
+ *
+ * @param outFileDescriptor The file descriptor to write to.
+ * @param distribution The value distribution.
+ * @param length The input length. Lines are written until at least this many bytes have been written.
+ * @param seed The seed of the pseudo-random value sequence.
+ *
+ * @returns The number of values written.
+ */
+unsigned long long generateBenchInput(
+    int const outFileDescriptor,
+    enum BenchDistribution const distribution,
+    unsigned long long const length,
+    unsigned long long const seed
+) {
+    char * const buffer = safeMalloc(BENCH_GENERATE_BUFFER_CAPACITY, "generateBenchInput");
+    size_t bufferLength = 0;
+    unsigned long long writtenLength = 0;
+    unsigned long long valueCount = 0;
+    uint64_t state = seed;
+    while (writtenLength + bufferLength < length) {
+        if (BENCH_GENERATE_BUFFER_CAPACITY - bufferLength < INTEGER_LINE_MAX_LENGTH) {
+            safeWrite(outFileDescriptor, buffer, bufferLength, "generateBenchInput");
+            writtenLength += bufferLength;
+            bufferLength = 0;
+        }
+        bufferLength += formatIntegerLine(nextBenchValue(distribution, &state), buffer + bufferLength);
+        valueCount += 1;
+    }
+    safeWrite(outFileDescriptor, buffer, bufferLength, "generateBenchInput");
+    free(buffer);
+    return valueCount;
+}
+
+static int nextBenchValue(enum BenchDistribution const distribution, uint64_t * const statePtr) {
+    uint64_t const random = splitMix64(statePtr);
+    int const nonNegative = (int)(random >> 33);
+    switch (distribution) {
+        case BENCH_DISTRIBUTION_MIXED:
+            return nonNegative;
+        case BENCH_DISTRIBUTION_ODD:
+            return nonNegative | 1;
+        case BENCH_DISTRIBUTION_EVEN:
+            return nonNegative & ~1;
+        case BENCH_DISTRIBUTION_NARROW:
+            return (int)(random % 100);
+        case BENCH_DISTRIBUTION_WIDE:
+            return 1000000000 + (int)(random % ((uint64_t)INT_MAX - 1000000000 + 1));
+        case BENCH_DISTRIBUTION_NEGATIVE:
+            return -1 - nonNegative;
+        default:
+            abortWithErrorFmt("nextBenchValue: Unknown distribution: %d", (int)distribution);
+            return 0;
+    }
+}
+
+/**
+ * Advance the SplitMix64 generator: small, fast, and the same on every platform.
+ */
+static uint64_t splitMix64(uint64_t * const statePtr) {
+    *statePtr += 0x9E3779B97F4A7C15ULL;
+    uint64_t mixed = *statePtr;
+    mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBULL;
+    return mixed ^ (mixed >> 31);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * The value distributions of generated benchmark inputs.
+ */
+enum BenchDistribution {
+    /** Uniform non-negative values, about half odd and half even, mostly 9 or 10 digits. */
+    BENCH_DISTRIBUTION_MIXED,
+    /** Like BENCH_DISTRIBUTION_MIXED, but all odd, so each value is written once. */
+    BENCH_DISTRIBUTION_ODD,
+    /** Like BENCH_DISTRIBUTION_MIXED, but all even, so each value is written twice. */
+    BENCH_DISTRIBUTION_EVEN,
+    /** Uniform values from 0 to 99: short lines, so per-value costs dominate. */
+    BENCH_DISTRIBUTION_NARROW,
+    /** Uniform values from 1000000000 to INT_MAX: always 10 digits. */
+    BENCH_DISTRIBUTION_WIDE,
+    /** Uniform negative values down to INT_MIN. */
+    BENCH_DISTRIBUTION_NEGATIVE
+};
+
+#define BENCH_DISTRIBUTION_COUNT 6
+
+char const *benchDistributionName(enum BenchDistribution distribution);
+bool tryParseBenchDistribution(char const *name, enum BenchDistribution *distributionOutPtr);
+unsigned long long generateBenchInput(
+    int outFileDescriptor,
+    enum BenchDistribution distribution,
+    unsigned long long length,
+    unsigned long long seed
+);
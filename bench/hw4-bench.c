@@ -0,0 +1,458 @@
+/*
+ * Time CSCI 451 HW4 end to end on generated inputs.
+ */
+
+#define _GNU_SOURCE
+
+#include "./generate.h"
+
+#include "../include/hw4.h"
+#include "../include/hw4/options.h"
+#include "../include/util/file.h"
+#include "../include/util/string.h"
+#include "../include/util/memory.h"
+#include "../include/util/guard.h"
+#include "../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+/**
+ * The seed of every generated input, so inputs, and hence results, are comparable between runs.
+ */
+#define BENCH_SEED 451ULL
+
+#define BENCH_MILLION 1000000
+#define BENCH_NANOSECONDS_PER_SECOND 1000000000
+#define BENCH_MAX_THREAD_COUNT 1024
+
+struct BenchArguments {
+    unsigned long long length;
+    unsigned int repeatCount;
+    char const *dataDirectoryPath;
+    char const *revision;
+    char const *resultsFilePath;
+    char const *baselineFilePath;
+    /** The options hw4 is run with; only the mode, thread count, formats, and I/O engine can be set. */
+    struct Hw4Options options;
+};
+
+/**
+ * The options a result was measured with, as written to its results file columns.
+ */
+struct BenchConfiguration {
+    char const *modeName;
+    size_t threadCount;
+    char const *formatName;
+    char const *ioEngineName;
+};
+
+static bool tryParseBenchArguments(int argc, char **argv, struct BenchArguments *argumentsOutPtr);
+static struct BenchConfiguration getBenchConfiguration(struct Hw4Options const *options);
+static char *prepareBenchInput(
+    struct BenchArguments const *argumentsPtr,
+    enum BenchDistribution distribution,
+    unsigned long long *valueCountOutPtr
+);
+static char *prepareBenchTextInput(
+    struct BenchArguments const *argumentsPtr,
+    enum BenchDistribution distribution,
+    unsigned long long *valueCountOutPtr
+);
+static unsigned long long countLines(char const *filePath);
+static double timeHw4(char const *inFilePath, char const *outFilePath, struct Hw4Options const *options);
+static double getMonotonicSeconds(void);
+static bool tryFindBaselineSeconds(
+    char *baseline,
+    char const *distributionName,
+    unsigned long long length,
+    struct BenchConfiguration const *configurationPtr,
+    double *secondsOutPtr
+);
+
+int main(int const argc, char ** const argv) {
+    struct BenchArguments arguments;
+    if (!tryParseBenchArguments(argc, argv, &arguments)) {
+        safeFprintf(
+            stderr,
+            "main",
+            "Usage: %s [--size BYTES] [--repeat COUNT] [--data DIRECTORY] [--revision NAME] [--results FILE]\n"
+                "       [--baseline FILE] [--mode MODE] [--threads N] [--format FORMAT] [--io-uring]\n"
+                "Time hw4 on a generated input of each value distribution, reusing inputs already in DIRECTORY.\n"
+                "Each distribution is run COUNT times and the fastest run is reported. Results are appended to FILE\n"
+                "as tab-separated revision, distribution, bytes, values, seconds, mode, threads, format, and I/O\n"
+                "engine; a results file from an earlier revision can be given as the baseline to compare against,\n"
+                "using its results for the same configuration.\n"
+                "hw4 runs in MODE (pipeline, parallel, pwrite, or passthrough) on N threads (0 meaning one per\n"
+                "online CPU), reading and writing FORMAT (text, binary, or varint; BYTES is the size of the text\n"
+                "input, which is converted for the others), optionally through io_uring.\n",
+            argv[0]
+        );
+        return EXIT_FAILURE;
+    }
+
+    char *baseline = NULL;
+    if (arguments.baselineFilePath != NULL) {
+        int const baselineFileDescriptor = safeOpen(arguments.baselineFilePath, O_RDONLY, "main");
+        size_t baselineLength;
+        baseline = safeReadAll(baselineFileDescriptor, &baselineLength, "main");
+        safeClose(baselineFileDescriptor, "main");
+    }
+    FILE * const resultsFile = arguments.resultsFilePath == NULL ? NULL : fopen(arguments.resultsFilePath, "a");
+    if (arguments.resultsFilePath != NULL && resultsFile == NULL) {
+        int const openErrorCode = errno;
+        char const * const openErrorMessage = strerror(openErrorCode);
+        abortWithErrorFmt(
+            "main: Failed to open results file \"%s\" (error code: %d; error message: \"%s\")",
+            arguments.resultsFilePath,
+            openErrorCode,
+            openErrorMessage
+        );
+    }
+
+    char * const outFilePath = formatString("%s/bench.out", arguments.dataDirectoryPath);
+    struct BenchConfiguration const configuration = getBenchConfiguration(&arguments.options);
+    safeFprintf(
+        stdout,
+        "main",
+        "mode %s, %zu threads, %s format, %s I/O\n",
+        configuration.modeName,
+        configuration.threadCount,
+        configuration.formatName,
+        configuration.ioEngineName
+    );
+    safeFprintf(
+        stdout,
+        "main",
+        "%-9s %10s %10s %10s %12s %9s\n",
+        "input",
+        "MB",
+        "seconds",
+        "MB/s",
+        "Mvalues/s",
+        "baseline"
+    );
+    for (int distributionIndex = 0; distributionIndex < BENCH_DISTRIBUTION_COUNT; distributionIndex += 1) {
+        enum BenchDistribution const distribution = (enum BenchDistribution)distributionIndex;
+        char const * const distributionName = benchDistributionName(distribution);
+
+        unsigned long long valueCount;
+        char * const inFilePath = prepareBenchInput(&arguments, distribution, &valueCount);
+
+        double bestSeconds = timeHw4(inFilePath, outFilePath, &arguments.options);
+        for (unsigned int repeatIndex = 1; repeatIndex < arguments.repeatCount; repeatIndex += 1) {
+            double const seconds = timeHw4(inFilePath, outFilePath, &arguments.options);
+            if (seconds < bestSeconds) {
+                bestSeconds = seconds;
+            }
+        }
+
+        double const megabytes = (double)arguments.length / (double)BENCH_MILLION;
+        char baselineText[32] = "-";
+        double baselineSeconds;
+        if (
+            baseline != NULL
+            && tryFindBaselineSeconds(baseline, distributionName, arguments.length, &configuration, &baselineSeconds)
+        ) {
+            safeSnprintf(baselineText, sizeof baselineText, "main", "%.2fx", baselineSeconds / bestSeconds);
+        }
+        safeFprintf(
+            stdout,
+            "main",
+            "%-9s %10.1f %10.3f %10.1f %12.2f %9s\n",
+            distributionName,
+            megabytes,
+            bestSeconds,
+            megabytes / bestSeconds,
+            (double)valueCount / (double)BENCH_MILLION / bestSeconds,
+            baselineText
+        );
+        fflush(stdout);
+        if (resultsFile != NULL) {
+            safeFprintf(
+                resultsFile,
+                "main",
+                "%s\t%s\t%llu\t%llu\t%.6f\t%s\t%zu\t%s\t%s\n",
+                arguments.revision,
+                distributionName,
+                arguments.length,
+                valueCount,
+                bestSeconds,
+                configuration.modeName,
+                configuration.threadCount,
+                configuration.formatName,
+                configuration.ioEngineName
+            );
+        }
+        free(inFilePath);
+    }
+
+    unlink(outFilePath);
+    free(outFilePath);
+    if (resultsFile != NULL) {
+        guardFmt(fclose(resultsFile) == 0, "main: Failed to close results file \"%s\"", arguments.resultsFilePath);
+    }
+    free(baseline);
+    return EXIT_SUCCESS;
+}
+
+static bool tryParseBenchArguments(int const argc, char ** const argv, struct BenchArguments * const argumentsOutPtr) {
+    argumentsOutPtr->length = 256ULL * 1024 * 1024;
+    argumentsOutPtr->repeatCount = 3;
+    argumentsOutPtr->dataDirectoryPath = "bench/data";
+    argumentsOutPtr->revision = "unknown";
+    argumentsOutPtr->resultsFilePath = NULL;
+    argumentsOutPtr->baselineFilePath = NULL;
+    argumentsOutPtr->options = hw4DefaultOptions();
+
+    for (int argIndex = 1; argIndex < argc; argIndex += 2) {
+        char const * const name = argv[argIndex];
+        if (strcmp(name, "--io-uring") == 0) {
+            argumentsOutPtr->options.ioEngine = HW4_IO_ENGINE_IO_URING;
+            argIndex -= 1;
+            continue;
+        }
+
+        if (argIndex + 1 == argc) {
+            return false;
+        }
+        char * const value = argv[argIndex + 1];
+        if (strcmp(name, "--size") == 0) {
+            argumentsOutPtr->length = strtoull(value, NULL, 10);
+            if (argumentsOutPtr->length == 0) {
+                return false;
+            }
+        } else if (strcmp(name, "--repeat") == 0) {
+            unsigned long const repeatCount = strtoul(value, NULL, 10);
+            if (repeatCount == 0 || repeatCount > 1000) {
+                return false;
+            }
+            argumentsOutPtr->repeatCount = (unsigned int)repeatCount;
+        } else if (strcmp(name, "--data") == 0) {
+            argumentsOutPtr->dataDirectoryPath = value;
+        } else if (strcmp(name, "--revision") == 0) {
+            argumentsOutPtr->revision = value;
+        } else if (strcmp(name, "--results") == 0) {
+            argumentsOutPtr->resultsFilePath = value;
+        } else if (strcmp(name, "--baseline") == 0) {
+            argumentsOutPtr->baselineFilePath = value;
+        } else if (strcmp(name, "--mode") == 0) {
+            if (!tryParseHw4Mode(value, &argumentsOutPtr->options.mode)) {
+                return false;
+            }
+        } else if (strcmp(name, "--threads") == 0) {
+            char *end;
+            unsigned long const threadCount = strtoul(value, &end, 10);
+            if (value[0] < '0' || value[0] > '9' || *end != '\0' || threadCount > BENCH_MAX_THREAD_COUNT) {
+                return false;
+            }
+            argumentsOutPtr->options.threadCount = threadCount;
+        } else if (strcmp(name, "--format") == 0) {
+            if (!tryParseHw4Format(value, &argumentsOutPtr->options.inputFormat)) {
+                return false;
+            }
+            argumentsOutPtr->options.outputFormat = argumentsOutPtr->options.inputFormat;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static struct BenchConfiguration getBenchConfiguration(struct Hw4Options const * const options) {
+    return (struct BenchConfiguration){
+        .modeName = hw4ModeName(options->mode),
+        .threadCount = options->threadCount,
+        .formatName = hw4FormatName(options->inputFormat),
+        .ioEngineName = options->ioEngine == HW4_IO_ENGINE_IO_URING ? "io_uring" : "syscall"
+    };
+}
+
+/**
+ * Get the path of the input for the given distribution in the benchmarked input format, converting the text input to
+ * it first if that has not been done yet. Conversion goes through a temporary file, so an interrupted run does not
+ * leave a truncated input behind.
+ *
+ * @returns The path, which the caller is responsible for freeing.
+ */
+static char *prepareBenchInput(
+    struct BenchArguments const * const argumentsPtr,
+    enum BenchDistribution const distribution,
+    unsigned long long * const valueCountOutPtr
+) {
+    char * const textInFilePath = prepareBenchTextInput(argumentsPtr, distribution, valueCountOutPtr);
+    enum Hw4Format const format = argumentsPtr->options.inputFormat;
+    if (format == HW4_FORMAT_TEXT) {
+        return textInFilePath;
+    }
+
+    char * const inFilePath = formatString(
+        "%s/%s-%llu.%s",
+        argumentsPtr->dataDirectoryPath,
+        benchDistributionName(distribution),
+        argumentsPtr->length,
+        hw4FormatName(format)
+    );
+    if (access(inFilePath, R_OK) != 0) {
+        safeFprintf(stderr, "prepareBenchInput", "Converting \"%s\"...\n", inFilePath);
+        char * const temporaryFilePath = formatString("%s.tmp", inFilePath);
+        struct Hw4Options options = hw4DefaultOptions();
+        options.outputFormat = format;
+        hw4Convert(textInFilePath, temporaryFilePath, &options);
+        safeRename(temporaryFilePath, inFilePath, "prepareBenchInput");
+        free(temporaryFilePath);
+    }
+    free(textInFilePath);
+    return inFilePath;
+}
+
+/**
+ * Get the path of the text input for the given distribution, generating it first if it does not exist yet. Generation
+ * goes through a temporary file, so an interrupted run does not leave a truncated input behind.
+ *
+ * @returns The path, which the caller is responsible for freeing.
+ */
+static char *prepareBenchTextInput(
+    struct BenchArguments const * const argumentsPtr,
+    enum BenchDistribution const distribution,
+    unsigned long long * const valueCountOutPtr
+) {
+    char * const inFilePath = formatString(
+        "%s/%s-%llu.in",
+        argumentsPtr->dataDirectoryPath,
+        benchDistributionName(distribution),
+        argumentsPtr->length
+    );
+    if (access(inFilePath, R_OK) == 0) {
+        *valueCountOutPtr = countLines(inFilePath);
+        return inFilePath;
+    }
+
+    safeFprintf(stderr, "prepareBenchTextInput", "Generating \"%s\"...\n", inFilePath);
+    char * const temporaryFilePath = formatString("%s.tmp", inFilePath);
+    int const fileDescriptor = safeOpen(temporaryFilePath, O_WRONLY | O_CREAT | O_TRUNC, "prepareBenchTextInput");
+    *valueCountOutPtr = generateBenchInput(fileDescriptor, distribution, argumentsPtr->length, BENCH_SEED);
+    safeClose(fileDescriptor, "prepareBenchTextInput");
+    safeRename(temporaryFilePath, inFilePath, "prepareBenchTextInput");
+    free(temporaryFilePath);
+    return inFilePath;
+}
+
+static unsigned long long countLines(char const * const filePath) {
+    size_t const bufferCapacity = 1024 * 1024;
+    char * const buffer = safeMalloc(bufferCapacity, "countLines");
+    int const fileDescriptor = safeOpen(filePath, O_RDONLY, "countLines");
+    unsigned long long lineCount = 0;
+    size_t readLength;
+    while ((readLength = safeRead(fileDescriptor, buffer, bufferCapacity, "countLines")) > 0) {
+        char const *lineEnd = buffer;
+        char const * const bufferEnd = buffer + readLength;
+        while ((lineEnd = memchr(lineEnd, '\n', (size_t)(bufferEnd - lineEnd))) != NULL) {
+            lineCount += 1;
+            lineEnd += 1;
+        }
+    }
+    safeClose(fileDescriptor, "countLines");
+    free(buffer);
+    return lineCount;
+}
+
+/**
+ * Run hw4, with the given options, once.
+ *
+ * @returns The wall-clock time taken, in seconds.
+ */
+static double timeHw4(
+    char const * const inFilePath,
+    char const * const outFilePath,
+    struct Hw4Options const * const options
+) {
+    double const startSeconds = getMonotonicSeconds();
+    hw4WithOptions(inFilePath, outFilePath, options);
+    return getMonotonicSeconds() - startSeconds;
+}
+
+static double getMonotonicSeconds(void) {
+    struct timespec now;
+    guardFmt(clock_gettime(CLOCK_MONOTONIC, &now) == 0, "getMonotonicSeconds: clock_gettime failed");
+    return (double)now.tv_sec + (double)now.tv_nsec / (double)BENCH_NANOSECONDS_PER_SECOND;
+}
+
+/**
+ * Find the time of the last result in a results file for the given distribution, input length, and configuration.
+ * Results written before the configuration was recorded count as measured with hw4's default options.
+ *
+ * @param baseline The results file contents. It is not modified.
+ */
+static bool tryFindBaselineSeconds(
+    char * const baseline,
+    char const * const distributionName,
+    unsigned long long const length,
+    struct BenchConfiguration const * const configurationPtr,
+    double * const secondsOutPtr
+) {
+    struct Hw4Options const defaultOptions = hw4DefaultOptions();
+    struct BenchConfiguration const defaultConfiguration = getBenchConfiguration(&defaultOptions);
+
+    bool isFound = false;
+    char const *line = baseline;
+    while (*line != '\0') {
+        char lineDistributionName[32];
+        unsigned long long lineLength;
+        double lineSeconds;
+        int secondsEndIndex = 0;
+        if (
+            sscanf(
+                line,
+                "%*s\t%31s\t%llu\t%*u\t%lf%n",
+                lineDistributionName,
+                &lineLength,
+                &lineSeconds,
+                &secondsEndIndex
+            ) == 3
+            && strcmp(lineDistributionName, distributionName) == 0
+            && lineLength == length
+        ) {
+            char lineModeName[16];
+            size_t lineThreadCount;
+            char lineFormatName[16];
+            char lineIoEngineName[16];
+            bool isConfigurationMatch;
+            if (line[secondsEndIndex] != '\t') {
+                isConfigurationMatch = strcmp(configurationPtr->modeName, defaultConfiguration.modeName) == 0
+                    && configurationPtr->threadCount == defaultConfiguration.threadCount
+                    && strcmp(configurationPtr->formatName, defaultConfiguration.formatName) == 0
+                    && strcmp(configurationPtr->ioEngineName, defaultConfiguration.ioEngineName) == 0;
+            } else {
+                isConfigurationMatch = sscanf(
+                        line + secondsEndIndex,
+                        "\t%15s\t%zu\t%15s\t%15s",
+                        lineModeName,
+                        &lineThreadCount,
+                        lineFormatName,
+                        lineIoEngineName
+                    ) == 4
+                    && strcmp(lineModeName, configurationPtr->modeName) == 0
+                    && lineThreadCount == configurationPtr->threadCount
+                    && strcmp(lineFormatName, configurationPtr->formatName) == 0
+                    && strcmp(lineIoEngineName, configurationPtr->ioEngineName) == 0;
+            }
+            if (isConfigurationMatch) {
+                *secondsOutPtr = lineSeconds;
+                isFound = true;
+            }
+        }
+        char const * const lineEnd = strchr(line, '\n');
+        if (lineEnd == NULL) {
+            break;
+        }
+        line = lineEnd + 1;
+    }
+    return isFound;
+}
@@ -0,0 +1,31 @@
+/*
+ * Generate a benchmark input for CSCI 451 HW4 on standard output.
+ */
+
+#include "./generate.h"
+
+#include "../include/util/file.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+int main(int const argc, char ** const argv) {
+    enum BenchDistribution distribution;
+    if ((argc != 3 && argc != 4) || !tryParseBenchDistribution(argv[1], &distribution)) {
+        safeFprintf(
+            stderr,
+            "main",
+            "Usage: %s DISTRIBUTION LENGTH [SEED] > INPUT\n"
+                "Write about LENGTH bytes of integers, one per line, drawn from DISTRIBUTION: mixed, odd, even,\n"
+                "narrow, wide, or negative. The same arguments always produce the same input.\n",
+            argv[0]
+        );
+        return EXIT_FAILURE;
+    }
+
+    unsigned long long const length = strtoull(argv[2], NULL, 10);
+    unsigned long long const seed = argc == 4 ? strtoull(argv[3], NULL, 10) : 451;
+    generateBenchInput(STDOUT_FILENO, distribution, length, seed);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,277 @@
+/*
+ * Measure the per-call cost of the util wrappers on hw4's hot paths against the raw libc and pthread calls.
+ */
+
+#define _GNU_SOURCE
+
+#include "./generate.h"
+
+#include "../include/util/thread.h"
+#include "../include/util/callback.h"
+#include "../include/util/file.h"
+#include "../include/util/guard.h"
+#include "../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#define MICROBENCH_NANOSECONDS_PER_SECOND 1000000000
+
+/**
+ * The number of times each measurement is taken; the fastest is reported, to filter out warm-up and interruptions.
+ */
+#define MICROBENCH_TRIAL_COUNT 3
+
+/**
+ * The approximate length of the input scanned by the scan benchmarks.
+ */
+#define MICROBENCH_SCAN_INPUT_LENGTH (16 * 1024 * 1024)
+
+/**
+ * Two threads taking turns under one mutex and condition, so every wait is woken by a signal.
+ */
+struct PingPong {
+    pthread_mutex_t mutex;
+    pthread_cond_t turnCondition;
+    int turn;
+    unsigned long roundCount;
+    bool useWrappers;
+};
+
+DECLARE_FUNC(MicrobenchMeasurement, double, unsigned long, bool)
+
+static double measureBest(MicrobenchMeasurement measurement, unsigned long callCount, bool useWrappers);
+static double measureMutex(unsigned long callCount, bool useWrappers);
+static double measureConditionWait(unsigned long callCount, bool useWrappers);
+static void *pingPongStartRoutine(void *pingPongVoidPtr);
+static void playPingPong(struct PingPong *pingPongPtr, int player);
+static double measureFprintf(unsigned long callCount, bool useWrappers);
+static double measureScan(FILE *file, unsigned long *callCountOutPtr, bool useWrappers);
+static void reportMeasurements(
+    char const *wrapperName,
+    char const *rawName,
+    unsigned long callCount,
+    double rawSeconds,
+    double wrapperSeconds
+);
+static double getMonotonicSeconds(void);
+
+int main(int const argc, char ** const argv) {
+    unsigned long const callCount = argc == 2 ? strtoul(argv[1], NULL, 10) : 10000000;
+    if (argc > 2 || callCount == 0) {
+        safeFprintf(
+            stderr,
+            "main",
+            "Usage: %s [CALLS]\n"
+                "Time CALLS calls of each util wrapper and of the raw call it wraps, and report the difference per\n"
+                "call: the cost of the wrapper's checks and error plumbing, apart from the cost of the call itself.\n",
+            argv[0]
+        );
+        return EXIT_FAILURE;
+    }
+
+    safeFprintf(stdout, "main", "%-34s %12s %12s %12s\n", "call (wrapper / raw)", "wrapper ns", "raw ns", "tax ns");
+
+    reportMeasurements(
+        "safeMutexLock+Unlock",
+        "pthread_mutex_lock+unlock",
+        callCount,
+        measureBest(measureMutex, callCount, false),
+        measureBest(measureMutex, callCount, true)
+    );
+
+    // Each round trip is two waits and a thread switch each, so far fewer rounds give a stable figure
+    unsigned long const roundCount = callCount / 50 + 1;
+    reportMeasurements(
+        "safeConditionWait",
+        "pthread_cond_wait",
+        roundCount * 2,
+        measureBest(measureConditionWait, roundCount, false),
+        measureBest(measureConditionWait, roundCount, true)
+    );
+
+    reportMeasurements(
+        "safeFprintf",
+        "fprintf",
+        callCount,
+        measureBest(measureFprintf, callCount, false),
+        measureBest(measureFprintf, callCount, true)
+    );
+
+    FILE * const scanFile = tmpfile();
+    guardFmt(scanFile != NULL, "main: Failed to create the scan input");
+    generateBenchInput(fileno(scanFile), BENCH_DISTRIBUTION_MIXED, MICROBENCH_SCAN_INPUT_LENGTH, 451);
+    unsigned long scanCallCount = 0;
+    double rawScanSeconds = measureScan(scanFile, &scanCallCount, false);
+    double wrapperScanSeconds = measureScan(scanFile, &scanCallCount, true);
+    for (int trialIndex = 1; trialIndex < MICROBENCH_TRIAL_COUNT; trialIndex += 1) {
+        double const rawSeconds = measureScan(scanFile, &scanCallCount, false);
+        double const wrapperSeconds = measureScan(scanFile, &scanCallCount, true);
+        rawScanSeconds = rawSeconds < rawScanSeconds ? rawSeconds : rawScanSeconds;
+        wrapperScanSeconds = wrapperSeconds < wrapperScanSeconds ? wrapperSeconds : wrapperScanSeconds;
+    }
+    reportMeasurements("scanFileExact", "fscanf", scanCallCount, rawScanSeconds, wrapperScanSeconds);
+    fclose(scanFile);
+
+    return EXIT_SUCCESS;
+}
+
+static double measureBest(
+    MicrobenchMeasurement const measurement,
+    unsigned long const callCount,
+    bool const useWrappers
+) {
+    double bestSeconds = measurement(callCount, useWrappers);
+    for (int trialIndex = 1; trialIndex < MICROBENCH_TRIAL_COUNT; trialIndex += 1) {
+        double const seconds = measurement(callCount, useWrappers);
+        if (seconds < bestSeconds) {
+            bestSeconds = seconds;
+        }
+    }
+    return bestSeconds;
+}
+
+static double measureMutex(unsigned long const callCount, bool const useWrappers) {
+    pthread_mutex_t mutex;
+    safeMutexInit(&mutex, NULL, "measureMutex");
+
+    double const startSeconds = getMonotonicSeconds();
+    if (useWrappers) {
+        for (unsigned long callIndex = 0; callIndex < callCount; callIndex += 1) {
+            safeMutexLock(&mutex, "measureMutex");
+            safeMutexUnlock(&mutex, "measureMutex");
+        }
+    } else {
+        for (unsigned long callIndex = 0; callIndex < callCount; callIndex += 1) {
+            pthread_mutex_lock(&mutex);
+            pthread_mutex_unlock(&mutex);
+        }
+    }
+    double const seconds = getMonotonicSeconds() - startSeconds;
+
+    safeMutexDestroy(&mutex, "measureMutex");
+    return seconds;
+}
+
+static double measureConditionWait(unsigned long const roundCount, bool const useWrappers) {
+    struct PingPong pingPong = { .turn = 0, .roundCount = roundCount, .useWrappers = useWrappers };
+    safeMutexInit(&pingPong.mutex, NULL, "measureConditionWait");
+    safeConditionInit(&pingPong.turnCondition, NULL, "measureConditionWait");
+
+    double const startSeconds = getMonotonicSeconds();
+    pthread_t const threadId = safePthreadCreate(NULL, pingPongStartRoutine, &pingPong, "measureConditionWait");
+    playPingPong(&pingPong, 0);
+    safePthreadJoin(threadId, "measureConditionWait");
+    double const seconds = getMonotonicSeconds() - startSeconds;
+
+    safeConditionDestroy(&pingPong.turnCondition, "measureConditionWait");
+    safeMutexDestroy(&pingPong.mutex, "measureConditionWait");
+    return seconds;
+}
+
+static void *pingPongStartRoutine(void * const pingPongVoidPtr) {
+    playPingPong(pingPongVoidPtr, 1);
+    return NULL;
+}
+
+/**
+ * Take the given player's turns: wait for the turn, then hand it to the other player.
+ */
+static void playPingPong(struct PingPong * const pingPongPtr, int const player) {
+    for (unsigned long roundIndex = 0; roundIndex < pingPongPtr->roundCount; roundIndex += 1) {
+        if (pingPongPtr->useWrappers) {
+            safeMutexLock(&pingPongPtr->mutex, "playPingPong");
+            while (pingPongPtr->turn != player) {
+                safeConditionWait(&pingPongPtr->turnCondition, &pingPongPtr->mutex, "playPingPong");
+            }
+            pingPongPtr->turn = 1 - player;
+            safeConditionSignal(&pingPongPtr->turnCondition, "playPingPong");
+            safeMutexUnlock(&pingPongPtr->mutex, "playPingPong");
+        } else {
+            pthread_mutex_lock(&pingPongPtr->mutex);
+            while (pingPongPtr->turn != player) {
+                pthread_cond_wait(&pingPongPtr->turnCondition, &pingPongPtr->mutex);
+            }
+            pingPongPtr->turn = 1 - player;
+            pthread_cond_signal(&pingPongPtr->turnCondition);
+            pthread_mutex_unlock(&pingPongPtr->mutex);
+        }
+    }
+}
+
+static double measureFprintf(unsigned long const callCount, bool const useWrappers) {
+    FILE * const file = fopen("/dev/null", "w");
+    guardFmt(file != NULL, "measureFprintf: Failed to open /dev/null");
+
+    double const startSeconds = getMonotonicSeconds();
+    if (useWrappers) {
+        for (unsigned long callIndex = 0; callIndex < callCount; callIndex += 1) {
+            safeFprintf(file, "measureFprintf", "%d\n", (int)callIndex);
+        }
+    } else {
+        for (unsigned long callIndex = 0; callIndex < callCount; callIndex += 1) {
+            fprintf(file, "%d\n", (int)callIndex);
+        }
+    }
+    double const seconds = getMonotonicSeconds() - startSeconds;
+
+    fclose(file);
+    return seconds;
+}
+
+/**
+ * Scan the whole file, one integer per call, from the start.
+ */
+static double measureScan(FILE * const file, unsigned long * const callCountOutPtr, bool const useWrappers) {
+    rewind(file);
+    unsigned long callCount = 0;
+    int value;
+
+    double const startSeconds = getMonotonicSeconds();
+    if (useWrappers) {
+        while (scanFileExact(file, 1, "%d", &value)) {
+            callCount += 1;
+        }
+    } else {
+        while (fscanf(file, "%d", &value) == 1) {
+            callCount += 1;
+        }
+    }
+    double const seconds = getMonotonicSeconds() - startSeconds;
+
+    *callCountOutPtr = callCount;
+    return seconds;
+}
+
+static void reportMeasurements(
+    char const * const wrapperName,
+    char const * const rawName,
+    unsigned long const callCount,
+    double const rawSeconds,
+    double const wrapperSeconds
+) {
+    double const nanosecondsPerCall = (double)MICROBENCH_NANOSECONDS_PER_SECOND / (double)callCount;
+    double const rawNanoseconds = rawSeconds * nanosecondsPerCall;
+    double const wrapperNanoseconds = wrapperSeconds * nanosecondsPerCall;
+    safeFprintf(
+        stdout,
+        "reportMeasurements",
+        "%-34s %12.2f %12.2f %12.2f\n%-34s\n",
+        wrapperName,
+        wrapperNanoseconds,
+        rawNanoseconds,
+        wrapperNanoseconds - rawNanoseconds,
+        rawName
+    );
+    fflush(stdout);
+}
+
+static double getMonotonicSeconds(void) {
+    struct timespec now;
+    guardFmt(clock_gettime(CLOCK_MONOTONIC, &now) == 0, "getMonotonicSeconds: clock_gettime failed");
+    return (double)now.tv_sec + (double)now.tv_nsec / (double)MICROBENCH_NANOSECONDS_PER_SECOND;
+}
@@ -1,3 +1,109 @@
 #pragma once
 
+#include "./util/file.h"
+#include "./util/integer.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+enum Hw4Mode {
+    /** One thread reads and parses while a second formats and writes. Works for any input. */
+    HW4_MODE_PIPELINE,
+    /** Chunks of a mapped input are parsed and formatted on a thread pool and written in order. */
+    HW4_MODE_PARALLEL,
+    /** Like HW4_MODE_PARALLEL, but each worker writes its chunk at a precomputed offset of a regular output file. */
+    HW4_MODE_PARALLEL_PWRITE,
+    /** Canonical lines of a mapped input are written straight from the mapping; only other lines are formatted. */
+    HW4_MODE_PASSTHROUGH
+};
+
+enum Hw4IoEngine {
+    /** Plain read(2)/write(2), or a memory mapping for regular input files. */
+    HW4_IO_ENGINE_SYSCALL,
+    /** Reads and writes through io_uring with several fixed buffers in flight. Falls back to the syscall engine when
+        io_uring is unavailable. */
+    HW4_IO_ENGINE_IO_URING
+};
+
+enum Hw4Format {
+    /** One decimal integer per line. */
+    HW4_FORMAT_TEXT,
+    /** A header then packed little-endian int32 values (see hw4/binary.h). */
+    HW4_FORMAT_BINARY,
+    /** A header then frames of zigzag-encoded group varints (see hw4/varint.h). */
+    HW4_FORMAT_VARINT
+};
+
+enum Hw4Compression {
+    /** Written as is. */
+    HW4_COMPRESSION_NONE,
+    /** Compressed with the gzip program. */
+    HW4_COMPRESSION_GZIP,
+    /** Compressed with the zstd program. */
+    HW4_COMPRESSION_ZSTD,
+    /** Compressed with the lz4 program (LZ4 frame format). */
+    HW4_COMPRESSION_LZ4
+};
+
+struct Hw4Options {
+    enum Hw4Mode mode;
+    enum Hw4Format inputFormat;
+    enum Hw4Format outputFormat;
+    enum Hw4Compression outputCompression;
+    enum Hw4IoEngine ioEngine;
+    size_t ioRingSlotCount;
+    size_t threadCount;
+    size_t chunkSize;
+    size_t readBufferCapacity;
+    size_t blockCapacity;
+    size_t blockCount;
+    size_t writeBufferCapacity;
+    struct FlushPolicy flushPolicy;
+    unsigned long long checkpointInterval;
+    bool shouldResume;
+};
+
+/**
+ * One input/output file pair for hw4Batch.
+ */
+struct Hw4BatchEntry {
+    char const *inFilePath;
+    char const *outFilePath;
+};
+
+/**
+ * The capacity of a divergence's actual line: enough to show a wrong line, or the start of a garbled one.
+ */
+#define HW4_DIVERGENCE_LINE_CAPACITY 32
+
+/**
+ * Where an output first differs from what hw4 writes for its input (see hw4Verify).
+ */
+struct Hw4Divergence {
+    /** The 1-based input line holding the integer whose output differs, or 0 if the output runs past the input's. */
+    unsigned long long inputLineNumber;
+    /** The 1-based output line that differs. */
+    unsigned long long outputLineNumber;
+    /** The expected output line, without its newline; empty if the output should have ended. */
+    char expectedLine[INTEGER_LINE_MAX_LENGTH];
+    /** The start of the actual output line, without its newline; empty if the output ended early. */
+    char actualLine[HW4_DIVERGENCE_LINE_CAPACITY];
+    /** Whether the actual output line is the output's last, cut off without a newline. */
+    bool isActualLineUnterminated;
+};
+
+struct Hw4Options hw4DefaultOptions(void);
+
 void hw4(char const *inFilePath, char const *outFilePath);
+void hw4WithOptions(char const *inFilePath, char const *outFilePath, struct Hw4Options const *options);
+void hw4Convert(char const *inFilePath, char const *outFilePath, struct Hw4Options const *options);
+void hw4Batch(struct Hw4BatchEntry const *entries, size_t entryCount, struct Hw4Options const *options);
+void hw4BatchManifest(char const *manifestFilePath, struct Hw4Options const *options);
+void hw4Serve(char const *socketPath, struct Hw4Options const *options);
+void hw4Request(char const *socketPath, struct Hw4BatchEntry const *entries, size_t entryCount);
+bool hw4Verify(
+    char const *inFilePath,
+    char const *outFilePath,
+    struct Hw4Options const *options,
+    struct Hw4Divergence *divergenceOutPtr
+);
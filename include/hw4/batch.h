@@ -0,0 +1,21 @@
+#pragma once
+
+#include "../hw4.h"
+#include "../util/thread.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+void hw4BatchOnPool(
+    struct Hw4BatchEntry const *entries,
+    size_t entryCount,
+    struct Hw4Options const *options,
+    struct ThreadPool *poolPtr
+);
+bool tryParseBatchManifest(
+    char *manifest,
+    size_t manifestLength,
+    struct Hw4BatchEntry **entriesOutPtr,
+    size_t *entryCountOutPtr,
+    size_t *errorLineNumberOutPtr
+);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The binary integer stream format: a 16-byte header followed by packed little-endian int32 values. The header is the
+ * 4-byte magic "HW4B", a little-endian uint32 version, and a little-endian uint64 count of the values that follow. A
+ * count of HW4_BINARY_COUNT_UNKNOWN means the values run to the end of the stream, for writers that cannot seek back
+ * to fill in the count (e.g., pipes).
+ */
+#define HW4_BINARY_MAGIC "HW4B"
+#define HW4_BINARY_VERSION 1u
+#define HW4_BINARY_HEADER_LENGTH 16
+#define HW4_BINARY_INTEGER_LENGTH 4
+#define HW4_BINARY_COUNT_UNKNOWN 0xFFFFFFFFFFFFFFFFull
+
+void encodeHw4BinaryHeader(unsigned long long count, char *output);
+unsigned long long decodeHw4BinaryHeader(char const *input, char const *callerDescription);
+
+size_t encodeHw4BinaryIntegers(int const *integers, size_t count, char *output);
+size_t decodeHw4BinaryIntegers(char const **cursorPtr, char const *end, int *integers, size_t maxCount);
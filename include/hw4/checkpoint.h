@@ -0,0 +1,69 @@
+#pragma once
+
+#include "../util/checksum.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A consistent point in a run: the first `outputOffset` bytes of the output are exactly what the first `inputOffset`
+ * bytes of the input produce, and have the given checksum. The input's length and modification time identify the
+ * input the run was reading, so a checkpoint is not applied to a different one.
+ */
+struct Hw4Checkpoint {
+    unsigned long long inputLength;
+    long long inputModifiedTimeNanoseconds;
+    unsigned long long inputOffset;
+    unsigned long long outputOffset;
+    unsigned long long outputChecksum;
+};
+
+/**
+ * Records checkpoints of a pipeline run. The writing thread adds its output as it goes; once at least `interval` bytes
+ * have been added since the last checkpoint and have reached the output file, the checkpoint is handed to a
+ * background thread, which syncs the output and then atomically replaces the checkpoint file. The writing thread never
+ * waits for the disk; if it gets ahead, only the newest checkpoint is written.
+ */
+struct Hw4Checkpointer {
+    char *filePath;
+    char *temporaryFilePath;
+    int outFileDescriptor;
+    unsigned long long interval;
+
+    struct RunningChecksum checksum;
+    struct Hw4Checkpoint current;
+    struct Hw4Checkpoint candidate;
+    bool hasCandidate;
+    unsigned long long startOutputOffset;
+    unsigned long long lastOutputOffset;
+
+    struct Hw4Checkpoint pending;
+    bool hasPending;
+    bool isClosed;
+    pthread_mutex_t mutex;
+    pthread_cond_t pendingCondition;
+    pthread_t threadId;
+};
+
+bool hw4CheckpointerInit(
+    struct Hw4Checkpointer *checkpointerOutPtr,
+    char const *outFilePath,
+    int inFileDescriptor,
+    unsigned long long interval,
+    bool shouldResume,
+    char const *callerDescription
+);
+void hw4CheckpointerStart(
+    struct Hw4Checkpointer *checkpointerPtr,
+    int outFileDescriptor,
+    char const *callerDescription
+);
+void hw4CheckpointerAddOutput(
+    struct Hw4Checkpointer *checkpointerPtr,
+    void const *output,
+    size_t outputLength,
+    unsigned long long inputOffset
+);
+void hw4CheckpointerNoteWritten(struct Hw4Checkpointer *checkpointerPtr, unsigned long long writtenLength);
+void hw4CheckpointerDestroy(struct Hw4Checkpointer *checkpointerPtr);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "../hw4.h"
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/**
+ * A compression program running as a separate stage of the pipeline, and our end of the pipe connecting to it.
+ */
+struct CompressionStage {
+    pid_t processId;
+    char const *programName;
+    int fileDescriptor;
+};
+
+bool tryStartDecompressionStage(
+    int inFileDescriptor,
+    struct CompressionStage *stageOutPtr,
+    char const *callerDescription
+);
+bool isCompressedInput(int inFileDescriptor, char const *callerDescription);
+void startCompressionStage(
+    enum Hw4Compression compression,
+    int outFileDescriptor,
+    struct CompressionStage *stageOutPtr,
+    char const *callerDescription
+);
+void finishCompressionStage(struct CompressionStage *stagePtr, char const *callerDescription);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "../hw4.h"
+#include "../util/integer.h"
+
+#include <stddef.h>
+
+/**
+ * The maximum number of output characters produced for a single input integer: an even integer's line, twice.
+ */
+#define HW4_OUTPUT_MAX_LENGTH_PER_INTEGER (2 * INTEGER_LINE_MAX_LENGTH)
+
+/**
+ * The maximum length of an output header or trailer, in any format.
+ */
+#define HW4_OUTPUT_MAX_HEADER_LENGTH 16
+
+size_t formatHw4Output(int const *integers, size_t count, char *output);
+size_t hw4OutputLength(int const *integers, size_t count);
+size_t hw4OutputCount(int const *integers, size_t count);
+
+size_t encodeHw4OutputHeader(enum Hw4Format format, char *output);
+size_t encodeHw4OutputTrailer(enum Hw4Format format, char *output);
+size_t encodeHw4Output(enum Hw4Format format, int const *integers, size_t count, char *output);
+size_t encodeIntegers(enum Hw4Format format, int const *integers, size_t count, char *output);
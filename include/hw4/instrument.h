@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../util/histogram.h"
+
+#include <stdbool.h>
+
+/**
+ * Pipeline instrumentation, built in only when HW4_INSTRUMENT is defined (`make instrument`). Code that feeds it goes
+ * inside HW4_INSTRUMENTED(...), which otherwise expands to nothing, so the default build carries no trace of it.
+ *
+ * Each pipeline thread keeps its own stage statistics and reports them when it finishes: to standard error, or appended
+ * to the file named by the HW4_INSTRUMENT_FILE environment variable. If HW4_INSTRUMENT_INTERVAL_MS is set to a positive
+ * number of milliseconds, a progress line is also reported that often.
+ */
+#ifdef HW4_INSTRUMENT
+#define HW4_INSTRUMENTED(...) __VA_ARGS__
+#else
+#define HW4_INSTRUMENTED(...)
+#endif
+
+/**
+ * Time spent in one kind of activity. The time spent on each block, however many pieces it came in, is recorded in the
+ * histogram once the block is done.
+ */
+struct Hw4StageTimer {
+    char const *name;
+    bool isUsed;
+    unsigned long long totalNanoseconds;
+    unsigned long long blockNanoseconds;
+    struct HdrHistogram histogram;
+};
+
+/**
+ * What one pipeline stage (the reading or the writing thread) has done so far.
+ */
+struct Hw4StageStats {
+    char const *name;
+    unsigned long long valueCount;
+    unsigned long long byteCount;
+    unsigned long long blockCount;
+
+    /** Parsing or formatting. */
+    struct Hw4StageTimer work;
+    /** Blocked on the other stage: waiting for a free block to fill, or for a filled block to write. */
+    struct Hw4StageTimer wait;
+    /** Writing the output, if the stage writes. */
+    struct Hw4StageTimer write;
+
+    long long startNanoseconds;
+    long long lastReportNanoseconds;
+    long long reportIntervalNanoseconds;
+    char const *reportFilePath;
+};
+
+struct Hw4StageStats *hw4StageStatsCreate(char const *name, char const *workName, char const *waitName);
+long long hw4StageStatsNow(void);
+long long hw4StageTimerStop(struct Hw4StageTimer *timerPtr, long long startNanoseconds);
+void hw4StageStatsAddBlock(
+    struct Hw4StageStats *statsPtr,
+    unsigned long long valueCount,
+    unsigned long long byteCount,
+    long long nowNanoseconds
+);
+void hw4StageStatsFinish(struct Hw4StageStats *statsPtr);
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "../hw4.h"
+
+#include <stdbool.h>
+
+bool tryParseHw4Mode(char const *name, enum Hw4Mode *modeOutPtr);
+char const *hw4ModeName(enum Hw4Mode mode);
+bool tryParseHw4Format(char const *name, enum Hw4Format *formatOutPtr);
+char const *hw4FormatName(enum Hw4Format format);
+bool tryParseHw4Compression(char const *name, enum Hw4Compression *compressionOutPtr);
+char const *hw4CompressionName(enum Hw4Compression compression);
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "../hw4.h"
+#include "../util/file.h"
+#include "../util/thread.h"
+
+void hw4Parallel(
+    struct MappedFile const *mappedInputPtr,
+    int outFileDescriptor,
+    struct Hw4Options const *options,
+    struct ThreadPool *poolPtr
+);
+void hw4ParallelPwrite(
+    struct MappedFile const *mappedInputPtr,
+    int outFileDescriptor,
+    struct Hw4Options const *options,
+    struct ThreadPool *poolPtr
+);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "../hw4.h"
+#include "../util/file.h"
+
+void hw4Passthrough(struct MappedFile const *mappedInputPtr, int outFileDescriptor, struct Hw4Options const *options);
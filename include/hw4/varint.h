@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The varint integer stream format: an 8-byte header followed by frames. The header is the 4-byte magic "HW4V" and a
+ * little-endian uint32 version. Each frame is a little-endian uint32 count of its integers followed by that many
+ * zigzag-encoded integers packed as group varints: one control byte holding four 2-bit byte lengths (minus one, lowest
+ * bits first), then the four values in that many little-endian bytes each. A frame's last group may hold fewer than
+ * four values; its unused lengths are zero and their bytes are absent. A frame with a count of zero ends the stream,
+ * so the stream can be written to a pipe without knowing its length up front.
+ *
+ * Group varints pay off for integers of up to 6 decimal digits, which take at most 3 bytes once zigzag-encoded, and
+ * mostly for those of 7; integers of 8 digits or more take 4 bytes plus their share of the control byte, more than the
+ * binary format's 4. A frame that would not come out smaller than packed int32 values is therefore written as a raw
+ * frame instead: HW4_VARINT_RAW_FRAME_FLAG is set in its count, and its integers follow as little-endian int32 values,
+ * as in the binary format. A varint stream is thus never larger than a binary one by more than its frame headers.
+ * Version 1 streams, which have no raw frames, are still read.
+ */
+#define HW4_VARINT_MAGIC "HW4V"
+#define HW4_VARINT_VERSION 2u
+#define HW4_VARINT_MIN_VERSION 1u
+#define HW4_VARINT_HEADER_LENGTH 8
+#define HW4_VARINT_FRAME_HEADER_LENGTH 4
+#define HW4_VARINT_RAW_FRAME_FLAG 0x80000000u
+#define HW4_VARINT_GROUP_SIZE 4
+#define HW4_VARINT_MAX_GROUP_LENGTH (1 + 4 * HW4_VARINT_GROUP_SIZE)
+
+/**
+ * Where a varint decoder is within the frames of a stream, kept between calls so the bytes can arrive in pieces.
+ */
+struct Hw4VarintDecoder {
+    size_t frameRemainingCount;
+    bool isFrameRaw;
+    int pendingIntegers[HW4_VARINT_GROUP_SIZE];
+    size_t pendingIndex;
+    size_t pendingCount;
+    bool isEnd;
+};
+
+void encodeHw4VarintHeader(char *output);
+void decodeHw4VarintHeader(char const *input, char const *callerDescription);
+
+size_t encodeHw4VarintFrame(int const *integers, size_t count, bool isEvenDuplicated, char *output);
+size_t encodeHw4VarintTrailer(char *output);
+
+void hw4VarintDecoderInit(struct Hw4VarintDecoder *decoderOutPtr);
+size_t hw4VarintDecoderDecode(
+    struct Hw4VarintDecoder *decoderPtr,
+    char const **cursorPtr,
+    char const *end,
+    int *integers,
+    size_t maxCount
+);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * A Fletcher-style checksum over 64-bit words, updated as bytes stream past. It detects changed, missing, or reordered
+ * bytes, and is cheap enough to run over all of a program's output; it is not cryptographic. Bytes may be added in
+ * pieces of any length, and the result does not depend on how the stream was split.
+ */
+struct RunningChecksum {
+    unsigned long long sum;
+    unsigned long long sumOfSums;
+    unsigned long long length;
+    unsigned char pendingBytes[8];
+    size_t pendingLength;
+};
+
+void runningChecksumInit(struct RunningChecksum *checksumOutPtr);
+void runningChecksumUpdate(struct RunningChecksum *checksumPtr, void const *bytes, size_t length);
+unsigned long long runningChecksumValue(struct RunningChecksum const *checksumPtr);
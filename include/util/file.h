@@ -2,10 +2,129 @@
 
 #include <stdbool.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <sys/uio.h>
+
+struct IoRingReader;
+struct IoRingWriter;
+struct ReadAheadReader;
+
+/**
+ * A read-only memory mapping of a file, from the file descriptor's offset when it was mapped to the end of the file.
+ */
+struct MappedFile {
+    char const *bytes;
+    size_t length;
+    /** The file offset of the first byte. */
+    unsigned long long offset;
+    /** How far before `bytes` the mapping starts, since mappings start on a page boundary. */
+    size_t pageOffset;
+};
+
+/**
+ * A large read buffer over a file descriptor, for inputs that cannot be memory mapped.
+ */
+struct BufferedReader {
+    int fileDescriptor;
+    char *buffer;
+    size_t capacity;
+    char const *cursor;
+    char const *end;
+    bool isEndOfFile;
+    unsigned long long bufferOffset;
+    struct IoRingReader *ringReaderPtr;
+    struct ReadAheadReader *readAheadReaderPtr;
+};
+
+enum FlushPolicyKind {
+    /** Flush whenever at least `size` bytes are buffered. */
+    FLUSH_POLICY_SIZE,
+    /**
+     * Flush whenever the oldest buffered byte has waited at least `intervalMilliseconds`. The age is checked on every
+     * commit; between commits, the caller waits no longer than bufferedWriterFlushTimeout and flushes when it expires.
+     */
+    FLUSH_POLICY_TIME,
+    /** Only flush when the buffer is full and at the end of the stream. */
+    FLUSH_POLICY_END_OF_STREAM
+};
+
+struct FlushPolicy {
+    enum FlushPolicyKind kind;
+    size_t size;
+    unsigned int intervalMilliseconds;
+};
+
+/**
+ * A large aligned output buffer over a file descriptor, written with write(2) according to a flush policy. With an
+ * io_uring writer, the buffer is instead the io_uring writer's current fixed buffer, taken when output is first
+ * reserved in it and submitted as is on flush.
+ */
+struct BufferedWriter {
+    int fileDescriptor;
+    char *buffer;
+    size_t capacity;
+    size_t length;
+    struct FlushPolicy flushPolicy;
+    long long firstBufferedTimeNanoseconds;
+    unsigned long long writtenLength;
+    struct IoRingWriter *ringWriterPtr;
+};
+
+/**
+ * Gathers output as a list of iovecs and writes them with writev(2), up to IOV_MAX at a time. Appended bytes are
+ * referenced rather than copied, and must stay valid until the next flush; bytes that have to be generated go in a
+ * scratch buffer that the writer owns. Adjacent byte ranges are merged into one iovec.
+ */
+struct IovecWriter {
+    int fileDescriptor;
+    struct iovec *iovecs;
+    size_t iovecCount;
+    size_t iovecCapacity;
+    char *scratch;
+    size_t scratchCapacity;
+    size_t scratchLength;
+    unsigned long long writtenLength;
+};
 
 FILE *safeFopen(char const *filePath, char const *modes, char const *callerDescription);
 
+int safeOpen(char const *filePath, int flags, char const *callerDescription);
+void safeClose(int fileDescriptor, char const *callerDescription);
+size_t safeRead(int fileDescriptor, void *buffer, size_t length, char const *callerDescription);
+char *safeReadAll(int fileDescriptor, size_t *lengthOutPtr, char const *callerDescription);
+void safeWrite(int fileDescriptor, void const *buffer, size_t length, char const *callerDescription);
+void safePwrite(
+    int fileDescriptor,
+    void const *buffer,
+    size_t length,
+    unsigned long long offset,
+    char const *callerDescription
+);
+size_t safePread(
+    int fileDescriptor,
+    void *buffer,
+    size_t length,
+    unsigned long long offset,
+    char const *callerDescription
+);
+size_t safePeekPipe(int fileDescriptor, void *buffer, size_t length, char const *callerDescription);
+void safePreallocate(int fileDescriptor, unsigned long long length, char const *callerDescription);
+void safeTruncate(int fileDescriptor, unsigned long long length, char const *callerDescription);
+void safeSeek(int fileDescriptor, unsigned long long offset, char const *callerDescription);
+unsigned long long safeTell(int fileDescriptor, char const *callerDescription);
+void safeSyncData(int fileDescriptor, char const *callerDescription);
+void safeRename(char const *oldFilePath, char const *newFilePath, char const *callerDescription);
+void safeWritev(int fileDescriptor, struct iovec *iovecs, size_t iovecCount, char const *callerDescription);
+void safePipe(int fileDescriptorsOut[2], char const *callerDescription);
+bool isRegularFile(int fileDescriptor, char const *callerDescription);
+bool isAppending(int fileDescriptor, char const *callerDescription);
+bool isPipe(int fileDescriptor, char const *callerDescription);
+size_t tryResizePipe(int fileDescriptor, size_t capacity, char const *callerDescription);
+
+bool tryMapFile(int fileDescriptor, struct MappedFile *mappedFileOutPtr, char const *callerDescription);
+void unmapFile(struct MappedFile *mappedFilePtr, char const *callerDescription);
+
 unsigned int safeFprintf(
     FILE *file,
     char const *callerDescription,
@@ -19,6 +138,7 @@ unsigned int safeVfprintf(
     char const *callerDescription
 );
 
+
 bool safeFgets(char *buffer, size_t bufferLength, FILE *file, char const *callerDescription);
 
 int safeFscanf(
@@ -46,3 +166,41 @@ bool scanFileExactVA(
     char const *format,
     va_list formatArgs
 );
+
+void bufferedReaderInit(
+    struct BufferedReader *readerOutPtr,
+    int fileDescriptor,
+    size_t capacity,
+    char const *callerDescription
+);
+void bufferedReaderUseIoRing(struct BufferedReader *readerPtr, struct IoRingReader *ringReaderPtr);
+void bufferedReaderUseReadAhead(struct BufferedReader *readerPtr, struct ReadAheadReader *readAheadReaderPtr);
+bool bufferedReaderRefill(struct BufferedReader *readerPtr, char const *callerDescription);
+size_t bufferedReaderScanIntegers(struct BufferedReader *readerPtr, int *integers, size_t maxCount);
+void bufferedReaderDestroy(struct BufferedReader *readerPtr);
+
+void bufferedWriterInit(
+    struct BufferedWriter *writerOutPtr,
+    int fileDescriptor,
+    size_t capacity,
+    struct FlushPolicy flushPolicy,
+    char const *callerDescription
+);
+void bufferedWriterUseIoRing(struct BufferedWriter *writerPtr, struct IoRingWriter *ringWriterPtr);
+char *bufferedWriterReserve(struct BufferedWriter *writerPtr, size_t length);
+void bufferedWriterCommit(struct BufferedWriter *writerPtr, size_t length);
+long long bufferedWriterFlushTimeout(struct BufferedWriter const *writerPtr);
+void bufferedWriterFlush(struct BufferedWriter *writerPtr);
+void bufferedWriterDestroy(struct BufferedWriter *writerPtr);
+
+void iovecWriterInit(
+    struct IovecWriter *writerOutPtr,
+    int fileDescriptor,
+    size_t scratchCapacity,
+    char const *callerDescription
+);
+void iovecWriterAppend(struct IovecWriter *writerPtr, void const *bytes, size_t length);
+char *iovecWriterReserveScratch(struct IovecWriter *writerPtr, size_t length);
+void iovecWriterCommitScratch(struct IovecWriter *writerPtr, size_t length);
+void iovecWriterFlush(struct IovecWriter *writerPtr);
+void iovecWriterDestroy(struct IovecWriter *writerPtr);
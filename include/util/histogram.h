@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * The number of bits of each value kept by its bucket: values are grouped by power of two and split into
+ * 2^HDR_HISTOGRAM_SUB_BUCKET_BITS linear sub-buckets within each, so every bucket is within 1/16 (6.25%) of its values.
+ */
+#define HDR_HISTOGRAM_SUB_BUCKET_BITS 4
+#define HDR_HISTOGRAM_SUB_BUCKET_COUNT (1 << HDR_HISTOGRAM_SUB_BUCKET_BITS)
+#define HDR_HISTOGRAM_BUCKET_COUNT ((64 - HDR_HISTOGRAM_SUB_BUCKET_BITS + 1) * HDR_HISTOGRAM_SUB_BUCKET_COUNT)
+
+/**
+ * A histogram in the style of HdrHistogram: log-linear buckets covering every 64-bit value at a fixed relative
+ * precision, so recording is a few instructions and memory is fixed no matter the range (e.g., nanosecond latencies
+ * from a cache hit to a stalled disk). Not thread-safe; each thread should record into its own.
+ */
+struct HdrHistogram {
+    unsigned long long count;
+    unsigned long long sum;
+    unsigned long long min;
+    unsigned long long max;
+    unsigned long long bucketCounts[HDR_HISTOGRAM_BUCKET_COUNT];
+};
+
+void hdrHistogramInit(struct HdrHistogram *histogramOutPtr);
+void hdrHistogramRecord(struct HdrHistogram *histogramPtr, unsigned long long value);
+unsigned long long hdrHistogramValueAtPerMille(struct HdrHistogram const *histogramPtr, unsigned int perMille);
+double hdrHistogramMean(struct HdrHistogram const *histogramPtr);
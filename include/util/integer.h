@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The maximum length of a formatted integer line: "-2147483648\n".
+ */
+#define INTEGER_LINE_MAX_LENGTH 12
+
+enum ParseIntegerLineResult {
+    PARSE_INTEGER_LINE_PARSED,
+    PARSE_INTEGER_LINE_END_OF_INPUT,
+    PARSE_INTEGER_LINE_INCOMPLETE,
+    PARSE_INTEGER_LINE_INVALID,
+    PARSE_INTEGER_LINE_OVERFLOW
+};
+
+enum ParseIntegerLineResult parseIntegerLine(
+    char const **cursorPtr,
+    char const *end,
+    bool isEndOfInput,
+    int *integerOutPtr
+);
+bool parseIntegerLineExact(
+    char const *inputStart,
+    char const **cursorPtr,
+    char const *end,
+    int *integerOutPtr,
+    char const *callerDescription
+);
+size_t parseIntegerLines(
+    char const **cursorPtr,
+    char const *end,
+    bool isEndOfInput,
+    int *integers,
+    size_t maxCount,
+    enum ParseIntegerLineResult *lastResultOutPtr
+);
+size_t parseIntegerLinesExact(
+    char const *inputStart,
+    char const **cursorPtr,
+    char const *end,
+    int *integers,
+    size_t maxCount,
+    char const *callerDescription
+);
+void abortWithParseIntegerLineError(
+    enum ParseIntegerLineResult result,
+    unsigned long long byteOffset,
+    char const *callerDescription
+);
+
+size_t formatIntegerLine(int integer, char *buffer);
+size_t formattedIntegerLineLength(int integer);
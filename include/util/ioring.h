@@ -0,0 +1,125 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A minimal io_uring instance driven through the raw io_uring_setup/io_uring_enter syscalls.
+ */
+struct IoRing {
+    int ringFileDescriptor;
+
+    void *submissionRingBytes;
+    size_t submissionRingLength;
+    atomic_uint *submissionHeadPtr;
+    atomic_uint *submissionTailPtr;
+    unsigned int submissionRingMask;
+    unsigned int *submissionIndices;
+    void *submissionEntries;
+    size_t submissionEntriesLength;
+    unsigned int unsubmittedCount;
+
+    void *completionRingBytes;
+    size_t completionRingLength;
+    atomic_uint *completionHeadPtr;
+    atomic_uint *completionTailPtr;
+    unsigned int completionRingMask;
+    void const *completionEntries;
+
+    bool hasRegisteredBuffers;
+};
+
+/**
+ * One of an IoRingReader's or IoRingWriter's fixed buffers, and the state of the I/O using it.
+ */
+struct IoRingSlot {
+    char *buffer;
+    size_t length;
+    size_t consumedLength;
+    unsigned long long offset;
+    bool isInFlight;
+    bool isComplete;
+};
+
+/**
+ * Reads a file ahead of its consumer through an io_uring, with every fixed buffer's read in flight at once. Regular
+ * files are read at explicit offsets, starting from the file descriptor's offset, which is moved past the bytes
+ * consumed once the reader is destroyed; other files (pipes, etc.) have one read in flight at a time, so their data
+ * stays in order.
+ */
+struct IoRingReader {
+    struct IoRing ring;
+    int fileDescriptor;
+    bool isSeekable;
+    struct IoRingSlot *slots;
+    size_t slotCount;
+    size_t slotCapacity;
+    size_t nextSubmitSlotIndex;
+    size_t nextConsumeSlotIndex;
+    size_t inFlightCount;
+    unsigned long long nextReadOffset;
+    unsigned long long consumedOffset;
+    bool isEndOfFileSubmitted;
+    bool isEndOfFile;
+};
+
+/**
+ * Writes a file through an io_uring, with the caller filling one fixed buffer while the others are being written.
+ * Regular files are written at explicit offsets, starting from the file descriptor's offset, which is moved past the
+ * bytes written once the writer is destroyed; other files, and files opened with O_APPEND, have one write in flight at
+ * a time.
+ */
+struct IoRingWriter {
+    struct IoRing ring;
+    int fileDescriptor;
+    bool isSeekable;
+    struct IoRingSlot *slots;
+    size_t slotCount;
+    size_t slotCapacity;
+    size_t currentSlotIndex;
+    size_t inFlightCount;
+    unsigned long long nextWriteOffset;
+};
+
+bool tryIoRingInit(struct IoRing *ringOutPtr, unsigned int entryCount, char const *callerDescription);
+bool tryIoRingRegisterBuffers(struct IoRing *ringPtr, struct IoRingSlot const *slots, size_t slotCount);
+void ioRingQueueRead(
+    struct IoRing *ringPtr,
+    int fileDescriptor,
+    struct IoRingSlot const *slots,
+    size_t slotIndex,
+    size_t length,
+    long long offset
+);
+void ioRingQueueWrite(
+    struct IoRing *ringPtr,
+    int fileDescriptor,
+    struct IoRingSlot const *slots,
+    size_t slotIndex,
+    long long offset
+);
+void ioRingSubmit(struct IoRing *ringPtr, unsigned int minCompleteCount, char const *callerDescription);
+bool ioRingPopCompletion(struct IoRing *ringPtr, unsigned long long *userDataOutPtr, int *resultOutPtr);
+void ioRingDestroy(struct IoRing *ringPtr, char const *callerDescription);
+
+bool tryIoRingReaderInit(
+    struct IoRingReader *readerOutPtr,
+    int fileDescriptor,
+    size_t slotCount,
+    size_t slotCapacity,
+    char const *callerDescription
+);
+size_t ioRingReaderRead(struct IoRingReader *readerPtr, void *buffer, size_t length, char const *callerDescription);
+void ioRingReaderDestroy(struct IoRingReader *readerPtr, char const *callerDescription);
+
+bool tryIoRingWriterInit(
+    struct IoRingWriter *writerOutPtr,
+    int fileDescriptor,
+    size_t slotCount,
+    size_t slotCapacity,
+    char const *callerDescription
+);
+char *ioRingWriterAcquire(struct IoRingWriter *writerPtr, char const *callerDescription);
+void ioRingWriterSubmit(struct IoRingWriter *writerPtr, size_t length, char const *callerDescription);
+void ioRingWriterDestroy(struct IoRingWriter *writerPtr, char const *callerDescription);
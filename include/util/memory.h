@@ -3,4 +3,5 @@
 #include <stdlib.h>
 
 void *safeMalloc(size_t size, char const *callerDescription);
+void *safeAlignedMalloc(size_t alignment, size_t size, char const *callerDescription);
 void *safeRealloc(void *memory, size_t newSize, char const *callerDescription);
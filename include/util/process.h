@@ -0,0 +1,11 @@
+#pragma once
+
+#include <sys/types.h>
+
+pid_t safeSpawnFilter(
+    char * const *arguments,
+    int inFileDescriptor,
+    int outFileDescriptor,
+    char const *callerDescription
+);
+void safeWaitForSuccess(pid_t processId, char const *programName, char const *callerDescription);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Reads a file ahead of its consumer on a separate thread, into two buffers used in turn: while the consumer copies out
+ * of one, the thread reads into the other. This keeps read(2) calls on a pipe overlapping with parsing, the way the
+ * io_uring reader does for regular files.
+ */
+struct ReadAheadReader {
+    int fileDescriptor;
+    char *buffers[2];
+    size_t lengths[2];
+    size_t capacity;
+    size_t fillIndex;
+    size_t consumeIndex;
+    size_t consumedLength;
+    size_t filledCount;
+    bool isEndOfFile;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t filledCondition;
+    pthread_cond_t emptiedCondition;
+    pthread_t threadId;
+};
+
+void readAheadReaderInit(
+    struct ReadAheadReader *readerOutPtr,
+    int fileDescriptor,
+    size_t capacity,
+    char const *callerDescription
+);
+size_t readAheadReaderRead(struct ReadAheadReader *readerPtr, void *buffer, size_t length);
+void readAheadReaderDestroy(struct ReadAheadReader *readerPtr);
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+int safeListenUnix(char const *socketPath, char const *callerDescription);
+int safeAcceptUnix(int listenFileDescriptor, char const *callerDescription);
+int safeConnectUnix(char const *socketPath, char const *callerDescription);
+void safeShutdownWrite(int socketFileDescriptor, char const *callerDescription);
+bool trySendAll(int socketFileDescriptor, void const *buffer, size_t length);
@@ -3,8 +3,12 @@
 #include "./callback.h"
 
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 DECLARE_FUNC(PthreadCreateStartRoutine, void *, void *)
+DECLARE_ACTION(ThreadPoolTaskRoutine, void *)
 
 pthread_t safePthreadCreate(
     pthread_attr_t const *attributes,
@@ -14,6 +18,13 @@ pthread_t safePthreadCreate(
 );
 void *safePthreadJoin(pthread_t threadId, char const *callerDescription);
 
+/**
+ * When built with MUTEX_PROFILE defined (`make lock-profile`), the mutex wrappers profile lock contention per
+ * callerDescription: acquisitions, contended acquisitions (those that could not lock at once), and the total time spent
+ * waiting for and holding each lock. Time spent in safeConditionWait counts as neither. At exit, the locks are reported
+ * most waited for first: to standard error, or appended to the file named by the MUTEX_PROFILE_FILE environment
+ * variable.
+ */
 void safeMutexInit(
     pthread_mutex_t *mutexOutPtr,
     pthread_mutexattr_t const *attributes,
@@ -29,9 +40,89 @@ void safeConditionInit(
     char const *callerDescription
 );
 void safeConditionSignal(pthread_cond_t *conditionPtr, char const *callerDescription);
+void safeConditionBroadcast(pthread_cond_t *conditionPtr, char const *callerDescription);
 void safeConditionWait(
     pthread_cond_t *conditionPtr,
     pthread_mutex_t *mutexPtr,
     char const *callerDescription
 );
 void safeConditionDestroy(pthread_cond_t *conditionPtr, char const *callerDescription);
+
+#define SPSC_QUEUE_CACHE_LINE_SIZE 64
+
+/**
+ * A bounded lock-free single-producer/single-consumer queue. The consumer-owned and producer-owned indices live on
+ * separate cache lines, as does the rarely-written parking state, so the steady-state push/pop path takes no lock and
+ * makes no syscall. When the queue is empty (consumer) or full (producer), the waiting side spins for an adaptive
+ * number of iterations before parking on a futex.
+ */
+struct SpscQueue {
+    _Alignas(SPSC_QUEUE_CACHE_LINE_SIZE) atomic_size_t head;
+    size_t consumerCachedTail;
+    unsigned int consumerSpinLimit;
+
+    _Alignas(SPSC_QUEUE_CACHE_LINE_SIZE) atomic_size_t tail;
+    size_t producerCachedHead;
+    unsigned int producerSpinLimit;
+
+    _Alignas(SPSC_QUEUE_CACHE_LINE_SIZE) atomic_uint consumerParked;
+    atomic_uint producerParked;
+    atomic_uint notEmptySequence;
+    atomic_uint notFullSequence;
+    atomic_bool closed;
+
+    _Alignas(SPSC_QUEUE_CACHE_LINE_SIZE) unsigned char *elements;
+    size_t elementSize;
+    size_t capacity;
+};
+
+enum SpscQueuePopResult {
+    SPSC_QUEUE_POPPED,
+    SPSC_QUEUE_TIMED_OUT,
+    SPSC_QUEUE_CLOSED
+};
+
+void spscQueueInit(
+    struct SpscQueue *queueOutPtr,
+    size_t minCapacity,
+    size_t elementSize,
+    char const *callerDescription
+);
+void spscQueuePush(struct SpscQueue *queuePtr, void const *elementPtr);
+void spscQueueClose(struct SpscQueue *queuePtr);
+bool spscQueuePop(struct SpscQueue *queuePtr, void *elementOutPtr);
+enum SpscQueuePopResult spscQueuePopWithin(
+    struct SpscQueue *queuePtr,
+    void *elementOutPtr,
+    long long timeoutNanoseconds
+);
+void spscQueueDestroy(struct SpscQueue *queuePtr);
+
+struct ThreadPoolTask {
+    ThreadPoolTaskRoutine routine;
+    void *arg;
+};
+
+/**
+ * A fixed set of worker threads running submitted tasks in submission order. Tasks are expected to be coarse (e.g., a
+ * multi-megabyte chunk of input), so the task queue is a plain mutex-protected ring.
+ */
+struct ThreadPool {
+    pthread_t *threadIds;
+    size_t threadCount;
+
+    struct ThreadPoolTask *tasks;
+    size_t taskCapacity;
+    size_t taskHead;
+    size_t taskCount;
+    bool isShuttingDown;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t taskAvailableCondition;
+};
+
+size_t onlineCpuCount(void);
+
+void threadPoolInit(struct ThreadPool *poolOutPtr, size_t threadCount, char const *callerDescription);
+void threadPoolSubmit(struct ThreadPool *poolPtr, ThreadPoolTaskRoutine routine, void *arg);
+void threadPoolDestroy(struct ThreadPool *poolPtr);
@@ -1,15 +1,389 @@
-/*
- * Aidan Matheney
- * aidan.matheney@und.edu
- *
- * CSCI 451 HW4
- */
-
-#include "../include/hw4.h"
-
-#include <stdlib.h>
-
-int main(int const argc, char ** const argv) {
-    hw4("hw4.in", "hw4.out");
-    return EXIT_SUCCESS;
-}
+/*
+ * Aidan Matheney
+ * aidan.matheney@und.edu
+ *
+ * CSCI 451 HW4
+ */
+
+#include "../include/hw4.h"
+#include "../include/hw4/options.h"
+#include "../include/util/file.h"
+#include "../include/util/memory.h"
+#include "../include/util/string.h"
+#include "../include/util/guard.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/**
+ * The number of output bytes between checkpoints with --checkpoint or --resume.
+ */
+#define CHECKPOINT_INTERVAL (64ULL * 1024 * 1024)
+
+/**
+ * The largest thread count accepted by --threads.
+ */
+#define MAX_THREAD_COUNT 1024
+
+static int parseOptions(int argc, char **argv, struct Hw4Options *optionsPtr);
+static char const *takeOptionValue(int argc, char **argv, int *argIndexPtr, char const *name);
+static bool tryParseThreadCount(char const *text, size_t *threadCountOutPtr);
+static int runBatch(int argc, char **argv, struct Hw4Options const *options);
+static int runServer(int argc, char **argv, struct Hw4Options const *options);
+static int runClient(int argc, char **argv);
+static int runVerify(int argc, char **argv, struct Hw4Options const *options);
+static int runConvert(int argc, char **argv, struct Hw4Options const *options);
+static void printUsage(FILE *file, char const *programName);
+
+int main(int const argc, char ** const argv) {
+    struct Hw4Options options = hw4DefaultOptions();
+    int const argIndex = parseOptions(argc, argv, &options);
+    if (argIndex < 0) {
+        printUsage(stderr, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // What follows the options is a command and its arguments, laid out like a whole command line: the program name,
+    // then the command
+    int const commandArgc = argc - argIndex + 1;
+    char ** const commandArgv = argv + argIndex - 1;
+    commandArgv[0] = argv[0];
+    char const * const command = commandArgc > 1 ? commandArgv[1] : "";
+    bool const isCommand = commandArgc > 1 && strncmp(commandArgv[1], "--", 2) == 0;
+    bool const hasOptions = argIndex > 1;
+    bool const isCheckpointed = options.checkpointInterval > 0;
+
+    if (commandArgc == 2 && !hasOptions && (strcmp(command, "-h") == 0 || strcmp(command, "--help") == 0)) {
+        printUsage(stdout, argv[0]);
+        return EXIT_SUCCESS;
+    }
+    if (strcmp(command, "--client") == 0) {
+        // The server's options apply to the pairs it is sent
+        if (hasOptions) {
+            printUsage(stderr, argv[0]);
+            return EXIT_FAILURE;
+        }
+        return runClient(commandArgc, commandArgv);
+    }
+    if (isCommand && isCheckpointed) {
+        printUsage(stderr, argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (strcmp(command, "--batch") == 0 || strcmp(command, "--manifest") == 0) {
+        return runBatch(commandArgc, commandArgv, &options);
+    }
+    if (strcmp(command, "--serve") == 0) {
+        return runServer(commandArgc, commandArgv, &options);
+    }
+    if (strcmp(command, "--verify") == 0) {
+        return runVerify(commandArgc, commandArgv, &options);
+    }
+    if (strcmp(command, "--convert") == 0) {
+        return runConvert(commandArgc, commandArgv, &options);
+    }
+    if (isCommand || commandArgc > 3) {
+        printUsage(stderr, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    char const * const inFilePath = commandArgc > 1 ? commandArgv[1] : "hw4.in";
+    char const * const outFilePath = commandArgc > 2 ? commandArgv[2] : "hw4.out";
+    hw4WithOptions(inFilePath, outFilePath, &options);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Parse the options at the start of the command line into the given options.
+ *
+ * @returns The index of the first argument after the options, or -1 if an option has a missing or invalid value.
+ */
+static int parseOptions(int const argc, char ** const argv, struct Hw4Options * const optionsPtr) {
+    int argIndex = 1;
+    while (argIndex < argc) {
+        char const * const arg = argv[argIndex];
+        if (strcmp(arg, "--checkpoint") == 0 || strcmp(arg, "--resume") == 0) {
+            optionsPtr->checkpointInterval = CHECKPOINT_INTERVAL;
+            optionsPtr->shouldResume = optionsPtr->shouldResume || strcmp(arg, "--resume") == 0;
+            argIndex += 1;
+            continue;
+        }
+        if (strcmp(arg, "--io-uring") == 0) {
+            optionsPtr->ioEngine = HW4_IO_ENGINE_IO_URING;
+            argIndex += 1;
+            continue;
+        }
+
+        char const * const modeName = takeOptionValue(argc, argv, &argIndex, "--mode");
+        if (modeName != NULL) {
+            if (!tryParseHw4Mode(modeName, &optionsPtr->mode)) {
+                return -1;
+            }
+            continue;
+        }
+
+        char const * const inputFormatName = takeOptionValue(argc, argv, &argIndex, "--in-format");
+        if (inputFormatName != NULL) {
+            if (!tryParseHw4Format(inputFormatName, &optionsPtr->inputFormat)) {
+                return -1;
+            }
+            continue;
+        }
+
+        char const * const outputFormatName = takeOptionValue(argc, argv, &argIndex, "--out-format");
+        if (outputFormatName != NULL) {
+            if (!tryParseHw4Format(outputFormatName, &optionsPtr->outputFormat)) {
+                return -1;
+            }
+            continue;
+        }
+
+        char const * const compressionName = takeOptionValue(argc, argv, &argIndex, "--compress");
+        if (compressionName != NULL) {
+            if (!tryParseHw4Compression(compressionName, &optionsPtr->outputCompression)) {
+                return -1;
+            }
+            continue;
+        }
+
+        char const * const threadCountText = takeOptionValue(argc, argv, &argIndex, "--threads");
+        if (threadCountText != NULL) {
+            if (!tryParseThreadCount(threadCountText, &optionsPtr->threadCount)) {
+                return -1;
+            }
+            continue;
+        }
+
+        break;
+    }
+    return argIndex;
+}
+
+/**
+ * If the argument at `*argIndexPtr` is the option with the given name, given as "NAME=VALUE" or as "NAME VALUE", move
+ * `*argIndexPtr` past it.
+ *
+ * @returns The option's value (empty if it is missing), or NULL if the argument is not the option.
+ */
+static char const *takeOptionValue(
+    int const argc,
+    char ** const argv,
+    int * const argIndexPtr,
+    char const * const name
+) {
+    char const * const arg = argv[*argIndexPtr];
+    size_t const nameLength = strlen(name);
+    if (strncmp(arg, name, nameLength) != 0 || (arg[nameLength] != '=' && arg[nameLength] != '\0')) {
+        return NULL;
+    }
+
+    *argIndexPtr += 1;
+    if (arg[nameLength] == '=') {
+        return arg + nameLength + 1;
+    }
+    if (*argIndexPtr == argc) {
+        return "";
+    }
+    char const * const value = argv[*argIndexPtr];
+    *argIndexPtr += 1;
+    return value;
+}
+
+/**
+ * Parse a --threads value: a decimal number of worker threads up to MAX_THREAD_COUNT, 0 meaning one per online CPU.
+ *
+ * @returns Whether the value is valid.
+ */
+static bool tryParseThreadCount(char const * const text, size_t * const threadCountOutPtr) {
+    if (text[0] < '0' || text[0] > '9') {
+        return false;
+    }
+
+    char *end;
+    unsigned long const threadCount = strtoul(text, &end, 10);
+    if (*end != '\0' || threadCount > MAX_THREAD_COUNT) {
+        return false;
+    }
+    *threadCountOutPtr = threadCount;
+    return true;
+}
+
+static int runBatch(int const argc, char ** const argv, struct Hw4Options const * const options) {
+    if (strcmp(argv[1], "--manifest") == 0) {
+        if (argc != 3) {
+            printUsage(stderr, argv[0]);
+            return EXIT_FAILURE;
+        }
+        hw4BatchManifest(argv[2], options);
+        return EXIT_SUCCESS;
+    }
+
+    size_t const pathCount = (size_t)argc - 2;
+    if (pathCount == 0 || pathCount % 2 != 0) {
+        printUsage(stderr, argv[0]);
+        return EXIT_FAILURE;
+    }
+    size_t const entryCount = pathCount / 2;
+    struct Hw4BatchEntry * const entries = safeMalloc(sizeof *entries * entryCount, "runBatch");
+    for (size_t entryIndex = 0; entryIndex < entryCount; entryIndex += 1) {
+        entries[entryIndex] = (struct Hw4BatchEntry){
+            .inFilePath = argv[2 + entryIndex * 2],
+            .outFilePath = argv[3 + entryIndex * 2]
+        };
+    }
+    hw4Batch(entries, entryCount, options);
+    free(entries);
+    return EXIT_SUCCESS;
+}
+
+static int runServer(int const argc, char ** const argv, struct Hw4Options const * const options) {
+    if (argc != 3) {
+        printUsage(stderr, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    hw4Serve(argv[2], options);
+    return EXIT_SUCCESS;
+}
+
+static int runClient(int const argc, char ** const argv) {
+    size_t const pathCount = argc > 3 ? (size_t)argc - 3 : 0;
+    if (pathCount == 0 || pathCount % 2 != 0) {
+        printUsage(stderr, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // The server runs in its own working directory, so relative paths are resolved against this one
+    char * const workingDirectoryPath = getcwd(NULL, 0);
+    guardNotNull(workingDirectoryPath, "workingDirectoryPath", "runClient");
+    char ** const absolutePaths = safeMalloc(sizeof *absolutePaths * pathCount, "runClient");
+    for (size_t pathIndex = 0; pathIndex < pathCount; pathIndex += 1) {
+        char const * const path = argv[3 + pathIndex];
+        absolutePaths[pathIndex] = path[0] == '/'
+            ? formatString("%s", path)
+            : formatString("%s/%s", workingDirectoryPath, path);
+    }
+
+    size_t const entryCount = pathCount / 2;
+    struct Hw4BatchEntry * const entries = safeMalloc(sizeof *entries * entryCount, "runClient");
+    for (size_t entryIndex = 0; entryIndex < entryCount; entryIndex += 1) {
+        entries[entryIndex] = (struct Hw4BatchEntry){
+            .inFilePath = absolutePaths[entryIndex * 2],
+            .outFilePath = absolutePaths[entryIndex * 2 + 1]
+        };
+    }
+    hw4Request(argv[2], entries, entryCount);
+
+    free(entries);
+    for (size_t pathIndex = 0; pathIndex < pathCount; pathIndex += 1) {
+        free(absolutePaths[pathIndex]);
+    }
+    free(absolutePaths);
+    free(workingDirectoryPath);
+    return EXIT_SUCCESS;
+}
+
+static int runVerify(int const argc, char ** const argv, struct Hw4Options const * const options) {
+    if (argc > 4) {
+        printUsage(stderr, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    char const * const inFilePath = argc > 2 ? argv[2] : "hw4.in";
+    char const * const outFilePath = argc > 3 ? argv[3] : "hw4.out";
+    struct Hw4Divergence divergence;
+    if (hw4Verify(inFilePath, outFilePath, options, &divergence)) {
+        safeFprintf(stdout, "runVerify", "%s matches %s\n", outFilePath, inFilePath);
+        return EXIT_SUCCESS;
+    }
+
+    if (divergence.inputLineNumber == 0) {
+        safeFprintf(
+            stdout,
+            "runVerify",
+            "%s:%llu: expected end of output after the last integer of %s, found \"%s\"%s\n",
+            outFilePath,
+            divergence.outputLineNumber,
+            inFilePath,
+            divergence.actualLine,
+            divergence.isActualLineUnterminated ? " without a newline (end of output)" : ""
+        );
+    } else {
+        safeFprintf(
+            stdout,
+            "runVerify",
+            "%s:%llu: expected \"%s\" for %s:%llu, found %s%s%s%s\n",
+            outFilePath,
+            divergence.outputLineNumber,
+            divergence.expectedLine,
+            inFilePath,
+            divergence.inputLineNumber,
+            divergence.actualLine[0] == '\0' ? "" : "\"",
+            divergence.actualLine[0] == '\0' ? "end of output" : divergence.actualLine,
+            divergence.actualLine[0] == '\0' ? "" : "\"",
+            divergence.isActualLineUnterminated ? " without a newline (end of output)" : ""
+        );
+    }
+    return EXIT_FAILURE;
+}
+
+static int runConvert(int const argc, char ** const argv, struct Hw4Options const * const options) {
+    if (argc > 4) {
+        printUsage(stderr, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    char const * const inFilePath = argc > 2 ? argv[2] : "hw4.in";
+    char const * const outFilePath = argc > 3 ? argv[3] : "hw4.out";
+    hw4Convert(inFilePath, outFilePath, options);
+    return EXIT_SUCCESS;
+}
+
+static void printUsage(FILE * const file, char const * const programName) {
+    safeFprintf(
+        file,
+        "printUsage",
+        "Usage: %s [OPTION]... [--checkpoint | --resume] [INPUT [OUTPUT]]\n"
+            "       %s [OPTION]... --batch INPUT OUTPUT [INPUT OUTPUT]...\n"
+            "       %s [OPTION]... --manifest MANIFEST\n"
+            "       %s [OPTION]... --serve SOCKET\n"
+            "       %s --client SOCKET INPUT OUTPUT [INPUT OUTPUT]...\n"
+            "       %s [OPTION]... --verify [INPUT [OUTPUT]]\n"
+            "       %s [OPTION]... --convert [INPUT [OUTPUT]]\n"
+            "Write each integer in INPUT to OUTPUT, even integers twice.\n"
+            "INPUT defaults to hw4.in and OUTPUT to hw4.out; \"-\" means standard input or output.\n"
+            "--checkpoint records progress in OUTPUT.checkpoint as it goes; --resume also continues an interrupted\n"
+            "run from its last checkpoint.\n"
+            "Options (given as --NAME VALUE or --NAME=VALUE):\n"
+            "  --mode MODE     pipeline (the default) reads and writes on two threads; parallel formats chunks\n"
+            "                  of a mapped input on a thread pool; pwrite also writes each chunk at its own offset\n"
+            "                  of a regular output file; passthrough copies canonical lines straight from the mapped\n"
+            "                  input. Inputs that cannot be mapped, and binary or varint input or output, always\n"
+            "                  use pipeline.\n"
+            "  --threads N     use N worker threads for the parallel modes, batches, the server, and --verify\n"
+            "                  (0, the default, means one per online CPU)\n"
+            "  --in-format FORMAT, --out-format FORMAT\n"
+            "                  read or write text (one integer per line, the default), binary (packed int32s), or\n"
+            "                  varint (zigzag group varints)\n"
+            "  --compress TOOL compress OUTPUT with gzip, zstd, or lz4 (none, the default, writes it as is);\n"
+            "                  compressed INPUT is recognized and decompressed whatever this is\n"
+            "  --io-uring      read and write through io_uring, writing output straight from its registered\n"
+            "                  buffers; this runs as a pipeline, and falls back to read(2)/write(2) where io_uring\n"
+            "                  is unavailable\n"
+            "--batch and --manifest process many pairs on one shared worker pool. Each MANIFEST line holds an INPUT\n"
+            "and an OUTPUT separated by whitespace; lines starting with '#' are ignored.\n"
+            "--serve keeps a worker pool running and processes pairs sent with --client over the Unix socket SOCKET,\n"
+            "saving the startup cost of each run.\n"
+            "--verify checks that OUTPUT is exactly what INPUT should produce, reporting the first difference.\n"
+            "--convert writes each integer in INPUT to OUTPUT once, converting between --in-format and --out-format.\n",
+        programName,
+        programName,
+        programName,
+        programName,
+        programName,
+        programName,
+        programName
+    );
+}
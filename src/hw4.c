@@ -1,118 +1,828 @@
 #include "../include/hw4.h"
 
+#include "../include/hw4/binary.h"
+#include "../include/hw4/checkpoint.h"
+#include "../include/hw4/compression.h"
+#include "../include/hw4/varint.h"
+#include "../include/hw4/format.h"
+#include "../include/hw4/instrument.h"
+#include "../include/hw4/parallel.h"
+#include "../include/hw4/passthrough.h"
 #include "../include/util/thread.h"
 #include "../include/util/file.h"
+#include "../include/util/ioring.h"
+#include "../include/util/readahead.h"
+#include "../include/util/integer.h"
+#include "../include/util/memory.h"
 #include "../include/util/guard.h"
 #include "../include/util/error.h"
 
+#include <stdlib.h>
 #include <stdbool.h>
 #include <pthread.h>
-#include <stdio.h>
+#include <string.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
 
-struct ReadIntegersThreadStartArg {
-    char const *inFilePath;
-    int *integerOutPtr;
-    bool *finishedPtr;
+/**
+ * A fixed-capacity block of parsed integers. Blocks are handed from the reading thread to the writing thread as a unit
+ * and then recycled through a free list, so synchronization is paid once per block rather than once per integer.
+ */
+struct IntegerBlock {
+    size_t count;
+    unsigned long long inputEndOffset;
+    int integers[];
+};
+
+/**
+ * Where the reading thread gets its integers from: either a memory mapping of a regular input file, or a large read
+ * buffer for inputs that cannot be mapped (pipes, terminals, etc.) or are read through io_uring. Either way, integers
+ * are parsed or decoded directly from the bytes rather than through stdio.
+ */
+struct IntegerSource {
+    enum Hw4Format format;
+    unsigned long long remainingCount;
+    struct Hw4VarintDecoder varintDecoder;
+    int fileDescriptor;
+    unsigned long long startOffset;
+    bool isMapped;
+    struct MappedFile mappedFile;
+    char const *cursor;
+    struct BufferedReader reader;
+    struct IoRingReader *ringReaderPtr;
+    struct ReadAheadReader *readAheadReaderPtr;
+};
 
-    pthread_mutex_t *syncMutexPtr;
-    pthread_cond_t *integerReadConditionPtr;
-    pthread_cond_t *integerWroteConditionPtr;
+struct ReadIntegersThreadStartArg {
+    struct IntegerSource *sourcePtr;
+    size_t blockCapacity;
+    struct SpscQueue *filledBlockQueuePtr;
+    struct SpscQueue *freeBlockQueuePtr;
 };
 
 struct WriteIntegersThreadStartArg {
-    FILE *outFile;
-    int *integerInPtr;
-    bool *finishedPtr;
-
-    pthread_mutex_t *syncMutexPtr;
-    pthread_cond_t *integerReadConditionPtr;
-    pthread_cond_t *integerWroteConditionPtr;
+    int outFileDescriptor;
+    bool isOutFileRewritable;
+    enum Hw4Format outputFormat;
+    bool isConversion;
+    enum Hw4IoEngine ioEngine;
+    size_t ioRingSlotCount;
+    size_t writeBufferCapacity;
+    struct FlushPolicy flushPolicy;
+    size_t blockCapacity;
+    struct Hw4Checkpointer *checkpointerPtr;
+    struct SpscQueue *filledBlockQueuePtr;
+    struct SpscQueue *freeBlockQueuePtr;
 };
 
+static void integerSourceInit(
+    struct IntegerSource *sourceOutPtr,
+    int inFileDescriptor,
+    bool isMapped,
+    struct MappedFile const *mappedFilePtr,
+    unsigned long long startOffset,
+    struct Hw4Options const *options
+);
+static size_t integerSourceRead(struct IntegerSource *sourcePtr, int *integers, size_t maxCount);
+static unsigned long long integerSourceOffset(struct IntegerSource const *sourcePtr);
+static char const *integerSourceTakeHeader(struct IntegerSource *sourcePtr, size_t length);
+static size_t integerSourceReadBinary(struct IntegerSource *sourcePtr, int *integers, size_t maxCount);
+static size_t integerSourceReadVarint(struct IntegerSource *sourcePtr, int *integers, size_t maxCount);
+static void integerSourceDestroy(struct IntegerSource *sourcePtr);
+
+static void hw4Run(
+    char const *inFilePath,
+    char const *outFilePath,
+    struct Hw4Options const *options,
+    bool isConversion,
+    char const *callerDescription
+);
+static void hw4Pipeline(
+    struct IntegerSource *sourcePtr,
+    int outFileDescriptor,
+    bool isOutFileRewritable,
+    struct Hw4Options const *options,
+    bool isConversion,
+    struct Hw4Checkpointer *checkpointerPtr
+);
+
 static void *readIntegersThreadStart(void *argAsVoidPtr);
 static void *writeIntegersThreadStart(void *argAsVoidPtr);
 
+/**
+ * Get the default HW4 options.
+ *
+ * @returns The default options.
+ */
+struct Hw4Options hw4DefaultOptions(void) {
+    return (struct Hw4Options){
+        .mode = HW4_MODE_PIPELINE,
+        .inputFormat = HW4_FORMAT_TEXT,
+        .outputFormat = HW4_FORMAT_TEXT,
+        .outputCompression = HW4_COMPRESSION_NONE,
+        .ioEngine = HW4_IO_ENGINE_SYSCALL,
+        .ioRingSlotCount = 4,
+        .threadCount = 0,
+        .chunkSize = 4 * 1024 * 1024,
+        .readBufferCapacity = 1024 * 1024,
+        .blockCapacity = 4 * 1024,
+        .blockCount = 16,
+        .writeBufferCapacity = 4 * 1024 * 1024,
+        .flushPolicy = {
+            .kind = FLUSH_POLICY_SIZE,
+            .size = 2 * 1024 * 1024,
+            .intervalMilliseconds = 0
+        },
+        .checkpointInterval = 0,
+        .shouldResume = false
+    };
+}
+
+/**
+ * Run CSCI 451 HW4 with the default options. See hw4WithOptions.
+ *
+ * @param inFilePath The path to the input file containing integers deliminated by newline characters.
+ * @param outFilePath The path to the output file.
+ */
+void hw4(char const * const inFilePath, char const * const outFilePath) {
+    struct Hw4Options const options = hw4DefaultOptions();
+    hw4WithOptions(inFilePath, outFilePath, &options);
+}
+
 /**
  * Run CSCI 451 HW4. This reads integers from the given input file and writes to the given output file. For each read
  * integer, if it is even, it will be written twice to the output file, and if it is odd, it will be written once to the
- * output file. The reading and writing will be split into two threads, where after the reading thread reads an integer,
- * it waits for the writing thread to process it.
+ * output file.
+ *
+ * In `HW4_MODE_PIPELINE`, the reading and writing will be split into two threads. The reading thread parses integers
+ * into blocks of `options->blockCapacity` integers and hands each filled block to the writing thread through a
+ * lock-free queue; the writing thread hands each written block back through a second queue acting as a free list. At
+ * most `options->blockCount` blocks exist, which bounds how far the reading thread may run ahead.
+ *
+ * In `HW4_MODE_PARALLEL`, the input is split into chunks of about `options->chunkSize` bytes which are parsed and
+ * formatted on `options->threadCount` worker threads (0 meaning one per online CPU) and written in input order. This
+ * requires a mappable input; any other input falls back to the pipeline.
+ *
+ * In `HW4_MODE_PARALLEL_PWRITE`, the chunks' output lengths are computed first, and each worker then writes its chunk
+ * straight to its final offset in the preallocated output file. This additionally requires a regular output file; any
+ * other output falls back to `HW4_MODE_PARALLEL`.
+ *
+ * In `HW4_MODE_PASSTHROUGH`, canonical lines are written straight from the input mapping with writev (odd lines once,
+ * even lines twice), and only non-canonical lines are formatted. This requires a mappable input; any other input falls
+ * back to the pipeline.
+ *
+ * With `HW4_IO_ENGINE_IO_URING`, the input is read and the output written through io_uring, with
+ * `options->ioRingSlotCount` fixed buffers per side in flight so disk latency overlaps parsing and formatting. The
+ * input is then not mapped, so the parallel and pass-through modes fall back to the pipeline. If io_uring is
+ * unavailable, plain read/write is used instead.
+ *
+ * `options->inputFormat` and `options->outputFormat` select text (one integer per line), binary (see hw4/binary.h), or
+ * varint (see hw4/varint.h) independently for each side. Only the pipeline handles the non-text formats, so any other
+ * mode falls back to it.
+ *
+ * A regular input file compressed with gzip, zstd, or lz4 (recognized by its magic number) is decompressed by the
+ * matching program running as a separate process ahead of parsing, which reads its output through a pipe. Since the
+ * decompressed input cannot be mapped, the pipeline is used. `options->outputCompression` likewise pipes the output
+ * through a compressing process, so compression runs alongside formatting rather than on the writing thread. The
+ * programs are looked up on the PATH.
+ *
+ * A path of "-" means standard input or output. Pipes, including those to compression programs, are grown to the read
+ * or write buffer size, and a pipe input is read ahead into a double buffer on its own thread so read(2) calls overlap
+ * parsing. Standard output is only ever written onwards from its current offset, so `HW4_MODE_PARALLEL_PWRITE` falls
+ * back to `HW4_MODE_PARALLEL` and a binary output's count is left unknown.
+ *
+ * A positive `options->checkpointInterval` records a checkpoint in "OUTPUT.checkpoint" about every that many output
+ * bytes: the input offset, the output offset, and a checksum of the output so far. The writing thread only tracks
+ * them; a background thread syncs the output and writes the checkpoint file. With `options->shouldResume`, a run
+ * finding a checkpoint verifies the output against it, truncates the output to it, and continues from its input
+ * offset. The checkpoint file is removed once the run completes. Checkpoints need a plain text input file and text
+ * output file with the syscall I/O engine, and the run uses the pipeline.
  *
  * @param inFilePath The path to the input file containing integers deliminated by newline characters.
  * @param outFilePath The path to the output file.
+ * @param options The options.
  */
-void hw4(char const * const inFilePath, char const * const outFilePath) {
-    guardNotNull(inFilePath, "inFilePath", "hw4");
-    guardNotNull(outFilePath, "outFilePath", "hw4");
+void hw4WithOptions(
+    char const * const inFilePath,
+    char const * const outFilePath,
+    struct Hw4Options const * const options
+) {
+    hw4Run(inFilePath, outFilePath, options, false, "hw4WithOptions");
+}
 
-    FILE * const outFile = safeFopen(outFilePath, "w", "hw4");
+/**
+ * Convert the integers in the given input file from `options->inputFormat` to `options->outputFormat`, writing each
+ * exactly once. This lets text files feed binary pipelines and back. The conversion always runs as a pipeline; the
+ * other options apply as in hw4WithOptions.
+ *
+ * @param inFilePath The path to the input file.
+ * @param outFilePath The path to the output file.
+ * @param options The options.
+ */
+void hw4Convert(
+    char const * const inFilePath,
+    char const * const outFilePath,
+    struct Hw4Options const * const options
+) {
+    hw4Run(inFilePath, outFilePath, options, true, "hw4Convert");
+}
 
-    int readInteger;
-    bool finished = false;
+static void hw4Run(
+    char const * const inFilePath,
+    char const * const outFilePath,
+    struct Hw4Options const * const options,
+    bool const isConversion,
+    char const * const callerDescription
+) {
+    guardNotNull(inFilePath, "inFilePath", callerDescription);
+    guardNotNull(outFilePath, "outFilePath", callerDescription);
+    guardNotNull(options, "options", callerDescription);
+    guardFmt(options->readBufferCapacity > 0, "%s: options->readBufferCapacity must be positive", callerDescription);
+    guardFmt(
+        options->inputFormat != HW4_FORMAT_BINARY || options->readBufferCapacity >= HW4_BINARY_HEADER_LENGTH,
+        "%s: options->readBufferCapacity must fit a binary header",
+        callerDescription
+    );
+    guardFmt(
+        options->inputFormat != HW4_FORMAT_VARINT || options->readBufferCapacity >= HW4_VARINT_MAX_GROUP_LENGTH,
+        "%s: options->readBufferCapacity must fit a varint group",
+        callerDescription
+    );
+    guardFmt(options->blockCapacity > 0, "%s: options->blockCapacity must be positive", callerDescription);
+    guardFmt(options->blockCount > 0, "%s: options->blockCount must be positive", callerDescription);
+    guardFmt(
+        options->mode == HW4_MODE_PIPELINE
+            || options->mode == HW4_MODE_PARALLEL
+            || options->mode == HW4_MODE_PARALLEL_PWRITE
+            || options->mode == HW4_MODE_PASSTHROUGH,
+        "%s: options->mode must be a valid mode",
+        callerDescription
+    );
+    guardFmt(
+        options->inputFormat == HW4_FORMAT_TEXT
+            || options->inputFormat == HW4_FORMAT_BINARY
+            || options->inputFormat == HW4_FORMAT_VARINT,
+        "%s: options->inputFormat must be a valid format",
+        callerDescription
+    );
+    guardFmt(
+        options->outputFormat == HW4_FORMAT_TEXT
+            || options->outputFormat == HW4_FORMAT_BINARY
+            || options->outputFormat == HW4_FORMAT_VARINT,
+        "%s: options->outputFormat must be a valid format",
+        callerDescription
+    );
+    guardFmt(
+        options->outputCompression == HW4_COMPRESSION_NONE
+            || options->outputCompression == HW4_COMPRESSION_GZIP
+            || options->outputCompression == HW4_COMPRESSION_ZSTD
+            || options->outputCompression == HW4_COMPRESSION_LZ4,
+        "%s: options->outputCompression must be a valid compression",
+        callerDescription
+    );
+    guardFmt(
+        options->ioEngine == HW4_IO_ENGINE_SYSCALL || options->ioEngine == HW4_IO_ENGINE_IO_URING,
+        "%s: options->ioEngine must be a valid I/O engine",
+        callerDescription
+    );
+    guardFmt(options->ioRingSlotCount > 0, "%s: options->ioRingSlotCount must be positive", callerDescription);
+    guardFmt(options->chunkSize > 0, "%s: options->chunkSize must be positive", callerDescription);
+    guardFmt(
+        options->blockCapacity <= options->writeBufferCapacity / HW4_OUTPUT_MAX_LENGTH_PER_INTEGER,
+        "%s: options->writeBufferCapacity must fit a fully-formatted block",
+        callerDescription
+    );
+    guardFmt(
+        options->writeBufferCapacity >= HW4_OUTPUT_MAX_HEADER_LENGTH,
+        "%s: options->writeBufferCapacity must fit an output header",
+        callerDescription
+    );
+    bool const isCheckpointed = options->checkpointInterval > 0;
+    guardFmt(
+        !options->shouldResume || isCheckpointed,
+        "%s: options->shouldResume requires a positive options->checkpointInterval",
+        callerDescription
+    );
+    guardFmt(
+        !isCheckpointed || (
+            options->inputFormat == HW4_FORMAT_TEXT
+                && options->outputFormat == HW4_FORMAT_TEXT
+                && options->outputCompression == HW4_COMPRESSION_NONE
+                && options->ioEngine == HW4_IO_ENGINE_SYSCALL
+                && !isConversion
+        ),
+        "%s: Checkpoints need text input and output, no output compression, and the syscall I/O engine",
+        callerDescription
+    );
+
+    bool const isInStdin = strcmp(inFilePath, "-") == 0;
+    int const inFileDescriptor = isInStdin ? STDIN_FILENO : safeOpen(inFilePath, O_RDONLY, callerDescription);
+    struct CompressionStage decompressionStage;
+    bool const isInFileCompressed = tryStartDecompressionStage(
+        inFileDescriptor,
+        &decompressionStage,
+        callerDescription
+    );
+    int const readFileDescriptor = isInFileCompressed ? decompressionStage.fileDescriptor : inFileDescriptor;
+    guardFmt(
+        !isCheckpointed || (!isInStdin && !isInFileCompressed && isRegularFile(inFileDescriptor, callerDescription)),
+        "%s: Checkpoints need an uncompressed regular input file",
+        callerDescription
+    );
+    tryResizePipe(readFileDescriptor, options->readBufferCapacity, callerDescription);
+
+    struct MappedFile mappedInFile;
+    bool const isInFileMapped = options->ioEngine != HW4_IO_ENGINE_IO_URING
+        && tryMapFile(readFileDescriptor, &mappedInFile, callerDescription);
+
+    bool const isOutStdout = strcmp(outFilePath, "-") == 0;
+    guardFmt(!isCheckpointed || !isOutStdout, "%s: Checkpoints need an output file", callerDescription);
+
+    // A resumed run keeps the output up to its checkpoint instead of truncating it
+    struct Hw4Checkpointer *checkpointerPtr = NULL;
+    bool isResumed = false;
+    unsigned long long startInputOffset = 0;
+    if (isCheckpointed) {
+        checkpointerPtr = safeMalloc(sizeof *checkpointerPtr, callerDescription);
+        isResumed = hw4CheckpointerInit(
+            checkpointerPtr,
+            outFilePath,
+            inFileDescriptor,
+            options->checkpointInterval,
+            options->shouldResume,
+            callerDescription
+        );
+        startInputOffset = checkpointerPtr->current.inputOffset;
+    }
+
+    int const outFileDescriptor = isOutStdout
+        ? STDOUT_FILENO
+        : safeOpen(outFilePath, O_WRONLY | O_CREAT | (isResumed ? 0 : O_TRUNC), callerDescription);
+    if (isResumed) {
+        safeTruncate(outFileDescriptor, checkpointerPtr->current.outputOffset, callerDescription);
+        safeSeek(outFileDescriptor, checkpointerPtr->current.outputOffset, callerDescription);
+    }
+    struct CompressionStage compressionStage;
+    bool const isOutFileCompressed = options->outputCompression != HW4_COMPRESSION_NONE;
+    if (isOutFileCompressed) {
+        startCompressionStage(options->outputCompression, outFileDescriptor, &compressionStage, callerDescription);
+    }
+    int const writeFileDescriptor = isOutFileCompressed ? compressionStage.fileDescriptor : outFileDescriptor;
+    tryResizePipe(writeFileDescriptor, options->writeBufferCapacity, callerDescription);
+
+    // Standard output may be appending, or already written to, so it is only written onwards from its current offset
+    bool const isOutFileRewritable = !isOutStdout && isRegularFile(writeFileDescriptor, callerDescription);
+
+    enum Hw4Mode mode = options->mode;
+    if (mode == HW4_MODE_PARALLEL_PWRITE && !isOutFileRewritable) {
+        mode = HW4_MODE_PARALLEL;
+    }
+    bool const isText = options->inputFormat == HW4_FORMAT_TEXT && options->outputFormat == HW4_FORMAT_TEXT;
+    if (!isInFileMapped || !isText || isConversion || isCheckpointed) {
+        mode = HW4_MODE_PIPELINE;
+    }
+
+    switch (mode) {
+        case HW4_MODE_PIPELINE: {
+            if (checkpointerPtr != NULL) {
+                hw4CheckpointerStart(checkpointerPtr, writeFileDescriptor, callerDescription);
+            }
+
+            struct IntegerSource * const sourcePtr = safeMalloc(sizeof *sourcePtr, callerDescription);
+            integerSourceInit(
+                sourcePtr,
+                readFileDescriptor,
+                isInFileMapped,
+                &mappedInFile,
+                startInputOffset,
+                options
+            );
+            hw4Pipeline(sourcePtr, writeFileDescriptor, isOutFileRewritable, options, isConversion, checkpointerPtr);
+            integerSourceDestroy(sourcePtr);
+            free(sourcePtr);
+
+            if (checkpointerPtr != NULL) {
+                hw4CheckpointerDestroy(checkpointerPtr);
+            }
+            break;
+        }
+        case HW4_MODE_PARALLEL:
+        case HW4_MODE_PARALLEL_PWRITE: {
+            struct ThreadPool pool;
+            threadPoolInit(&pool, options->threadCount, callerDescription);
+            if (mode == HW4_MODE_PARALLEL) {
+                hw4Parallel(&mappedInFile, writeFileDescriptor, options, &pool);
+            } else {
+                hw4ParallelPwrite(&mappedInFile, writeFileDescriptor, options, &pool);
+            }
+            threadPoolDestroy(&pool);
+            break;
+        }
+        case HW4_MODE_PASSTHROUGH:
+            hw4Passthrough(&mappedInFile, writeFileDescriptor, options);
+            break;
+        default:
+            abortWithErrorFmt("%s: Unknown mode: %d", callerDescription, (int)mode);
+    }
 
-    pthread_mutex_t syncMutex;
-    safeMutexInit(&syncMutex, NULL, "hw4");
-    pthread_cond_t integerReadCondition;
-    safeConditionInit(&integerReadCondition, NULL, "hw4");
-    pthread_cond_t integerWroteCondition;
-    safeConditionInit(&integerWroteCondition, NULL, "hw4");
+    if (isOutFileCompressed) {
+        finishCompressionStage(&compressionStage, callerDescription);
+    }
+    if (!isOutStdout) {
+        safeClose(outFileDescriptor, callerDescription);
+    }
+
+    if (isInFileMapped) {
+        // Every mode reads the mapped input to its end, so leave an inherited standard input there, as reading would
+        if (isInStdin) {
+            safeSeek(readFileDescriptor, mappedInFile.offset + mappedInFile.length, callerDescription);
+        }
+        unmapFile(&mappedInFile, callerDescription);
+    }
+    if (isInFileCompressed) {
+        finishCompressionStage(&decompressionStage, callerDescription);
+    }
+    if (!isInStdin) {
+        safeClose(inFileDescriptor, callerDescription);
+    }
+    free(checkpointerPtr);
+}
+
+/**
+ * Run CSCI 451 HW4 as a two-thread reading/writing pipeline. See hw4WithOptions.
+ */
+static void hw4Pipeline(
+    struct IntegerSource * const sourcePtr,
+    int const outFileDescriptor,
+    bool const isOutFileRewritable,
+    struct Hw4Options const * const options,
+    bool const isConversion,
+    struct Hw4Checkpointer * const checkpointerPtr
+) {
+    assert(sourcePtr != NULL);
+    assert(options != NULL);
+
+    struct SpscQueue filledBlockQueue;
+    spscQueueInit(&filledBlockQueue, options->blockCount, sizeof (struct IntegerBlock *), "hw4Pipeline");
+    struct SpscQueue freeBlockQueue;
+    spscQueueInit(&freeBlockQueue, options->blockCount, sizeof (struct IntegerBlock *), "hw4Pipeline");
+
+    struct IntegerBlock ** const blocks = safeMalloc(sizeof *blocks * options->blockCount, "hw4Pipeline");
+    for (size_t blockIndex = 0; blockIndex < options->blockCount; blockIndex += 1) {
+        blocks[blockIndex] = safeMalloc(
+            sizeof *blocks[blockIndex] + sizeof blocks[blockIndex]->integers[0] * options->blockCapacity,
+            "hw4Pipeline"
+        );
+        spscQueuePush(&freeBlockQueue, &blocks[blockIndex]);
+    }
 
     pthread_t const readIntegersThreadId = safePthreadCreate(
         NULL,
         readIntegersThreadStart,
         &(struct ReadIntegersThreadStartArg){
-            .inFilePath = inFilePath,
-            .integerOutPtr = &readInteger,
-            .finishedPtr = &finished,
-
-            .syncMutexPtr = &syncMutex,
-            .integerReadConditionPtr = &integerReadCondition,
-            .integerWroteConditionPtr = &integerWroteCondition
+            .sourcePtr = sourcePtr,
+            .blockCapacity = options->blockCapacity,
+            .filledBlockQueuePtr = &filledBlockQueue,
+            .freeBlockQueuePtr = &freeBlockQueue
         },
-        "hw4"
+        "hw4Pipeline"
     );
     pthread_t const writeIntegersThreadId = safePthreadCreate(
         NULL,
         writeIntegersThreadStart,
         &(struct WriteIntegersThreadStartArg){
-            .outFile = outFile,
-            .integerInPtr = &readInteger,
-            .finishedPtr = &finished,
-
-            .syncMutexPtr = &syncMutex,
-            .integerReadConditionPtr = &integerReadCondition,
-            .integerWroteConditionPtr = &integerWroteCondition
+            .outFileDescriptor = outFileDescriptor,
+            .isOutFileRewritable = isOutFileRewritable,
+            .outputFormat = options->outputFormat,
+            .isConversion = isConversion,
+            .ioEngine = options->ioEngine,
+            .ioRingSlotCount = options->ioRingSlotCount,
+            .writeBufferCapacity = options->writeBufferCapacity,
+            .flushPolicy = options->flushPolicy,
+            .blockCapacity = options->blockCapacity,
+            .checkpointerPtr = checkpointerPtr,
+            .filledBlockQueuePtr = &filledBlockQueue,
+            .freeBlockQueuePtr = &freeBlockQueue
         },
-        "hw4"
+        "hw4Pipeline"
     );
 
-    safePthreadJoin(readIntegersThreadId, "hw4");
-    safePthreadJoin(writeIntegersThreadId, "hw4");
+    safePthreadJoin(readIntegersThreadId, "hw4Pipeline");
+    safePthreadJoin(writeIntegersThreadId, "hw4Pipeline");
+
+    for (size_t blockIndex = 0; blockIndex < options->blockCount; blockIndex += 1) {
+        free(blocks[blockIndex]);
+    }
+    free(blocks);
+
+    spscQueueDestroy(&filledBlockQueue);
+    spscQueueDestroy(&freeBlockQueue);
+}
+
+static void integerSourceInit(
+    struct IntegerSource * const sourceOutPtr,
+    int const inFileDescriptor,
+    bool const isMapped,
+    struct MappedFile const * const mappedFilePtr,
+    unsigned long long const startOffset,
+    struct Hw4Options const * const options
+) {
+    assert(sourceOutPtr != NULL);
+    assert(mappedFilePtr != NULL);
+    assert(options != NULL);
+
+    sourceOutPtr->format = options->inputFormat;
+    sourceOutPtr->remainingCount = HW4_BINARY_COUNT_UNKNOWN;
+    sourceOutPtr->fileDescriptor = inFileDescriptor;
+    sourceOutPtr->startOffset = startOffset;
+    sourceOutPtr->isMapped = isMapped;
+    sourceOutPtr->ringReaderPtr = NULL;
+    sourceOutPtr->readAheadReaderPtr = NULL;
+    if (isMapped) {
+        sourceOutPtr->mappedFile = *mappedFilePtr;
+        sourceOutPtr->cursor = mappedFilePtr->bytes + startOffset;
+    } else {
+        if (startOffset > 0) {
+            safeSeek(inFileDescriptor, startOffset, "integerSourceInit");
+        }
+        bufferedReaderInit(&sourceOutPtr->reader, inFileDescriptor, options->readBufferCapacity, "integerSourceInit");
+    }
+    if (!isMapped && options->ioEngine == HW4_IO_ENGINE_IO_URING) {
+        struct IoRingReader * const ringReaderPtr = safeMalloc(sizeof *ringReaderPtr, "integerSourceInit");
+        if (tryIoRingReaderInit(
+            ringReaderPtr,
+            inFileDescriptor,
+            options->ioRingSlotCount,
+            options->readBufferCapacity,
+            "integerSourceInit"
+        )) {
+            bufferedReaderUseIoRing(&sourceOutPtr->reader, ringReaderPtr);
+            sourceOutPtr->ringReaderPtr = ringReaderPtr;
+        } else {
+            free(ringReaderPtr);
+        }
+    }
+    if (!isMapped && sourceOutPtr->ringReaderPtr == NULL && isPipe(inFileDescriptor, "integerSourceInit")) {
+        struct ReadAheadReader * const readAheadReaderPtr = safeMalloc(sizeof *readAheadReaderPtr, "integerSourceInit");
+        readAheadReaderInit(readAheadReaderPtr, inFileDescriptor, options->readBufferCapacity, "integerSourceInit");
+        bufferedReaderUseReadAhead(&sourceOutPtr->reader, readAheadReaderPtr);
+        sourceOutPtr->readAheadReaderPtr = readAheadReaderPtr;
+    }
+
+    switch (sourceOutPtr->format) {
+        case HW4_FORMAT_TEXT:
+            break;
+        case HW4_FORMAT_BINARY:
+            sourceOutPtr->remainingCount = decodeHw4BinaryHeader(
+                integerSourceTakeHeader(sourceOutPtr, HW4_BINARY_HEADER_LENGTH),
+                "integerSourceInit"
+            );
+            break;
+        case HW4_FORMAT_VARINT:
+            decodeHw4VarintHeader(integerSourceTakeHeader(sourceOutPtr, HW4_VARINT_HEADER_LENGTH), "integerSourceInit");
+            hw4VarintDecoderInit(&sourceOutPtr->varintDecoder);
+            break;
+        default:
+            abortWithErrorFmt("integerSourceInit: Unknown format: %d", (int)sourceOutPtr->format);
+    }
+}
+
+/**
+ * Consume the given number of header bytes from the start of the source. If the input is shorter than that, abort the
+ * program with an error message.
+ *
+ * @returns A pointer to the header bytes, valid until the next read from the source.
+ */
+static char const *integerSourceTakeHeader(struct IntegerSource * const sourcePtr, size_t const length) {
+    assert(sourcePtr != NULL);
 
-    safeMutexDestroy(&syncMutex, "hw4");
-    safeConditionDestroy(&integerReadCondition, "hw4");
-    safeConditionDestroy(&integerWroteCondition, "hw4");
+    char const **cursorPtr = &sourcePtr->cursor;
+    if (sourcePtr->isMapped) {
+        guard(sourcePtr->mappedFile.length >= length, "integerSourceTakeHeader: Input is shorter than its header");
+    } else {
+        struct BufferedReader * const readerPtr = &sourcePtr->reader;
+        while ((size_t)(readerPtr->end - readerPtr->cursor) < length) {
+            guard(
+                bufferedReaderRefill(readerPtr, "integerSourceTakeHeader"),
+                "integerSourceTakeHeader: Input is shorter than its header"
+            );
+        }
+        cursorPtr = &readerPtr->cursor;
+    }
 
-    fclose(outFile);
+    char const * const header = *cursorPtr;
+    *cursorPtr += length;
+    return header;
+}
+
+/**
+ * Read up to maxCount integers from the source.
+ *
+ * @returns The number of integers read. Fewer than maxCount means the end of the input was reached.
+ */
+static size_t integerSourceRead(struct IntegerSource * const sourcePtr, int * const integers, size_t const maxCount) {
+    assert(sourcePtr != NULL);
+    assert(integers != NULL);
+
+    switch (sourcePtr->format) {
+        case HW4_FORMAT_TEXT:
+            break;
+        case HW4_FORMAT_BINARY:
+            return integerSourceReadBinary(sourcePtr, integers, maxCount);
+        case HW4_FORMAT_VARINT:
+            return integerSourceReadVarint(sourcePtr, integers, maxCount);
+        default:
+            abortWithErrorFmt("integerSourceRead: Unknown format: %d", (int)sourcePtr->format);
+    }
+
+    if (sourcePtr->isMapped) {
+        char const * const mappedStart = sourcePtr->mappedFile.bytes;
+        char const * const mappedEnd = mappedStart + sourcePtr->mappedFile.length;
+        return parseIntegerLinesExact(
+            mappedStart,
+            &sourcePtr->cursor,
+            mappedEnd,
+            integers,
+            maxCount,
+            "integerSourceRead"
+        );
+    }
+    return bufferedReaderScanIntegers(&sourcePtr->reader, integers, maxCount);
+}
+
+/**
+ * Get the offset in the input just past the bytes the source has consumed.
+ */
+static unsigned long long integerSourceOffset(struct IntegerSource const * const sourcePtr) {
+    assert(sourcePtr != NULL);
+
+    if (sourcePtr->isMapped) {
+        return (unsigned long long)(sourcePtr->cursor - sourcePtr->mappedFile.bytes);
+    }
+    struct BufferedReader const * const readerPtr = &sourcePtr->reader;
+    size_t const bufferedOffset = (size_t)(readerPtr->cursor - readerPtr->buffer);
+    return sourcePtr->startOffset + readerPtr->bufferOffset + bufferedOffset;
+}
+
+/**
+ * Read up to maxCount integers from a binary source, stopping at the count given in its header. If the input ends
+ * before that count, or has a partial integer or extra bytes after it, abort the program with an error message.
+ *
+ * @returns The number of integers read. Fewer than maxCount means the end of the input was reached.
+ */
+static size_t integerSourceReadBinary(
+    struct IntegerSource * const sourcePtr,
+    int * const integers,
+    size_t const maxCount
+) {
+    assert(sourcePtr != NULL);
+    assert(integers != NULL);
+
+    size_t const limitedMaxCount = sourcePtr->remainingCount < maxCount ? (size_t)sourcePtr->remainingCount : maxCount;
+
+    size_t count = 0;
+    char const *end;
+    if (sourcePtr->isMapped) {
+        end = (char const *)sourcePtr->mappedFile.bytes + sourcePtr->mappedFile.length;
+        count = decodeHw4BinaryIntegers(&sourcePtr->cursor, end, integers, limitedMaxCount);
+    } else {
+        struct BufferedReader * const readerPtr = &sourcePtr->reader;
+        while (true) {
+            count += decodeHw4BinaryIntegers(
+                &readerPtr->cursor,
+                readerPtr->end,
+                integers + count,
+                limitedMaxCount - count
+            );
+            if (count == limitedMaxCount || !bufferedReaderRefill(readerPtr, "integerSourceReadBinary")) {
+                break;
+            }
+        }
+        end = readerPtr->end;
+    }
+
+    if (sourcePtr->remainingCount != HW4_BINARY_COUNT_UNKNOWN) {
+        sourcePtr->remainingCount -= count;
+    }
+    if (count < maxCount) {
+        char const * const cursor = sourcePtr->isMapped ? sourcePtr->cursor : sourcePtr->reader.cursor;
+        guard(
+            sourcePtr->remainingCount == 0 || sourcePtr->remainingCount == HW4_BINARY_COUNT_UNKNOWN,
+            "integerSourceReadBinary: Binary input ended before the count given in its header"
+        );
+        guard(
+            cursor == end
+                && (sourcePtr->isMapped || !bufferedReaderRefill(&sourcePtr->reader, "integerSourceReadBinary")),
+            "integerSourceReadBinary: Binary input has extra bytes after its integers"
+        );
+    }
+    return count;
+}
+
+/**
+ * Read up to maxCount integers from a varint source, stopping at the frame that ends the stream. If the input ends
+ * before that frame or has extra bytes after it, abort the program with an error message.
+ *
+ * @returns The number of integers read. Fewer than maxCount means the end of the input was reached.
+ */
+static size_t integerSourceReadVarint(
+    struct IntegerSource * const sourcePtr,
+    int * const integers,
+    size_t const maxCount
+) {
+    assert(sourcePtr != NULL);
+    assert(integers != NULL);
+
+    struct Hw4VarintDecoder * const decoderPtr = &sourcePtr->varintDecoder;
+    size_t count = 0;
+    bool isEndOfInput;
+    if (sourcePtr->isMapped) {
+        char const * const end = (char const *)sourcePtr->mappedFile.bytes + sourcePtr->mappedFile.length;
+        count = hw4VarintDecoderDecode(decoderPtr, &sourcePtr->cursor, end, integers, maxCount);
+        isEndOfInput = sourcePtr->cursor == end;
+    } else {
+        struct BufferedReader * const readerPtr = &sourcePtr->reader;
+        while (true) {
+            count += hw4VarintDecoderDecode(
+                decoderPtr,
+                &readerPtr->cursor,
+                readerPtr->end,
+                integers + count,
+                maxCount - count
+            );
+            if (count == maxCount || decoderPtr->isEnd || !bufferedReaderRefill(readerPtr, "integerSourceReadVarint")) {
+                break;
+            }
+        }
+        isEndOfInput = readerPtr->cursor == readerPtr->end
+            && (!decoderPtr->isEnd || !bufferedReaderRefill(readerPtr, "integerSourceReadVarint"));
+    }
+
+    if (count < maxCount) {
+        guard(decoderPtr->isEnd, "integerSourceReadVarint: Varint input ended in the middle of a frame");
+        guard(isEndOfInput, "integerSourceReadVarint: Varint input has extra bytes after its last frame");
+    }
+    return count;
+}
+
+/**
+ * Release the source's read buffers, if any. The file descriptor and mapping belong to the caller.
+ */
+static void integerSourceDestroy(struct IntegerSource * const sourcePtr) {
+    assert(sourcePtr != NULL);
+
+    if (!sourcePtr->isMapped) {
+        bufferedReaderDestroy(&sourcePtr->reader);
+    }
+    if (sourcePtr->ringReaderPtr != NULL) {
+        ioRingReaderDestroy(sourcePtr->ringReaderPtr, "integerSourceDestroy");
+        free(sourcePtr->ringReaderPtr);
+    }
+    if (sourcePtr->readAheadReaderPtr != NULL) {
+        readAheadReaderDestroy(sourcePtr->readAheadReaderPtr);
+        free(sourcePtr->readAheadReaderPtr);
+    }
 }
 
 static void *readIntegersThreadStart(void * const argAsVoidPtr) {
     assert(argAsVoidPtr != NULL);
     struct ReadIntegersThreadStartArg const * const argPtr = argAsVoidPtr;
 
-    FILE * const inFile = safeFopen(argPtr->inFilePath, "r", "readIntegersThreadStart");
+    HW4_INSTRUMENTED(
+        struct Hw4StageStats * const statsPtr = hw4StageStatsCreate("reader", "parse", "wait free");
+        unsigned long long instrumentInputOffset = integerSourceOffset(argPtr->sourcePtr);
+        long long instrumentNanoseconds = hw4StageStatsNow();
+    )
+    while (true) {
+        struct IntegerBlock *block;
+        spscQueuePop(argPtr->freeBlockQueuePtr, &block);
+        HW4_INSTRUMENTED(instrumentNanoseconds = hw4StageTimerStop(&statsPtr->wait, instrumentNanoseconds);)
+
+        size_t const count = integerSourceRead(argPtr->sourcePtr, block->integers, argPtr->blockCapacity);
+        HW4_INSTRUMENTED(instrumentNanoseconds = hw4StageTimerStop(&statsPtr->work, instrumentNanoseconds);)
+        if (count == 0) {
+            break;
+        }
+        block->count = count;
+        block->inputEndOffset = integerSourceOffset(argPtr->sourcePtr);
+        HW4_INSTRUMENTED(
+            hw4StageStatsAddBlock(
+                statsPtr,
+                count,
+                block->inputEndOffset - instrumentInputOffset,
+                instrumentNanoseconds
+            );
+            instrumentInputOffset = block->inputEndOffset;
+        )
+        spscQueuePush(argPtr->filledBlockQueuePtr, &block);
 
-    safeMutexLock(argPtr->syncMutexPtr, "readIntegersThreadStart");
-    while (scanFileExact(inFile, 1, "%d\n", argPtr->integerOutPtr)) {
-        safeConditionSignal(argPtr->integerReadConditionPtr, "readIntegersThreadStart");
-        safeConditionWait(argPtr->integerWroteConditionPtr, argPtr->syncMutexPtr, "readIntegersThreadStart");
+        if (count < argPtr->blockCapacity) {
+            break;
+        }
     }
-    *argPtr->finishedPtr = true;
-    safeConditionSignal(argPtr->integerReadConditionPtr, "readIntegersThreadStart");
-    safeMutexUnlock(argPtr->syncMutexPtr, "readIntegersThreadStart");
-
-    fclose(inFile);
+    spscQueueClose(argPtr->filledBlockQueuePtr);
+    HW4_INSTRUMENTED(hw4StageStatsFinish(statsPtr);)
 
     return NULL;
 }
@@ -121,27 +831,104 @@ static void *writeIntegersThreadStart(void * const argAsVoidPtr) {
     assert(argAsVoidPtr != NULL);
     struct WriteIntegersThreadStartArg const * const argPtr = argAsVoidPtr;
 
-    safeMutexLock(argPtr->syncMutexPtr, "writeIntegersThreadStart");
-    while (true) {
-        safeConditionWait(argPtr->integerReadConditionPtr, argPtr->syncMutexPtr, "writeIntegersThreadStart");
+    struct BufferedWriter writer;
+    bufferedWriterInit(
+        &writer,
+        argPtr->outFileDescriptor,
+        argPtr->writeBufferCapacity,
+        argPtr->flushPolicy,
+        "writeIntegersThreadStart"
+    );
+
+    struct IoRingWriter ringWriter;
+    bool const isRingBacked = argPtr->ioEngine == HW4_IO_ENGINE_IO_URING && tryIoRingWriterInit(
+        &ringWriter,
+        argPtr->outFileDescriptor,
+        argPtr->ioRingSlotCount,
+        argPtr->writeBufferCapacity,
+        "writeIntegersThreadStart"
+    );
+    if (isRingBacked) {
+        bufferedWriterUseIoRing(&writer, &ringWriter);
+    }
+
+    char * const headerOutput = bufferedWriterReserve(&writer, HW4_OUTPUT_MAX_HEADER_LENGTH);
+    bufferedWriterCommit(&writer, encodeHw4OutputHeader(argPtr->outputFormat, headerOutput));
 
-        if (*argPtr->finishedPtr) {
-            // Reading thread reached end of input file
+    HW4_INSTRUMENTED(
+        struct Hw4StageStats * const statsPtr = hw4StageStatsCreate("writer", "format", "wait filled");
+        long long instrumentNanoseconds = hw4StageStatsNow();
+    )
+    unsigned long long outputCount = 0;
+    struct IntegerBlock *block;
+    while (true) {
+        enum SpscQueuePopResult const popResult = spscQueuePopWithin(
+            argPtr->filledBlockQueuePtr,
+            &block,
+            bufferedWriterFlushTimeout(&writer)
+        );
+        if (popResult == SPSC_QUEUE_CLOSED) {
             break;
         }
+        if (popResult == SPSC_QUEUE_TIMED_OUT) {
+            // No block arrived before the time flush policy's interval ran out, so flush without waiting for one
+            bufferedWriterFlush(&writer);
+            if (argPtr->checkpointerPtr != NULL) {
+                hw4CheckpointerNoteWritten(argPtr->checkpointerPtr, writer.writtenLength);
+            }
+            continue;
+        }
 
-        int const readInteger = *argPtr->integerInPtr;
-        if (readInteger % 2 == 0) {
-            // Even, so write the value twice
-            safeFprintf(argPtr->outFile, "writeIntegersThreadStart", "%d\n%d\n", readInteger, readInteger);
+        HW4_INSTRUMENTED(
+            instrumentNanoseconds = hw4StageTimerStop(&statsPtr->wait, instrumentNanoseconds);
+            size_t const instrumentValueCount = block->count;
+        )
+        char * const output = bufferedWriterReserve(&writer, block->count * HW4_OUTPUT_MAX_LENGTH_PER_INTEGER);
+        HW4_INSTRUMENTED(instrumentNanoseconds = hw4StageTimerStop(&statsPtr->write, instrumentNanoseconds);)
+        size_t outputLength;
+        if (argPtr->isConversion) {
+            outputLength = encodeIntegers(argPtr->outputFormat, block->integers, block->count, output);
+            outputCount += block->count;
         } else {
-            // Odd, so write the value once
-            safeFprintf(argPtr->outFile, "writeIntegersThreadStart", "%d\n", readInteger);
+            outputLength = encodeHw4Output(argPtr->outputFormat, block->integers, block->count, output);
+            outputCount += hw4OutputCount(block->integers, block->count);
+        }
+        HW4_INSTRUMENTED(instrumentNanoseconds = hw4StageTimerStop(&statsPtr->work, instrumentNanoseconds);)
+
+        if (argPtr->checkpointerPtr != NULL) {
+            hw4CheckpointerAddOutput(argPtr->checkpointerPtr, output, outputLength, block->inputEndOffset);
         }
 
-        safeConditionSignal(argPtr->integerWroteConditionPtr, "writeIntegersThreadStart");
+        spscQueuePush(argPtr->freeBlockQueuePtr, &block);
+
+        bufferedWriterCommit(&writer, outputLength);
+        if (argPtr->checkpointerPtr != NULL) {
+            hw4CheckpointerNoteWritten(argPtr->checkpointerPtr, writer.writtenLength);
+        }
+        HW4_INSTRUMENTED(
+            instrumentNanoseconds = hw4StageTimerStop(&statsPtr->write, instrumentNanoseconds);
+            hw4StageStatsAddBlock(statsPtr, instrumentValueCount, outputLength, instrumentNanoseconds);
+        )
+    }
+
+    char * const trailerOutput = bufferedWriterReserve(&writer, HW4_OUTPUT_MAX_HEADER_LENGTH);
+    bufferedWriterCommit(&writer, encodeHw4OutputTrailer(argPtr->outputFormat, trailerOutput));
+
+    bufferedWriterDestroy(&writer);
+    HW4_INSTRUMENTED(
+        hw4StageTimerStop(&statsPtr->write, instrumentNanoseconds);
+        hw4StageStatsFinish(statsPtr);
+    )
+    if (isRingBacked) {
+        ioRingWriterDestroy(&ringWriter, "writeIntegersThreadStart");
+    }
+
+    // The header went out with an unknown count; fill in the real one where the output can be rewritten
+    if (argPtr->outputFormat == HW4_FORMAT_BINARY && argPtr->isOutFileRewritable) {
+        char header[HW4_BINARY_HEADER_LENGTH];
+        encodeHw4BinaryHeader(outputCount, header);
+        safePwrite(argPtr->outFileDescriptor, header, sizeof header, 0, "writeIntegersThreadStart");
     }
-    safeMutexUnlock(argPtr->syncMutexPtr, "writeIntegersThreadStart");
 
     return NULL;
 }
@@ -0,0 +1,378 @@
+#include "../../include/hw4/batch.h"
+
+#include "../../include/hw4/compression.h"
+#include "../../include/hw4/format.h"
+#include "../../include/hw4/parallel.h"
+#include "../../include/util/thread.h"
+#include "../../include/util/file.h"
+#include "../../include/util/integer.h"
+#include "../../include/util/memory.h"
+#include "../../include/util/guard.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+struct BatchJob {
+    size_t blockCapacity;
+    size_t maxInFlightFileCount;
+
+    size_t inFlightFileCount;
+    pthread_mutex_t mutex;
+    pthread_cond_t fileDoneCondition;
+};
+
+/**
+ * A whole small input file, parsed, formatted, and written by a single worker.
+ */
+struct BatchFile {
+    struct BatchJob *jobPtr;
+    int inFileDescriptor;
+    struct MappedFile mappedInFile;
+    char const *outFilePath;
+};
+
+static bool isBatchPoolEligible(
+    struct Hw4BatchEntry const *entryPtr,
+    int inFileDescriptor,
+    struct Hw4Options const *options
+);
+static void hw4BatchLargeFile(
+    struct MappedFile const *mappedInFilePtr,
+    char const *outFilePath,
+    struct Hw4Options const *options,
+    struct ThreadPool *poolPtr
+);
+static void batchFileTask(void *fileAsVoidPtr);
+
+/**
+ * Run CSCI 451 HW4 on each input/output pair, sharing one pool of `options->threadCount` workers (0 meaning one per
+ * online CPU) across the whole batch rather than starting threads per file. Input files of at most
+ * `options->chunkSize` bytes are packed onto the workers one file per task, so many small files are processed at once;
+ * larger files are split into chunks across all workers as in `HW4_MODE_PARALLEL` (or `HW4_MODE_PARALLEL_PWRITE` when
+ * that mode is selected), while small files queued before them keep the workers busy. At most two small files per
+ * worker are in flight, which bounds open files and memory.
+ *
+ * Pairs the pool cannot handle (standard input or output, compressed files, non-text formats, output compression,
+ * or io_uring) are run one at a time with hw4WithOptions, on the calling thread. Pairs are processed in order but may
+ * finish out of order; every output is complete when this returns.
+ *
+ * @param entries The input/output pairs.
+ * @param entryCount The number of pairs.
+ * @param options The options.
+ */
+void hw4Batch(
+    struct Hw4BatchEntry const * const entries,
+    size_t const entryCount,
+    struct Hw4Options const * const options
+) {
+    guardNotNull(entries, "entries", "hw4Batch");
+    guardNotNull(options, "options", "hw4Batch");
+
+    struct ThreadPool pool;
+    threadPoolInit(&pool, options->threadCount, "hw4Batch");
+    hw4BatchOnPool(entries, entryCount, options, &pool);
+    threadPoolDestroy(&pool);
+}
+
+/**
+ * Run hw4Batch on an existing pool, which is left running for later batches. See hw4Batch.
+ *
+ * @param entries The input/output pairs.
+ * @param entryCount The number of pairs.
+ * @param options The options. `options->threadCount` is ignored in favor of the pool's.
+ * @param poolPtr A pointer to the pool. No other batch may be running on it.
+ */
+void hw4BatchOnPool(
+    struct Hw4BatchEntry const * const entries,
+    size_t const entryCount,
+    struct Hw4Options const * const options,
+    struct ThreadPool * const poolPtr
+) {
+    guardNotNull(entries, "entries", "hw4BatchOnPool");
+    guardNotNull(options, "options", "hw4BatchOnPool");
+    guardNotNull(poolPtr, "poolPtr", "hw4BatchOnPool");
+    guard(options->chunkSize > 0, "hw4BatchOnPool: options->chunkSize must be positive");
+    guard(options->blockCapacity > 0, "hw4BatchOnPool: options->blockCapacity must be positive");
+
+    struct BatchJob job = {
+        .blockCapacity = options->blockCapacity,
+        .maxInFlightFileCount = poolPtr->threadCount * 2,
+        .inFlightFileCount = 0
+    };
+    safeMutexInit(&job.mutex, NULL, "hw4BatchOnPool");
+    safeConditionInit(&job.fileDoneCondition, NULL, "hw4BatchOnPool");
+
+    for (size_t entryIndex = 0; entryIndex < entryCount; entryIndex += 1) {
+        struct Hw4BatchEntry const * const entryPtr = &entries[entryIndex];
+        guardNotNull(entryPtr->inFilePath, "entries[].inFilePath", "hw4BatchOnPool");
+        guardNotNull(entryPtr->outFilePath, "entries[].outFilePath", "hw4BatchOnPool");
+
+        bool const isInStdin = strcmp(entryPtr->inFilePath, "-") == 0;
+        int const inFileDescriptor = isInStdin
+            ? STDIN_FILENO
+            : safeOpen(entryPtr->inFilePath, O_RDONLY, "hw4BatchOnPool");
+        struct MappedFile mappedInFile;
+        if (
+            isInStdin
+            || !isBatchPoolEligible(entryPtr, inFileDescriptor, options)
+            || !tryMapFile(inFileDescriptor, &mappedInFile, "hw4BatchOnPool")
+        ) {
+            if (!isInStdin) {
+                safeClose(inFileDescriptor, "hw4BatchOnPool");
+            }
+            hw4WithOptions(entryPtr->inFilePath, entryPtr->outFilePath, options);
+            continue;
+        }
+
+        if (mappedInFile.length > options->chunkSize) {
+            hw4BatchLargeFile(&mappedInFile, entryPtr->outFilePath, options, poolPtr);
+            unmapFile(&mappedInFile, "hw4BatchOnPool");
+            safeClose(inFileDescriptor, "hw4BatchOnPool");
+            continue;
+        }
+
+        safeMutexLock(&job.mutex, "hw4BatchOnPool");
+        while (job.inFlightFileCount == job.maxInFlightFileCount) {
+            safeConditionWait(&job.fileDoneCondition, &job.mutex, "hw4BatchOnPool");
+        }
+        job.inFlightFileCount += 1;
+        safeMutexUnlock(&job.mutex, "hw4BatchOnPool");
+
+        struct BatchFile * const filePtr = safeMalloc(sizeof *filePtr, "hw4BatchOnPool");
+        *filePtr = (struct BatchFile){
+            .jobPtr = &job,
+            .inFileDescriptor = inFileDescriptor,
+            .mappedInFile = mappedInFile,
+            .outFilePath = entryPtr->outFilePath
+        };
+        threadPoolSubmit(poolPtr, batchFileTask, filePtr);
+    }
+
+    safeMutexLock(&job.mutex, "hw4BatchOnPool");
+    while (job.inFlightFileCount > 0) {
+        safeConditionWait(&job.fileDoneCondition, &job.mutex, "hw4BatchOnPool");
+    }
+    safeMutexUnlock(&job.mutex, "hw4BatchOnPool");
+
+    safeMutexDestroy(&job.mutex, "hw4BatchOnPool");
+    safeConditionDestroy(&job.fileDoneCondition, "hw4BatchOnPool");
+}
+
+/**
+ * Run hw4Batch on the input/output pairs listed in a manifest file. Each non-empty line of the manifest holds an input
+ * path and an output path separated by whitespace; lines starting with '#' are ignored. Paths cannot contain
+ * whitespace. If the manifest is malformed, abort the program with an error message.
+ *
+ * @param manifestFilePath The path to the manifest file, or "-" for standard input.
+ * @param options The options.
+ */
+void hw4BatchManifest(char const * const manifestFilePath, struct Hw4Options const * const options) {
+    guardNotNull(manifestFilePath, "manifestFilePath", "hw4BatchManifest");
+    guardNotNull(options, "options", "hw4BatchManifest");
+
+    bool const isStdin = strcmp(manifestFilePath, "-") == 0;
+    int const manifestFileDescriptor = isStdin
+        ? STDIN_FILENO
+        : safeOpen(manifestFilePath, O_RDONLY, "hw4BatchManifest");
+    size_t manifestLength;
+    char * const manifest = safeReadAll(manifestFileDescriptor, &manifestLength, "hw4BatchManifest");
+    if (!isStdin) {
+        safeClose(manifestFileDescriptor, "hw4BatchManifest");
+    }
+
+    struct Hw4BatchEntry *entries;
+    size_t entryCount;
+    size_t errorLineNumber;
+    guardFmt(
+        tryParseBatchManifest(manifest, manifestLength, &entries, &entryCount, &errorLineNumber),
+        "hw4BatchManifest: Line %zu of \"%s\" must hold an input path and an output path",
+        errorLineNumber,
+        manifestFilePath
+    );
+
+    if (entryCount > 0) {
+        hw4Batch(entries, entryCount, options);
+    }
+
+    free(entries);
+    free(manifest);
+}
+
+/**
+ * Parse a batch manifest (see hw4BatchManifest), splitting it into paths in place: each path is terminated where its
+ * trailing whitespace was, so the entries point into the manifest and are only valid while it is.
+ *
+ * @param manifest The manifest text, followed by a string terminator. It is modified.
+ * @param manifestLength The length of the manifest text.
+ * @param entriesOutPtr Where to write the parsed entries, or NULL if there are none or the manifest is malformed. The
+ *                      caller is responsible for freeing the memory.
+ * @param entryCountOutPtr Where to write the number of parsed entries.
+ * @param errorLineNumberOutPtr Where to write the 1-based number of the first malformed line, or 0 if there is none.
+ *
+ * @returns Whether the manifest is well formed.
+ */
+bool tryParseBatchManifest(
+    char * const manifest,
+    size_t const manifestLength,
+    struct Hw4BatchEntry ** const entriesOutPtr,
+    size_t * const entryCountOutPtr,
+    size_t * const errorLineNumberOutPtr
+) {
+    guardNotNull(manifest, "manifest", "tryParseBatchManifest");
+    guardNotNull(entriesOutPtr, "entriesOutPtr", "tryParseBatchManifest");
+    guardNotNull(entryCountOutPtr, "entryCountOutPtr", "tryParseBatchManifest");
+    guardNotNull(errorLineNumberOutPtr, "errorLineNumberOutPtr", "tryParseBatchManifest");
+
+    struct Hw4BatchEntry *entries = NULL;
+    size_t entryCount = 0;
+    size_t entryCapacity = 0;
+    size_t lineNumber = 0;
+    char *lineStart = manifest;
+    while (lineStart < manifest + manifestLength) {
+        char * const lineEnd = memchr(lineStart, '\n', (size_t)(manifest + manifestLength - lineStart));
+        char * const nextLineStart = lineEnd == NULL ? manifest + manifestLength : lineEnd + 1;
+        if (lineEnd != NULL) {
+            *lineEnd = '\0';
+        }
+        lineNumber += 1;
+
+        char *fields[3] = {NULL, NULL, NULL};
+        size_t fieldCount = 0;
+        for (char *cursor = lineStart; *cursor != '\0';) {
+            if (*cursor == ' ' || *cursor == '\t' || *cursor == '\r') {
+                *cursor = '\0';
+                cursor += 1;
+                continue;
+            }
+            if (fieldCount < 3) {
+                fields[fieldCount] = cursor;
+            }
+            fieldCount += 1;
+            cursor += strcspn(cursor, " \t\r");
+        }
+
+        if (fieldCount > 0 && fields[0][0] != '#') {
+            if (fieldCount != 2) {
+                free(entries);
+                *entriesOutPtr = NULL;
+                *entryCountOutPtr = 0;
+                *errorLineNumberOutPtr = lineNumber;
+                return false;
+            }
+            if (entryCount == entryCapacity) {
+                entryCapacity = entryCapacity == 0 ? 64 : entryCapacity * 2;
+                entries = safeRealloc(entries, sizeof *entries * entryCapacity, "tryParseBatchManifest");
+            }
+            entries[entryCount] = (struct Hw4BatchEntry){ .inFilePath = fields[0], .outFilePath = fields[1] };
+            entryCount += 1;
+        }
+
+        lineStart = nextLineStart;
+    }
+
+    *entriesOutPtr = entries;
+    *entryCountOutPtr = entryCount;
+    *errorLineNumberOutPtr = 0;
+    return true;
+}
+
+/**
+ * Determine whether a pair can be processed on the batch pool: a plain text input file and output file, with the
+ * syscall I/O engine.
+ */
+static bool isBatchPoolEligible(
+    struct Hw4BatchEntry const * const entryPtr,
+    int const inFileDescriptor,
+    struct Hw4Options const * const options
+) {
+    assert(entryPtr != NULL);
+    assert(options != NULL);
+
+    return options->inputFormat == HW4_FORMAT_TEXT
+        && options->outputFormat == HW4_FORMAT_TEXT
+        && options->outputCompression == HW4_COMPRESSION_NONE
+        && options->ioEngine == HW4_IO_ENGINE_SYSCALL
+        && strcmp(entryPtr->outFilePath, "-") != 0
+        && !isCompressedInput(inFileDescriptor, "isBatchPoolEligible");
+}
+
+/**
+ * Process a large file by splitting it across the batch pool. See hw4Batch.
+ */
+static void hw4BatchLargeFile(
+    struct MappedFile const * const mappedInFilePtr,
+    char const * const outFilePath,
+    struct Hw4Options const * const options,
+    struct ThreadPool * const poolPtr
+) {
+    assert(mappedInFilePtr != NULL);
+    assert(outFilePath != NULL);
+
+    int const outFileDescriptor = safeOpen(outFilePath, O_WRONLY | O_CREAT | O_TRUNC, "hw4BatchLargeFile");
+    if (options->mode == HW4_MODE_PARALLEL_PWRITE && isRegularFile(outFileDescriptor, "hw4BatchLargeFile")) {
+        hw4ParallelPwrite(mappedInFilePtr, outFileDescriptor, options, poolPtr);
+    } else {
+        hw4Parallel(mappedInFilePtr, outFileDescriptor, options, poolPtr);
+    }
+    safeClose(outFileDescriptor, "hw4BatchLargeFile");
+}
+
+static void batchFileTask(void * const fileAsVoidPtr) {
+    assert(fileAsVoidPtr != NULL);
+    struct BatchFile * const filePtr = fileAsVoidPtr;
+    struct BatchJob * const jobPtr = filePtr->jobPtr;
+
+    char const * const mappedStart = filePtr->mappedInFile.bytes;
+    char const *cursor = mappedStart;
+    char const * const end = mappedStart + filePtr->mappedInFile.length;
+
+    int * const integers = safeMalloc(sizeof *integers * jobPtr->blockCapacity, "batchFileTask");
+    char *output = NULL;
+    size_t outputCapacity = 0;
+    size_t outputLength = 0;
+    while (true) {
+        size_t const count = parseIntegerLinesExact(
+            mappedStart,
+            &cursor,
+            end,
+            integers,
+            jobPtr->blockCapacity,
+            "batchFileTask"
+        );
+
+        if (count > 0) {
+            size_t const maxOutputLength = outputLength + count * HW4_OUTPUT_MAX_LENGTH_PER_INTEGER;
+            if (maxOutputLength > outputCapacity) {
+                outputCapacity = maxOutputLength * 2;
+                output = safeRealloc(output, outputCapacity, "batchFileTask");
+            }
+            outputLength += formatHw4Output(integers, count, output + outputLength);
+        }
+
+        if (count < jobPtr->blockCapacity) {
+            break;
+        }
+    }
+    free(integers);
+
+    unmapFile(&filePtr->mappedInFile, "batchFileTask");
+    safeClose(filePtr->inFileDescriptor, "batchFileTask");
+
+    int const outFileDescriptor = safeOpen(filePtr->outFilePath, O_WRONLY | O_CREAT | O_TRUNC, "batchFileTask");
+    if (outputLength > 0) {
+        safeWrite(outFileDescriptor, output, outputLength, "batchFileTask");
+    }
+    safeClose(outFileDescriptor, "batchFileTask");
+    free(output);
+    free(filePtr);
+
+    safeMutexLock(&jobPtr->mutex, "batchFileTask");
+    jobPtr->inFlightFileCount -= 1;
+    safeConditionSignal(&jobPtr->fileDoneCondition, "batchFileTask");
+    safeMutexUnlock(&jobPtr->mutex, "batchFileTask");
+}
@@ -0,0 +1,129 @@
+#include "../../include/hw4/binary.h"
+
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+static void storeUint32Le(uint32_t value, char *output);
+static uint32_t loadUint32Le(char const *input);
+
+/**
+ * Write a binary stream header.
+ *
+ * @param count The number of integers that follow, or HW4_BINARY_COUNT_UNKNOWN.
+ * @param output The buffer into which to write HW4_BINARY_HEADER_LENGTH bytes.
+ */
+void encodeHw4BinaryHeader(unsigned long long const count, char * const output) {
+    guardNotNull(output, "output", "encodeHw4BinaryHeader");
+
+    memcpy(output, HW4_BINARY_MAGIC, 4);
+    storeUint32Le(HW4_BINARY_VERSION, output + 4);
+    storeUint32Le((uint32_t)count, output + 8);
+    storeUint32Le((uint32_t)(count >> 32), output + 12);
+}
+
+/**
+ * Read a binary stream header. If the magic or version does not match, abort the program with an error message.
+ *
+ * @param input The HW4_BINARY_HEADER_LENGTH header bytes.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The count of integers that follow, or HW4_BINARY_COUNT_UNKNOWN.
+ */
+unsigned long long decodeHw4BinaryHeader(char const * const input, char const * const callerDescription) {
+    guardNotNull(input, "input", "decodeHw4BinaryHeader");
+    guardNotNull(callerDescription, "callerDescription", "decodeHw4BinaryHeader");
+
+    if (memcmp(input, HW4_BINARY_MAGIC, 4) != 0) {
+        abortWithErrorFmt(
+            "%s: Input does not start with the binary format magic \"%s\"",
+            callerDescription,
+            HW4_BINARY_MAGIC
+        );
+        return 0;
+    }
+    uint32_t const version = loadUint32Le(input + 4);
+    if (version != HW4_BINARY_VERSION) {
+        abortWithErrorFmt(
+            "%s: Unsupported binary format version %u (expected %u)",
+            callerDescription,
+            version,
+            HW4_BINARY_VERSION
+        );
+        return 0;
+    }
+    return (unsigned long long)loadUint32Le(input + 8) | (unsigned long long)loadUint32Le(input + 12) << 32;
+}
+
+/**
+ * Write the given integers as packed little-endian int32 values.
+ *
+ * @param integers The integers.
+ * @param count The number of integers.
+ * @param output The buffer into which to write `count * HW4_BINARY_INTEGER_LENGTH` bytes.
+ *
+ * @returns The number of bytes written.
+ */
+size_t encodeHw4BinaryIntegers(int const * const integers, size_t const count, char * const output) {
+    guardNotNull(integers, "integers", "encodeHw4BinaryIntegers");
+    guardNotNull(output, "output", "encodeHw4BinaryIntegers");
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(output, integers, count * HW4_BINARY_INTEGER_LENGTH);
+#else
+    for (size_t integerIndex = 0; integerIndex < count; integerIndex += 1) {
+        storeUint32Le((uint32_t)integers[integerIndex], output + integerIndex * HW4_BINARY_INTEGER_LENGTH);
+    }
+#endif
+    return count * HW4_BINARY_INTEGER_LENGTH;
+}
+
+/**
+ * Read up to maxCount packed little-endian int32 values. A trailing partial value is left unread.
+ *
+ * @param cursorPtr A pointer to the cursor into the bytes, advanced past everything read.
+ * @param end The end of the available bytes.
+ * @param integers The array into which to store the integers.
+ * @param maxCount The maximum number of integers to read.
+ *
+ * @returns The number of integers read.
+ */
+size_t decodeHw4BinaryIntegers(
+    char const ** const cursorPtr,
+    char const * const end,
+    int * const integers,
+    size_t const maxCount
+) {
+    guardNotNull(cursorPtr, "cursorPtr", "decodeHw4BinaryIntegers");
+    guardNotNull(integers, "integers", "decodeHw4BinaryIntegers");
+
+    size_t const availableCount = (size_t)(end - *cursorPtr) / HW4_BINARY_INTEGER_LENGTH;
+    size_t const count = availableCount < maxCount ? availableCount : maxCount;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(integers, *cursorPtr, count * HW4_BINARY_INTEGER_LENGTH);
+#else
+    for (size_t integerIndex = 0; integerIndex < count; integerIndex += 1) {
+        integers[integerIndex] = (int)loadUint32Le(*cursorPtr + integerIndex * HW4_BINARY_INTEGER_LENGTH);
+    }
+#endif
+    *cursorPtr += count * HW4_BINARY_INTEGER_LENGTH;
+    return count;
+}
+
+static void storeUint32Le(uint32_t const value, char * const output) {
+    output[0] = (char)(value & 0xFF);
+    output[1] = (char)(value >> 8 & 0xFF);
+    output[2] = (char)(value >> 16 & 0xFF);
+    output[3] = (char)(value >> 24 & 0xFF);
+}
+
+static uint32_t loadUint32Le(char const * const input) {
+    unsigned char const * const bytes = (unsigned char const *)input;
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
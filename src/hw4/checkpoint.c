@@ -0,0 +1,389 @@
+#define _GNU_SOURCE
+
+#include "../../include/hw4/checkpoint.h"
+
+#include "../../include/util/checksum.h"
+#include "../../include/util/thread.h"
+#include "../../include/util/file.h"
+#include "../../include/util/string.h"
+#include "../../include/util/memory.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <pthread.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define HW4_CHECKPOINT_FORMAT \
+    "hw4 checkpoint 1\n" \
+    "input-length %llu\n" \
+    "input-modified %lld\n" \
+    "input-offset %llu\n" \
+    "output-offset %llu\n" \
+    "output-checksum %llx\n"
+
+/**
+ * The size of the buffer through which the output is read back when verifying a checkpoint.
+ */
+#define HW4_CHECKPOINT_VERIFY_BUFFER_CAPACITY (1024 * 1024)
+
+static bool tryLoadCheckpoint(
+    struct Hw4Checkpointer *checkpointerPtr,
+    int inFileDescriptor,
+    char const *outFilePath,
+    char const *callerDescription
+);
+static void identifyInput(int inFileDescriptor, struct Hw4Checkpoint *checkpointPtr, char const *callerDescription);
+static void *checkpointThreadStart(void *argAsVoidPtr);
+static void writeCheckpointFile(
+    struct Hw4Checkpointer const *checkpointerPtr,
+    struct Hw4Checkpoint const *checkpointPtr
+);
+
+/**
+ * Initialize the given checkpointer for a run writing the given output, and find the checkpoint the run starts from:
+ * the one left in "OUTPUT.checkpoint" by an interrupted run if resuming and there is one, or else the very start (no
+ * input consumed and no output written). The caller then prepares the output accordingly and starts the checkpointer.
+ *
+ * A checkpoint being resumed must still apply: the input must be the one the run was reading, and the output must
+ * still start with the bytes the checkpoint describes. The output is read back to recompute its checksum, which costs
+ * a sequential read of the output so far rather than redoing the work that produced it. If the checkpoint does not
+ * apply, abort the program with an error message; deleting the checkpoint starts over.
+ *
+ * @param checkpointerOutPtr A pointer to the memory where the checkpointer should be initialized. It must not move
+ *                           until the checkpointer is destroyed.
+ * @param outFilePath The path to the output file.
+ * @param inFileDescriptor The input file descriptor. It must refer to a regular file.
+ * @param interval The minimum number of output bytes between checkpoints.
+ * @param shouldResume Whether to start from an existing checkpoint.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns Whether the run is resuming from an existing checkpoint. `checkpointerOutPtr->current` is the checkpoint
+ *          the run starts from either way.
+ */
+bool hw4CheckpointerInit(
+    struct Hw4Checkpointer * const checkpointerOutPtr,
+    char const * const outFilePath,
+    int const inFileDescriptor,
+    unsigned long long const interval,
+    bool const shouldResume,
+    char const * const callerDescription
+) {
+    guardNotNull(checkpointerOutPtr, "checkpointerOutPtr", "hw4CheckpointerInit");
+    guardNotNull(outFilePath, "outFilePath", "hw4CheckpointerInit");
+    guardNotNull(callerDescription, "callerDescription", "hw4CheckpointerInit");
+    guardFmt(interval > 0, "%s: hw4CheckpointerInit interval must be positive", callerDescription);
+
+    checkpointerOutPtr->filePath = formatString("%s.checkpoint", outFilePath);
+    checkpointerOutPtr->temporaryFilePath = formatString("%s.checkpoint.tmp", outFilePath);
+    checkpointerOutPtr->outFileDescriptor = -1;
+    checkpointerOutPtr->interval = interval;
+    checkpointerOutPtr->hasCandidate = false;
+    checkpointerOutPtr->hasPending = false;
+    checkpointerOutPtr->isClosed = false;
+
+    bool const isResumed = shouldResume
+        && tryLoadCheckpoint(checkpointerOutPtr, inFileDescriptor, outFilePath, callerDescription);
+    if (!isResumed) {
+        identifyInput(inFileDescriptor, &checkpointerOutPtr->current, callerDescription);
+        checkpointerOutPtr->current.inputOffset = 0;
+        checkpointerOutPtr->current.outputOffset = 0;
+        runningChecksumInit(&checkpointerOutPtr->checksum);
+        checkpointerOutPtr->current.outputChecksum = runningChecksumValue(&checkpointerOutPtr->checksum);
+    }
+    checkpointerOutPtr->startOutputOffset = checkpointerOutPtr->current.outputOffset;
+    checkpointerOutPtr->lastOutputOffset = checkpointerOutPtr->current.outputOffset;
+    return isResumed;
+}
+
+/**
+ * Start the checkpointer's thread, once the output has been truncated to the starting checkpoint. A run starting from
+ * the beginning removes any checkpoint left by an earlier run, since the output it describes has been overwritten.
+ *
+ * @param checkpointerPtr A pointer to the checkpointer.
+ * @param outFileDescriptor The output file descriptor, synced before each checkpoint is written.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void hw4CheckpointerStart(
+    struct Hw4Checkpointer * const checkpointerPtr,
+    int const outFileDescriptor,
+    char const * const callerDescription
+) {
+    guardNotNull(checkpointerPtr, "checkpointerPtr", "hw4CheckpointerStart");
+    guardNotNull(callerDescription, "callerDescription", "hw4CheckpointerStart");
+
+    if (checkpointerPtr->startOutputOffset == 0) {
+        unlink(checkpointerPtr->filePath);
+    }
+
+    checkpointerPtr->outFileDescriptor = outFileDescriptor;
+    safeMutexInit(&checkpointerPtr->mutex, NULL, callerDescription);
+    safeConditionInit(&checkpointerPtr->pendingCondition, NULL, callerDescription);
+    checkpointerPtr->threadId = safePthreadCreate(NULL, checkpointThreadStart, checkpointerPtr, callerDescription);
+}
+
+/**
+ * Add a piece of output, produced from the input up to the given offset, before it is handed to the writer. Once at
+ * least the checkpointer's interval of output has been added since the last candidate, the end of this piece becomes
+ * the candidate checkpoint. Called only from the writing thread.
+ *
+ * @param checkpointerPtr A pointer to the checkpointer.
+ * @param output The output bytes.
+ * @param outputLength The number of output bytes.
+ * @param inputOffset The offset in the input just past the integers this output was produced from.
+ */
+void hw4CheckpointerAddOutput(
+    struct Hw4Checkpointer * const checkpointerPtr,
+    void const * const output,
+    size_t const outputLength,
+    unsigned long long const inputOffset
+) {
+    guardNotNull(checkpointerPtr, "checkpointerPtr", "hw4CheckpointerAddOutput");
+    guardNotNull(output, "output", "hw4CheckpointerAddOutput");
+
+    runningChecksumUpdate(&checkpointerPtr->checksum, output, outputLength);
+    checkpointerPtr->current.inputOffset = inputOffset;
+    checkpointerPtr->current.outputOffset += outputLength;
+
+    unsigned long long const lastOutputOffset = checkpointerPtr->hasCandidate
+        ? checkpointerPtr->candidate.outputOffset
+        : checkpointerPtr->lastOutputOffset;
+    if (checkpointerPtr->current.outputOffset - lastOutputOffset >= checkpointerPtr->interval) {
+        checkpointerPtr->current.outputChecksum = runningChecksumValue(&checkpointerPtr->checksum);
+        checkpointerPtr->candidate = checkpointerPtr->current;
+        checkpointerPtr->hasCandidate = true;
+    }
+}
+
+/**
+ * Tell the checkpointer how much of the run's output has been handed to the kernel. If that covers the candidate
+ * checkpoint, the candidate is passed to the checkpointer's thread, replacing any it has not started on yet. Called
+ * only from the writing thread.
+ *
+ * @param checkpointerPtr A pointer to the checkpointer.
+ * @param writtenLength The number of bytes written since the run started (or resumed).
+ */
+void hw4CheckpointerNoteWritten(
+    struct Hw4Checkpointer * const checkpointerPtr,
+    unsigned long long const writtenLength
+) {
+    guardNotNull(checkpointerPtr, "checkpointerPtr", "hw4CheckpointerNoteWritten");
+
+    if (
+        !checkpointerPtr->hasCandidate
+        || checkpointerPtr->startOutputOffset + writtenLength < checkpointerPtr->candidate.outputOffset
+    ) {
+        return;
+    }
+
+    safeMutexLock(&checkpointerPtr->mutex, "hw4CheckpointerNoteWritten");
+    checkpointerPtr->pending = checkpointerPtr->candidate;
+    checkpointerPtr->hasPending = true;
+    safeConditionSignal(&checkpointerPtr->pendingCondition, "hw4CheckpointerNoteWritten");
+    safeMutexUnlock(&checkpointerPtr->mutex, "hw4CheckpointerNoteWritten");
+
+    // Later candidates are measured from this one
+    checkpointerPtr->lastOutputOffset = checkpointerPtr->candidate.outputOffset;
+    checkpointerPtr->hasCandidate = false;
+}
+
+/**
+ * Stop the checkpointer's thread and remove the checkpoint file, since the run it was for is complete. Call this only
+ * once all of the output has been written.
+ *
+ * @param checkpointerPtr A pointer to the checkpointer.
+ */
+void hw4CheckpointerDestroy(struct Hw4Checkpointer * const checkpointerPtr) {
+    guardNotNull(checkpointerPtr, "checkpointerPtr", "hw4CheckpointerDestroy");
+
+    safeMutexLock(&checkpointerPtr->mutex, "hw4CheckpointerDestroy");
+    checkpointerPtr->isClosed = true;
+    safeConditionSignal(&checkpointerPtr->pendingCondition, "hw4CheckpointerDestroy");
+    safeMutexUnlock(&checkpointerPtr->mutex, "hw4CheckpointerDestroy");
+    safePthreadJoin(checkpointerPtr->threadId, "hw4CheckpointerDestroy");
+
+    unlink(checkpointerPtr->filePath);
+
+    safeMutexDestroy(&checkpointerPtr->mutex, "hw4CheckpointerDestroy");
+    safeConditionDestroy(&checkpointerPtr->pendingCondition, "hw4CheckpointerDestroy");
+    free(checkpointerPtr->filePath);
+    checkpointerPtr->filePath = NULL;
+    free(checkpointerPtr->temporaryFilePath);
+    checkpointerPtr->temporaryFilePath = NULL;
+}
+
+/**
+ * Load and verify the checkpoint left by an interrupted run into the checkpointer's current checkpoint and checksum.
+ * See hw4CheckpointerInit.
+ *
+ * @returns Whether there was a checkpoint.
+ */
+static bool tryLoadCheckpoint(
+    struct Hw4Checkpointer * const checkpointerPtr,
+    int const inFileDescriptor,
+    char const * const outFilePath,
+    char const * const callerDescription
+) {
+    assert(checkpointerPtr != NULL);
+    assert(outFilePath != NULL);
+
+    char const * const checkpointFilePath = checkpointerPtr->filePath;
+    if (access(checkpointFilePath, F_OK) == -1) {
+        return false;
+    }
+
+    int const checkpointFileDescriptor = safeOpen(checkpointFilePath, O_RDONLY, callerDescription);
+    size_t checkpointTextLength;
+    char * const checkpointText = safeReadAll(checkpointFileDescriptor, &checkpointTextLength, callerDescription);
+    safeClose(checkpointFileDescriptor, callerDescription);
+
+    struct Hw4Checkpoint * const checkpointPtr = &checkpointerPtr->current;
+    int const matchCount = sscanf(
+        checkpointText,
+        HW4_CHECKPOINT_FORMAT,
+        &checkpointPtr->inputLength,
+        &checkpointPtr->inputModifiedTimeNanoseconds,
+        &checkpointPtr->inputOffset,
+        &checkpointPtr->outputOffset,
+        &checkpointPtr->outputChecksum
+    );
+    free(checkpointText);
+    guardFmt(matchCount == 5, "%s: Checkpoint \"%s\" is malformed", callerDescription, checkpointFilePath);
+
+    struct Hw4Checkpoint inputIdentity = {0};
+    identifyInput(inFileDescriptor, &inputIdentity, callerDescription);
+    guardFmt(
+        inputIdentity.inputLength == checkpointPtr->inputLength
+            && inputIdentity.inputModifiedTimeNanoseconds == checkpointPtr->inputModifiedTimeNanoseconds
+            && checkpointPtr->inputOffset <= checkpointPtr->inputLength,
+        "%s: Checkpoint \"%s\" is for a different input; delete it to start over",
+        callerDescription,
+        checkpointFilePath
+    );
+
+    struct RunningChecksum * const checksumPtr = &checkpointerPtr->checksum;
+    runningChecksumInit(checksumPtr);
+    int const outFileDescriptor = safeOpen(outFilePath, O_RDONLY, callerDescription);
+    char * const buffer = safeMalloc(HW4_CHECKPOINT_VERIFY_BUFFER_CAPACITY, callerDescription);
+    unsigned long long remainingLength = checkpointPtr->outputOffset;
+    while (remainingLength > 0) {
+        size_t const maxReadLength = remainingLength < HW4_CHECKPOINT_VERIFY_BUFFER_CAPACITY
+            ? (size_t)remainingLength
+            : HW4_CHECKPOINT_VERIFY_BUFFER_CAPACITY;
+        size_t const readLength = safeRead(outFileDescriptor, buffer, maxReadLength, callerDescription);
+        if (readLength == 0) {
+            break;
+        }
+        runningChecksumUpdate(checksumPtr, buffer, readLength);
+        remainingLength -= readLength;
+    }
+    free(buffer);
+    safeClose(outFileDescriptor, callerDescription);
+
+    guardFmt(
+        remainingLength == 0 && runningChecksumValue(checksumPtr) == checkpointPtr->outputChecksum,
+        "%s: Output \"%s\" no longer matches checkpoint \"%s\"; delete the checkpoint to start over",
+        callerDescription,
+        outFilePath,
+        checkpointFilePath
+    );
+    return true;
+}
+
+/**
+ * Get the length and modification time of the given input file.
+ */
+static void identifyInput(
+    int const inFileDescriptor,
+    struct Hw4Checkpoint * const checkpointPtr,
+    char const * const callerDescription
+) {
+    assert(checkpointPtr != NULL);
+
+    struct stat fileStatus;
+    if (fstat(inFileDescriptor, &fileStatus) == -1) {
+        int const fstatErrorCode = errno;
+        char const * const fstatErrorMessage = strerror(fstatErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to stat file descriptor %d using fstat (error code: %d; error message: \"%s\")",
+            callerDescription,
+            inFileDescriptor,
+            fstatErrorCode,
+            fstatErrorMessage
+        );
+        return;
+    }
+
+    checkpointPtr->inputLength = (unsigned long long)fileStatus.st_size;
+    checkpointPtr->inputModifiedTimeNanoseconds = (long long)fileStatus.st_mtim.tv_sec * 1000000000
+        + fileStatus.st_mtim.tv_nsec;
+}
+
+static void *checkpointThreadStart(void * const argAsVoidPtr) {
+    assert(argAsVoidPtr != NULL);
+    struct Hw4Checkpointer * const checkpointerPtr = argAsVoidPtr;
+
+    while (true) {
+        safeMutexLock(&checkpointerPtr->mutex, "checkpointThreadStart");
+        while (!checkpointerPtr->hasPending && !checkpointerPtr->isClosed) {
+            safeConditionWait(&checkpointerPtr->pendingCondition, &checkpointerPtr->mutex, "checkpointThreadStart");
+        }
+        if (checkpointerPtr->isClosed) {
+            // The run is complete, so its checkpoint is about to be removed anyway
+            safeMutexUnlock(&checkpointerPtr->mutex, "checkpointThreadStart");
+            break;
+        }
+        struct Hw4Checkpoint const checkpoint = checkpointerPtr->pending;
+        checkpointerPtr->hasPending = false;
+        safeMutexUnlock(&checkpointerPtr->mutex, "checkpointThreadStart");
+
+        writeCheckpointFile(checkpointerPtr, &checkpoint);
+    }
+
+    return NULL;
+}
+
+/**
+ * Make the output up to the given checkpoint durable, then replace the checkpoint file with one describing it. The new
+ * file is written beside the old one and renamed over it, so a crash leaves one or the other intact.
+ */
+static void writeCheckpointFile(
+    struct Hw4Checkpointer const * const checkpointerPtr,
+    struct Hw4Checkpoint const * const checkpointPtr
+) {
+    assert(checkpointerPtr != NULL);
+    assert(checkpointPtr != NULL);
+
+    safeSyncData(checkpointerPtr->outFileDescriptor, "writeCheckpointFile");
+
+    char * const checkpointText = formatString(
+        HW4_CHECKPOINT_FORMAT,
+        checkpointPtr->inputLength,
+        checkpointPtr->inputModifiedTimeNanoseconds,
+        checkpointPtr->inputOffset,
+        checkpointPtr->outputOffset,
+        checkpointPtr->outputChecksum
+    );
+    int const temporaryFileDescriptor = safeOpen(
+        checkpointerPtr->temporaryFilePath,
+        O_WRONLY | O_CREAT | O_TRUNC,
+        "writeCheckpointFile"
+    );
+    safeWrite(temporaryFileDescriptor, checkpointText, strlen(checkpointText), "writeCheckpointFile");
+    safeSyncData(temporaryFileDescriptor, "writeCheckpointFile");
+    safeClose(temporaryFileDescriptor, "writeCheckpointFile");
+    free(checkpointText);
+
+    safeRename(checkpointerPtr->temporaryFilePath, checkpointerPtr->filePath, "writeCheckpointFile");
+}
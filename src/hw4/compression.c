@@ -0,0 +1,281 @@
+#define _GNU_SOURCE
+
+#include "../../include/hw4/compression.h"
+
+#include "../../include/util/process.h"
+#include "../../include/util/file.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/types.h>
+
+#define COMPRESSION_MAGIC_MAX_LENGTH 4
+#define COMPRESSION_PEEK_RETRY_NANOSECONDS 1000000L
+
+/**
+ * A compressed stream format: how to recognize it, and the program arguments that compress and decompress it as a
+ * filter from standard input to standard output.
+ */
+struct CompressionTool {
+    enum Hw4Compression compression;
+    unsigned char magic[COMPRESSION_MAGIC_MAX_LENGTH];
+    size_t magicLength;
+    char *compressArguments[3];
+    char *decompressArguments[3];
+};
+
+static char gzipProgram[] = "gzip";
+static char zstdProgram[] = "zstd";
+static char lz4Program[] = "lz4";
+static char gzipCompressFlags[] = "-c";
+static char gzipDecompressFlags[] = "-dc";
+static char quietCompressFlags[] = "-cq";
+static char quietDecompressFlags[] = "-dcq";
+
+static struct CompressionTool const compressionTools[] = {
+    {
+        .compression = HW4_COMPRESSION_GZIP,
+        .magic = {0x1F, 0x8B},
+        .magicLength = 2,
+        .compressArguments = {gzipProgram, gzipCompressFlags, NULL},
+        .decompressArguments = {gzipProgram, gzipDecompressFlags, NULL}
+    },
+    {
+        .compression = HW4_COMPRESSION_ZSTD,
+        .magic = {0x28, 0xB5, 0x2F, 0xFD},
+        .magicLength = 4,
+        .compressArguments = {zstdProgram, quietCompressFlags, NULL},
+        .decompressArguments = {zstdProgram, quietDecompressFlags, NULL}
+    },
+    {
+        .compression = HW4_COMPRESSION_LZ4,
+        .magic = {0x04, 0x22, 0x4D, 0x18},
+        .magicLength = 4,
+        .compressArguments = {lz4Program, quietCompressFlags, NULL},
+        .decompressArguments = {lz4Program, quietDecompressFlags, NULL}
+    }
+};
+
+#define COMPRESSION_TOOL_COUNT (sizeof compressionTools / sizeof compressionTools[0])
+
+static struct CompressionTool const *findInputCompressionTool(int inFileDescriptor, char const *callerDescription);
+static size_t peekPipeMagic(
+    int inFileDescriptor,
+    unsigned char magic[COMPRESSION_MAGIC_MAX_LENGTH],
+    char const *callerDescription
+);
+static struct CompressionTool const *findCompressionToolByMagic(unsigned char const *magic, size_t magicLength);
+static bool isCompressionMagicPrefix(unsigned char const *magic, size_t magicLength);
+
+/**
+ * If the given input file starts with the magic of a known compressed format, start its decompressor reading from it.
+ * Decompression then runs in its own process, concurrently with parsing, which reads the decompressed bytes from
+ * stageOutPtr->fileDescriptor. Regular files, pipes, and FIFOs are checked, since their first bytes can be read without
+ * consuming them (pipes are peeked with tee), so the decompressor still reads the whole stream; other inputs, such as
+ * terminals and sockets, are read as they are.
+ *
+ * @param inFileDescriptor The input file descriptor, at the offset of the input's first byte. It must stay open until
+ *                         the stage is finished.
+ * @param stageOutPtr A pointer to the stage to start.
+ * @param callerDescription A description of the caller to be included in error messages. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns Whether the input is compressed and the stage was started.
+ */
+bool tryStartDecompressionStage(
+    int const inFileDescriptor,
+    struct CompressionStage * const stageOutPtr,
+    char const * const callerDescription
+) {
+    guardNotNull(stageOutPtr, "stageOutPtr", "tryStartDecompressionStage");
+    guardNotNull(callerDescription, "callerDescription", "tryStartDecompressionStage");
+
+    struct CompressionTool const * const toolPtr = findInputCompressionTool(inFileDescriptor, callerDescription);
+    if (toolPtr == NULL) {
+        return false;
+    }
+
+    int pipeFileDescriptors[2];
+    safePipe(pipeFileDescriptors, callerDescription);
+    *stageOutPtr = (struct CompressionStage){
+        .processId = safeSpawnFilter(
+            toolPtr->decompressArguments,
+            inFileDescriptor,
+            pipeFileDescriptors[1],
+            callerDescription
+        ),
+        .programName = toolPtr->decompressArguments[0],
+        .fileDescriptor = pipeFileDescriptors[0]
+    };
+    safeClose(pipeFileDescriptors[1], callerDescription);
+    return true;
+}
+
+/**
+ * Determine whether the given input file would be decompressed by tryStartDecompressionStage.
+ *
+ * @param inFileDescriptor The input file descriptor.
+ * @param callerDescription A description of the caller to be included in error messages. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns Whether the input is a regular file, pipe, or FIFO starting with the magic of a known compressed format.
+ */
+bool isCompressedInput(int const inFileDescriptor, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "isCompressedInput");
+
+    return findInputCompressionTool(inFileDescriptor, callerDescription) != NULL;
+}
+
+/**
+ * Start a compressor writing to the given output file. Compression then runs in its own process, concurrently with
+ * formatting, which writes the uncompressed bytes to stageOutPtr->fileDescriptor.
+ *
+ * @param compression The compression to apply. It must not be HW4_COMPRESSION_NONE.
+ * @param outFileDescriptor The output file descriptor. It must stay open until the stage is finished.
+ * @param stageOutPtr A pointer to the stage to start.
+ * @param callerDescription A description of the caller to be included in error messages. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void startCompressionStage(
+    enum Hw4Compression const compression,
+    int const outFileDescriptor,
+    struct CompressionStage * const stageOutPtr,
+    char const * const callerDescription
+) {
+    guardNotNull(stageOutPtr, "stageOutPtr", "startCompressionStage");
+    guardNotNull(callerDescription, "callerDescription", "startCompressionStage");
+
+    size_t toolIndex = 0;
+    while (toolIndex < COMPRESSION_TOOL_COUNT && compressionTools[toolIndex].compression != compression) {
+        toolIndex += 1;
+    }
+    guardFmt(toolIndex < COMPRESSION_TOOL_COUNT, "%s: Unknown compression: %d", callerDescription, (int)compression);
+    struct CompressionTool const * const toolPtr = &compressionTools[toolIndex];
+
+    int pipeFileDescriptors[2];
+    safePipe(pipeFileDescriptors, callerDescription);
+    *stageOutPtr = (struct CompressionStage){
+        .processId = safeSpawnFilter(
+            toolPtr->compressArguments,
+            pipeFileDescriptors[0],
+            outFileDescriptor,
+            callerDescription
+        ),
+        .programName = toolPtr->compressArguments[0],
+        .fileDescriptor = pipeFileDescriptors[1]
+    };
+    safeClose(pipeFileDescriptors[0], callerDescription);
+}
+
+/**
+ * Close our end of the stage's pipe and wait for its program to finish. For a compression stage, this flushes the
+ * compressed output; for a decompression stage, the input must have been read to its end. If the program failed,
+ * abort the program with an error message.
+ *
+ * @param stagePtr A pointer to the stage.
+ * @param callerDescription A description of the caller to be included in error messages. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void finishCompressionStage(struct CompressionStage * const stagePtr, char const * const callerDescription) {
+    guardNotNull(stagePtr, "stagePtr", "finishCompressionStage");
+    guardNotNull(callerDescription, "callerDescription", "finishCompressionStage");
+
+    safeClose(stagePtr->fileDescriptor, callerDescription);
+    safeWaitForSuccess(stagePtr->processId, stagePtr->programName, callerDescription);
+}
+
+/**
+ * Find the compressed format whose magic the given input file starts with. Only regular files, pipes, and FIFOs are
+ * checked.
+ *
+ * @returns A pointer to the format's tool, or NULL if the input is not compressed or cannot be checked.
+ */
+static struct CompressionTool const *findInputCompressionTool(
+    int const inFileDescriptor,
+    char const * const callerDescription
+) {
+    unsigned char magic[COMPRESSION_MAGIC_MAX_LENGTH];
+    size_t magicLength;
+    if (isRegularFile(inFileDescriptor, callerDescription)) {
+        unsigned long long const offset = safeTell(inFileDescriptor, callerDescription);
+        magicLength = safePread(inFileDescriptor, magic, sizeof magic, offset, callerDescription);
+    } else if (isPipe(inFileDescriptor, callerDescription)) {
+        magicLength = peekPipeMagic(inFileDescriptor, magic, callerDescription);
+    } else {
+        return NULL;
+    }
+    return findCompressionToolByMagic(magic, magicLength);
+}
+
+/**
+ * Peek at the first bytes of the given pipe without consuming them. A writer may not have written a whole magic yet,
+ * so while the bytes so far are only the start of a known magic, keep peeking until there are enough or the writers
+ * have closed the pipe.
+ *
+ * @returns The number of bytes peeked.
+ */
+static size_t peekPipeMagic(
+    int const inFileDescriptor,
+    unsigned char magic[COMPRESSION_MAGIC_MAX_LENGTH],
+    char const * const callerDescription
+) {
+    size_t magicLength = safePeekPipe(inFileDescriptor, magic, COMPRESSION_MAGIC_MAX_LENGTH, callerDescription);
+    while (
+        magicLength < COMPRESSION_MAGIC_MAX_LENGTH
+            && findCompressionToolByMagic(magic, magicLength) == NULL
+            && isCompressionMagicPrefix(magic, magicLength)
+    ) {
+        // The pipe is not empty, so poll returns at once; it only tells whether the writers are gone
+        struct pollfd pollEntry = { .fd = inFileDescriptor, .events = POLLIN, .revents = 0 };
+        bool const isWriterClosed = poll(&pollEntry, 1, 0) == 1 && (pollEntry.revents & POLLHUP) != 0;
+        if (!isWriterClosed) {
+            struct timespec const retryDelay = { .tv_sec = 0, .tv_nsec = COMPRESSION_PEEK_RETRY_NANOSECONDS };
+            nanosleep(&retryDelay, NULL);
+        }
+
+        magicLength = safePeekPipe(inFileDescriptor, magic, COMPRESSION_MAGIC_MAX_LENGTH, callerDescription);
+        if (isWriterClosed) {
+            break;
+        }
+    }
+    return magicLength;
+}
+
+/**
+ * Find the compressed format whose magic the given bytes start with.
+ *
+ * @returns A pointer to the format's tool, or NULL if there is none.
+ */
+static struct CompressionTool const *findCompressionToolByMagic(
+    unsigned char const * const magic,
+    size_t const magicLength
+) {
+    for (size_t toolIndex = 0; toolIndex < COMPRESSION_TOOL_COUNT; toolIndex += 1) {
+        struct CompressionTool const * const toolPtr = &compressionTools[toolIndex];
+        if (magicLength >= toolPtr->magicLength && memcmp(magic, toolPtr->magic, toolPtr->magicLength) == 0) {
+            return toolPtr;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Determine whether the given bytes are the start of, but shorter than, the magic of a known compressed format.
+ */
+static bool isCompressionMagicPrefix(unsigned char const * const magic, size_t const magicLength) {
+    if (magicLength == 0) {
+        return false;
+    }
+    for (size_t toolIndex = 0; toolIndex < COMPRESSION_TOOL_COUNT; toolIndex += 1) {
+        struct CompressionTool const * const toolPtr = &compressionTools[toolIndex];
+        if (magicLength < toolPtr->magicLength && memcmp(magic, toolPtr->magic, magicLength) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
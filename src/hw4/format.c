@@ -0,0 +1,211 @@
+#include "../../include/hw4/format.h"
+
+#include "../../include/hw4/binary.h"
+#include "../../include/hw4/varint.h"
+#include "../../include/util/integer.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Format the HW4 output for the given integers: each odd integer's line once, and each even integer's line twice. An
+ * even integer is formatted once and its line copied for the duplicate.
+ *
+ * @param integers The integers.
+ * @param count The number of integers.
+ * @param output The buffer into which to write. It must have room for `count * HW4_OUTPUT_MAX_LENGTH_PER_INTEGER`
+ *               characters. No string terminator is written.
+ *
+ * @returns The number of characters written.
+ */
+size_t formatHw4Output(int const * const integers, size_t const count, char * const output) {
+    guardNotNull(integers, "integers", "formatHw4Output");
+    guardNotNull(output, "output", "formatHw4Output");
+
+    char *outputCursor = output;
+    for (size_t integerIndex = 0; integerIndex < count; integerIndex += 1) {
+        int const integer = integers[integerIndex];
+        size_t const lineLength = formatIntegerLine(integer, outputCursor);
+        outputCursor += lineLength;
+
+        if (integer % 2 == 0) {
+            // Even, so write the value twice
+            memcpy(outputCursor, outputCursor - lineLength, lineLength);
+            outputCursor += lineLength;
+        }
+    }
+    return (size_t)(outputCursor - output);
+}
+
+/**
+ * Get the number of characters formatHw4Output would write for the given integers, without formatting them.
+ *
+ * @param integers The integers.
+ * @param count The number of integers.
+ *
+ * @returns The output length.
+ */
+size_t hw4OutputLength(int const * const integers, size_t const count) {
+    guardNotNull(integers, "integers", "hw4OutputLength");
+
+    size_t outputLength = 0;
+    for (size_t integerIndex = 0; integerIndex < count; integerIndex += 1) {
+        int const integer = integers[integerIndex];
+        size_t const lineLength = formattedIntegerLineLength(integer);
+        outputLength += integer % 2 == 0 ? lineLength * 2 : lineLength;
+    }
+    return outputLength;
+}
+
+/**
+ * Get the number of integers in the HW4 output for the given integers: one per odd integer, two per even integer.
+ *
+ * @param integers The integers.
+ * @param count The number of integers.
+ *
+ * @returns The output integer count.
+ */
+size_t hw4OutputCount(int const * const integers, size_t const count) {
+    guardNotNull(integers, "integers", "hw4OutputCount");
+
+    size_t outputCount = count;
+    for (size_t integerIndex = 0; integerIndex < count; integerIndex += 1) {
+        if (integers[integerIndex] % 2 == 0) {
+            outputCount += 1;
+        }
+    }
+    return outputCount;
+}
+
+/**
+ * Write the header that starts the output in the given format, if the format has one. Binary headers are written with
+ * an unknown count, to be filled in once the output is complete if the output can seek.
+ *
+ * @param format The output format.
+ * @param output The buffer into which to write. It must have room for HW4_OUTPUT_MAX_HEADER_LENGTH characters.
+ *
+ * @returns The number of characters written.
+ */
+size_t encodeHw4OutputHeader(enum Hw4Format const format, char * const output) {
+    guardNotNull(output, "output", "encodeHw4OutputHeader");
+
+    switch (format) {
+        case HW4_FORMAT_TEXT:
+            return 0;
+        case HW4_FORMAT_BINARY:
+            encodeHw4BinaryHeader(HW4_BINARY_COUNT_UNKNOWN, output);
+            return HW4_BINARY_HEADER_LENGTH;
+        case HW4_FORMAT_VARINT:
+            encodeHw4VarintHeader(output);
+            return HW4_VARINT_HEADER_LENGTH;
+        default:
+            abortWithErrorFmt("encodeHw4OutputHeader: Unknown format: %d", (int)format);
+            return 0;
+    }
+}
+
+/**
+ * Write the trailer that ends the output in the given format, if the format has one.
+ *
+ * @param format The output format.
+ * @param output The buffer into which to write. It must have room for HW4_OUTPUT_MAX_HEADER_LENGTH characters.
+ *
+ * @returns The number of characters written.
+ */
+size_t encodeHw4OutputTrailer(enum Hw4Format const format, char * const output) {
+    guardNotNull(output, "output", "encodeHw4OutputTrailer");
+
+    switch (format) {
+        case HW4_FORMAT_TEXT:
+        case HW4_FORMAT_BINARY:
+            return 0;
+        case HW4_FORMAT_VARINT:
+            return encodeHw4VarintTrailer(output);
+        default:
+            abortWithErrorFmt("encodeHw4OutputTrailer: Unknown format: %d", (int)format);
+            return 0;
+    }
+}
+
+/**
+ * Encode the HW4 output for the given integers in the given format: each odd integer once, and each even integer
+ * twice (see formatHw4Output).
+ *
+ * @param format The output format.
+ * @param integers The integers.
+ * @param count The number of integers.
+ * @param output The buffer into which to write. It must have room for `count * HW4_OUTPUT_MAX_LENGTH_PER_INTEGER`
+ *               characters.
+ *
+ * @returns The number of characters written.
+ */
+size_t encodeHw4Output(
+    enum Hw4Format const format,
+    int const * const integers,
+    size_t const count,
+    char * const output
+) {
+    guardNotNull(integers, "integers", "encodeHw4Output");
+    guardNotNull(output, "output", "encodeHw4Output");
+
+    switch (format) {
+        case HW4_FORMAT_TEXT:
+            return formatHw4Output(integers, count, output);
+        case HW4_FORMAT_BINARY: {
+            char *outputCursor = output;
+            for (size_t integerIndex = 0; integerIndex < count; integerIndex += 1) {
+                outputCursor += encodeHw4BinaryIntegers(&integers[integerIndex], 1, outputCursor);
+                if (integers[integerIndex] % 2 == 0) {
+                    memcpy(outputCursor, outputCursor - HW4_BINARY_INTEGER_LENGTH, HW4_BINARY_INTEGER_LENGTH);
+                    outputCursor += HW4_BINARY_INTEGER_LENGTH;
+                }
+            }
+            return (size_t)(outputCursor - output);
+        }
+        case HW4_FORMAT_VARINT:
+            return encodeHw4VarintFrame(integers, count, true, output);
+        default:
+            abortWithErrorFmt("encodeHw4Output: Unknown format: %d", (int)format);
+            return 0;
+    }
+}
+
+/**
+ * Encode the given integers in the given format, each exactly once. This is the output side of a format conversion.
+ *
+ * @param format The output format.
+ * @param integers The integers.
+ * @param count The number of integers.
+ * @param output The buffer into which to write. It must have room for `count * HW4_OUTPUT_MAX_LENGTH_PER_INTEGER`
+ *               characters.
+ *
+ * @returns The number of characters written.
+ */
+size_t encodeIntegers(
+    enum Hw4Format const format,
+    int const * const integers,
+    size_t const count,
+    char * const output
+) {
+    guardNotNull(integers, "integers", "encodeIntegers");
+    guardNotNull(output, "output", "encodeIntegers");
+
+    switch (format) {
+        case HW4_FORMAT_TEXT: {
+            char *outputCursor = output;
+            for (size_t integerIndex = 0; integerIndex < count; integerIndex += 1) {
+                outputCursor += formatIntegerLine(integers[integerIndex], outputCursor);
+            }
+            return (size_t)(outputCursor - output);
+        }
+        case HW4_FORMAT_BINARY:
+            return encodeHw4BinaryIntegers(integers, count, output);
+        case HW4_FORMAT_VARINT:
+            return encodeHw4VarintFrame(integers, count, false, output);
+        default:
+            abortWithErrorFmt("encodeIntegers: Unknown format: %d", (int)format);
+            return 0;
+    }
+}
@@ -0,0 +1,234 @@
+#define _GNU_SOURCE
+
+#include "../../include/hw4/instrument.h"
+
+#include "../../include/util/histogram.h"
+#include "../../include/util/file.h"
+#include "../../include/util/string.h"
+#include "../../include/util/memory.h"
+#include "../../include/util/guard.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define NANOSECONDS_PER_SECOND 1000000000LL
+#define NANOSECONDS_PER_MILLISECOND 1000000LL
+
+/**
+ * The capacity of a formatted report.
+ */
+#define HW4_STAGE_REPORT_CAPACITY 2048
+
+static void stageTimerInit(struct Hw4StageTimer *timerOutPtr, char const *name);
+static void reportStageStats(struct Hw4StageStats const *statsPtr, long long nowNanoseconds, bool isFinal);
+static size_t formatStageTimer(
+    struct Hw4StageTimer const *timerPtr,
+    char *report,
+    size_t reportCapacity
+);
+
+/**
+ * Create statistics for a pipeline stage, reading the report settings from the environment (see instrument.h).
+ *
+ * @param name The stage name, e.g., "reader".
+ * @param workName The name of the stage's work, e.g., "parse".
+ * @param waitName The name of what the stage waits for, e.g., "wait free".
+ *
+ * @returns The statistics, which the caller must pass to hw4StageStatsFinish.
+ */
+struct Hw4StageStats *hw4StageStatsCreate(
+    char const * const name,
+    char const * const workName,
+    char const * const waitName
+) {
+    guardNotNull(name, "name", "hw4StageStatsCreate");
+    guardNotNull(workName, "workName", "hw4StageStatsCreate");
+    guardNotNull(waitName, "waitName", "hw4StageStatsCreate");
+
+    // Several histograms: far too big for a thread's stack
+    struct Hw4StageStats * const statsPtr = safeMalloc(sizeof *statsPtr, "hw4StageStatsCreate");
+    statsPtr->name = name;
+    statsPtr->valueCount = 0;
+    statsPtr->byteCount = 0;
+    statsPtr->blockCount = 0;
+    stageTimerInit(&statsPtr->work, workName);
+    stageTimerInit(&statsPtr->wait, waitName);
+    stageTimerInit(&statsPtr->write, "write");
+
+    char const * const intervalText = getenv("HW4_INSTRUMENT_INTERVAL_MS");
+    long long const intervalMilliseconds = intervalText == NULL ? 0 : atoll(intervalText);
+    statsPtr->reportIntervalNanoseconds = intervalMilliseconds > 0
+        ? intervalMilliseconds * NANOSECONDS_PER_MILLISECOND
+        : 0;
+    statsPtr->reportFilePath = getenv("HW4_INSTRUMENT_FILE");
+    statsPtr->startNanoseconds = hw4StageStatsNow();
+    statsPtr->lastReportNanoseconds = statsPtr->startNanoseconds;
+    return statsPtr;
+}
+
+/**
+ * Get the current monotonic time, in nanoseconds.
+ */
+long long hw4StageStatsNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec;
+}
+
+/**
+ * Add the time since the given start to the given timer, as part of the current block.
+ *
+ * @param timerPtr A pointer to the timer.
+ * @param startNanoseconds The start time (see hw4StageStatsNow).
+ *
+ * @returns The current time, so consecutive activities can be timed with one clock read between them.
+ */
+long long hw4StageTimerStop(struct Hw4StageTimer * const timerPtr, long long const startNanoseconds) {
+    guardNotNull(timerPtr, "timerPtr", "hw4StageTimerStop");
+
+    long long const nowNanoseconds = hw4StageStatsNow();
+    unsigned long long const elapsedNanoseconds = (unsigned long long)(nowNanoseconds - startNanoseconds);
+    timerPtr->isUsed = true;
+    timerPtr->totalNanoseconds += elapsedNanoseconds;
+    timerPtr->blockNanoseconds += elapsedNanoseconds;
+    return nowNanoseconds;
+}
+
+/**
+ * Count a finished block, record its time in each timer's histogram, and report progress if the report interval has
+ * passed.
+ *
+ * @param statsPtr A pointer to the statistics.
+ * @param valueCount The number of values in the block.
+ * @param byteCount The number of bytes the block was read from or written as.
+ * @param nowNanoseconds The current time (see hw4StageStatsNow).
+ */
+void hw4StageStatsAddBlock(
+    struct Hw4StageStats * const statsPtr,
+    unsigned long long const valueCount,
+    unsigned long long const byteCount,
+    long long const nowNanoseconds
+) {
+    guardNotNull(statsPtr, "statsPtr", "hw4StageStatsAddBlock");
+
+    statsPtr->valueCount += valueCount;
+    statsPtr->byteCount += byteCount;
+    statsPtr->blockCount += 1;
+    struct Hw4StageTimer * const timers[] = { &statsPtr->work, &statsPtr->wait, &statsPtr->write };
+    for (size_t timerIndex = 0; timerIndex < sizeof timers / sizeof timers[0]; timerIndex += 1) {
+        if (timers[timerIndex]->isUsed) {
+            hdrHistogramRecord(&timers[timerIndex]->histogram, timers[timerIndex]->blockNanoseconds);
+            timers[timerIndex]->blockNanoseconds = 0;
+        }
+    }
+
+    if (
+        statsPtr->reportIntervalNanoseconds > 0
+        && nowNanoseconds - statsPtr->lastReportNanoseconds >= statsPtr->reportIntervalNanoseconds
+    ) {
+        reportStageStats(statsPtr, nowNanoseconds, false);
+        statsPtr->lastReportNanoseconds = nowNanoseconds;
+    }
+}
+
+/**
+ * Report the stage's totals and latency percentiles, and free the statistics.
+ *
+ * @param statsPtr A pointer to the statistics.
+ */
+void hw4StageStatsFinish(struct Hw4StageStats * const statsPtr) {
+    guardNotNull(statsPtr, "statsPtr", "hw4StageStatsFinish");
+
+    reportStageStats(statsPtr, hw4StageStatsNow(), true);
+    free(statsPtr);
+}
+
+static void stageTimerInit(struct Hw4StageTimer * const timerOutPtr, char const * const name) {
+    timerOutPtr->name = name;
+    timerOutPtr->isUsed = false;
+    timerOutPtr->totalNanoseconds = 0;
+    timerOutPtr->blockNanoseconds = 0;
+    hdrHistogramInit(&timerOutPtr->histogram);
+}
+
+/**
+ * Write a report with a single write(2), so reports from both stages never interleave within a line.
+ */
+static void reportStageStats(
+    struct Hw4StageStats const * const statsPtr,
+    long long const nowNanoseconds,
+    bool const isFinal
+) {
+    char * const report = safeMalloc(HW4_STAGE_REPORT_CAPACITY, "reportStageStats");
+    double const seconds = (double)(nowNanoseconds - statsPtr->startNanoseconds) / (double)NANOSECONDS_PER_SECOND;
+    size_t reportLength = safeSnprintf(
+        report,
+        HW4_STAGE_REPORT_CAPACITY,
+        "reportStageStats",
+        "hw4 %s%s: %llu values, %.1f MB, %llu blocks in %.3f s (%.1f MB/s, %.2f Mvalues/s)\n",
+        statsPtr->name,
+        isFinal ? "" : " (progress)",
+        statsPtr->valueCount,
+        (double)statsPtr->byteCount / 1000000,
+        statsPtr->blockCount,
+        seconds,
+        seconds > 0 ? (double)statsPtr->byteCount / 1000000 / seconds : 0,
+        seconds > 0 ? (double)statsPtr->valueCount / 1000000 / seconds : 0
+    );
+    if (isFinal) {
+        struct Hw4StageTimer const * const timers[] = { &statsPtr->work, &statsPtr->wait, &statsPtr->write };
+        for (size_t timerIndex = 0; timerIndex < sizeof timers / sizeof timers[0]; timerIndex += 1) {
+            if (timers[timerIndex]->isUsed) {
+                reportLength += formatStageTimer(
+                    timers[timerIndex],
+                    report + reportLength,
+                    HW4_STAGE_REPORT_CAPACITY - reportLength
+                );
+            }
+        }
+    }
+
+    int const fileDescriptor = statsPtr->reportFilePath == NULL
+        ? STDERR_FILENO
+        : safeOpen(statsPtr->reportFilePath, O_WRONLY | O_CREAT | O_APPEND, "reportStageStats");
+    safeWrite(fileDescriptor, report, reportLength, "reportStageStats");
+    if (fileDescriptor != STDERR_FILENO) {
+        safeClose(fileDescriptor, "reportStageStats");
+    }
+    free(report);
+}
+
+/**
+ * Format one line for a timer: its total, and the per-block mean and percentiles in microseconds.
+ *
+ * @returns The length of the line.
+ */
+static size_t formatStageTimer(
+    struct Hw4StageTimer const * const timerPtr,
+    char * const report,
+    size_t const reportCapacity
+) {
+    struct HdrHistogram const * const histogramPtr = &timerPtr->histogram;
+    unsigned long long const p50Nanoseconds = hdrHistogramValueAtPerMille(histogramPtr, 500);
+    unsigned long long const p90Nanoseconds = hdrHistogramValueAtPerMille(histogramPtr, 900);
+    unsigned long long const p99Nanoseconds = hdrHistogramValueAtPerMille(histogramPtr, 990);
+    unsigned long long const p999Nanoseconds = hdrHistogramValueAtPerMille(histogramPtr, 999);
+    return safeSnprintf(
+        report,
+        reportCapacity,
+        "formatStageTimer",
+        "  %-12s %8.3f s total; per block (us): mean %.1f, p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n",
+        timerPtr->name,
+        (double)timerPtr->totalNanoseconds / (double)NANOSECONDS_PER_SECOND,
+        hdrHistogramMean(histogramPtr) / 1000,
+        (double)p50Nanoseconds / 1000,
+        (double)p90Nanoseconds / 1000,
+        (double)p99Nanoseconds / 1000,
+        (double)p999Nanoseconds / 1000,
+        (double)histogramPtr->max / 1000
+    );
+}
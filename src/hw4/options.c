@@ -0,0 +1,145 @@
+#include "../../include/hw4/options.h"
+
+#include "../../include/util/guard.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * The command-line name of each mode, indexed by the mode.
+ */
+static char const * const modeNames[] = {
+    [HW4_MODE_PIPELINE] = "pipeline",
+    [HW4_MODE_PARALLEL] = "parallel",
+    [HW4_MODE_PARALLEL_PWRITE] = "pwrite",
+    [HW4_MODE_PASSTHROUGH] = "passthrough"
+};
+
+/**
+ * The command-line name of each format, indexed by the format.
+ */
+static char const * const formatNames[] = {
+    [HW4_FORMAT_TEXT] = "text",
+    [HW4_FORMAT_BINARY] = "binary",
+    [HW4_FORMAT_VARINT] = "varint"
+};
+
+/**
+ * The command-line name of each output compression, indexed by the compression.
+ */
+static char const * const compressionNames[] = {
+    [HW4_COMPRESSION_NONE] = "none",
+    [HW4_COMPRESSION_GZIP] = "gzip",
+    [HW4_COMPRESSION_ZSTD] = "zstd",
+    [HW4_COMPRESSION_LZ4] = "lz4"
+};
+
+/**
+ * Look up the mode with the given command-line name (see hw4ModeName).
+ *
+ * @param name The name.
+ * @param modeOutPtr A pointer to the memory where the mode should be stored if the name is known.
+ *
+ * @returns Whether the name is known.
+ */
+bool tryParseHw4Mode(char const * const name, enum Hw4Mode * const modeOutPtr) {
+    guardNotNull(name, "name", "tryParseHw4Mode");
+    guardNotNull(modeOutPtr, "modeOutPtr", "tryParseHw4Mode");
+
+    for (size_t modeIndex = 0; modeIndex < sizeof modeNames / sizeof modeNames[0]; modeIndex += 1) {
+        if (strcmp(name, modeNames[modeIndex]) == 0) {
+            *modeOutPtr = (enum Hw4Mode)modeIndex;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Get the command-line name of the given mode: "pipeline", "parallel", "pwrite", or "passthrough".
+ *
+ * @param mode The mode.
+ *
+ * @returns The name.
+ */
+char const *hw4ModeName(enum Hw4Mode const mode) {
+    guard((size_t)mode < sizeof modeNames / sizeof modeNames[0], "hw4ModeName: mode must be a valid mode");
+
+    return modeNames[mode];
+}
+
+/**
+ * Look up the format with the given command-line name (see hw4FormatName).
+ *
+ * @param name The name.
+ * @param formatOutPtr A pointer to the memory where the format should be stored if the name is known.
+ *
+ * @returns Whether the name is known.
+ */
+bool tryParseHw4Format(char const * const name, enum Hw4Format * const formatOutPtr) {
+    guardNotNull(name, "name", "tryParseHw4Format");
+    guardNotNull(formatOutPtr, "formatOutPtr", "tryParseHw4Format");
+
+    for (size_t formatIndex = 0; formatIndex < sizeof formatNames / sizeof formatNames[0]; formatIndex += 1) {
+        if (strcmp(name, formatNames[formatIndex]) == 0) {
+            *formatOutPtr = (enum Hw4Format)formatIndex;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Get the command-line name of the given format: "text", "binary", or "varint".
+ *
+ * @param format The format.
+ *
+ * @returns The name.
+ */
+char const *hw4FormatName(enum Hw4Format const format) {
+    guard((size_t)format < sizeof formatNames / sizeof formatNames[0], "hw4FormatName: format must be a valid format");
+
+    return formatNames[format];
+}
+
+/**
+ * Look up the output compression with the given command-line name (see hw4CompressionName).
+ *
+ * @param name The name.
+ * @param compressionOutPtr A pointer to the memory where the compression should be stored if the name is known.
+ *
+ * @returns Whether the name is known.
+ */
+bool tryParseHw4Compression(char const * const name, enum Hw4Compression * const compressionOutPtr) {
+    guardNotNull(name, "name", "tryParseHw4Compression");
+    guardNotNull(compressionOutPtr, "compressionOutPtr", "tryParseHw4Compression");
+
+    for (
+        size_t compressionIndex = 0;
+        compressionIndex < sizeof compressionNames / sizeof compressionNames[0];
+        compressionIndex += 1
+    ) {
+        if (strcmp(name, compressionNames[compressionIndex]) == 0) {
+            *compressionOutPtr = (enum Hw4Compression)compressionIndex;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Get the command-line name of the given output compression: "none", "gzip", "zstd", or "lz4".
+ *
+ * @param compression The compression.
+ *
+ * @returns The name.
+ */
+char const *hw4CompressionName(enum Hw4Compression const compression) {
+    guard(
+        (size_t)compression < sizeof compressionNames / sizeof compressionNames[0],
+        "hw4CompressionName: compression must be a valid compression"
+    );
+
+    return compressionNames[compression];
+}
@@ -0,0 +1,412 @@
+#include "../../include/hw4/parallel.h"
+
+#include "../../include/hw4/format.h"
+#include "../../include/util/thread.h"
+#include "../../include/util/file.h"
+#include "../../include/util/integer.h"
+#include "../../include/util/memory.h"
+#include "../../include/util/guard.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <assert.h>
+
+/**
+ * The number of chunks per worker thread that hw4ParallelPwrite measures and writes at a time. More chunks per window
+ * leave workers idle at the end of each pass less often, but keep more parsed integers alive at once.
+ */
+#define PWRITE_WINDOW_CHUNKS_PER_THREAD 4
+
+struct ParallelJob;
+
+/**
+ * A slot for one chunk of input in flight. A worker parses and formats the chunk into the slot's output buffer; the
+ * writer then writes the output and reuses the slot for a later chunk.
+ */
+struct ParallelChunk {
+    struct ParallelJob *jobPtr;
+    size_t inputStartOffset;
+    size_t inputEndOffset;
+
+    int *integers;
+    char *output;
+    size_t outputCapacity;
+    size_t outputLength;
+
+    bool isDone;
+};
+
+struct PwriteJob;
+
+/**
+ * A slot for one chunk of input in hw4ParallelPwrite's current window. The chunk's integers are kept between measuring
+ * its output length and writing its output, so the input is only parsed once; the slot's integer buffer is reused by
+ * the chunks of later windows.
+ */
+struct PwriteChunk {
+    struct PwriteJob *jobPtr;
+    size_t inputStartOffset;
+    size_t inputEndOffset;
+
+    int *integers;
+    size_t integerCapacity;
+    size_t integerCount;
+    size_t outputLength;
+    unsigned long long outputOffset;
+};
+
+struct ParallelJob {
+    struct MappedFile const *mappedInputPtr;
+    size_t blockCapacity;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t chunkDoneCondition;
+};
+
+struct PwriteJob {
+    struct MappedFile const *mappedInputPtr;
+    int outFileDescriptor;
+    size_t blockCapacity;
+
+    size_t remainingChunkCount;
+    pthread_mutex_t mutex;
+    pthread_cond_t allChunksDoneCondition;
+};
+
+static size_t findChunkBoundary(struct MappedFile const *mappedInputPtr, size_t offset);
+static void parallelChunkTask(void *chunkAsVoidPtr);
+static void runPwriteChunkTasks(
+    struct PwriteJob *jobPtr,
+    struct PwriteChunk *chunks,
+    size_t chunkCount,
+    ThreadPoolTaskRoutine routine,
+    struct ThreadPool *poolPtr
+);
+static void finishPwriteChunkTask(struct PwriteJob *jobPtr);
+static void measurePwriteChunkTask(void *chunkAsVoidPtr);
+static void writePwriteChunkTask(void *chunkAsVoidPtr);
+
+/**
+ * Run CSCI 451 HW4 across a pool of worker threads. The mapped input is split into chunks of about
+ * `options->chunkSize` bytes, each ending just after a newline. Workers parse and format chunks independently; the
+ * calling thread writes each chunk's output in input order, so the output is byte-identical to the two-thread
+ * pipeline's. At most two chunks per worker are in flight at once, which bounds memory use.
+ *
+ * @param mappedInputPtr A pointer to the mapped input file.
+ * @param outFileDescriptor The output file descriptor, open for writing.
+ * @param options The options.
+ * @param poolPtr A pointer to the thread pool to run chunks on.
+ */
+void hw4Parallel(
+    struct MappedFile const * const mappedInputPtr,
+    int const outFileDescriptor,
+    struct Hw4Options const * const options,
+    struct ThreadPool * const poolPtr
+) {
+    guardNotNull(mappedInputPtr, "mappedInputPtr", "hw4Parallel");
+    guardNotNull(options, "options", "hw4Parallel");
+    guardNotNull(poolPtr, "poolPtr", "hw4Parallel");
+    guard(options->chunkSize > 0, "hw4Parallel: options->chunkSize must be positive");
+
+    struct ParallelJob job = {
+        .mappedInputPtr = mappedInputPtr,
+        .blockCapacity = options->blockCapacity
+    };
+    safeMutexInit(&job.mutex, NULL, "hw4Parallel");
+    safeConditionInit(&job.chunkDoneCondition, NULL, "hw4Parallel");
+
+    size_t const chunkSlotCount = poolPtr->threadCount * 2;
+    struct ParallelChunk * const chunkSlots = safeMalloc(sizeof *chunkSlots * chunkSlotCount, "hw4Parallel");
+    for (size_t slotIndex = 0; slotIndex < chunkSlotCount; slotIndex += 1) {
+        chunkSlots[slotIndex] = (struct ParallelChunk){
+            .jobPtr = &job,
+            .integers = safeMalloc(sizeof *chunkSlots[slotIndex].integers * options->blockCapacity, "hw4Parallel"),
+            .output = NULL,
+            .outputCapacity = 0
+        };
+    }
+
+    // Fill every slot, then write chunks in order, refilling each slot as soon as its chunk is written
+    size_t nextInputOffset = 0;
+    size_t submittedChunkCount = 0;
+    while (submittedChunkCount < chunkSlotCount && nextInputOffset < mappedInputPtr->length) {
+        struct ParallelChunk * const chunkPtr = &chunkSlots[submittedChunkCount];
+        chunkPtr->inputStartOffset = nextInputOffset;
+        chunkPtr->inputEndOffset = findChunkBoundary(mappedInputPtr, nextInputOffset + options->chunkSize);
+        chunkPtr->isDone = false;
+        nextInputOffset = chunkPtr->inputEndOffset;
+
+        threadPoolSubmit(poolPtr, parallelChunkTask, chunkPtr);
+        submittedChunkCount += 1;
+    }
+
+    for (size_t writtenChunkCount = 0; writtenChunkCount < submittedChunkCount; writtenChunkCount += 1) {
+        struct ParallelChunk * const chunkPtr = &chunkSlots[writtenChunkCount % chunkSlotCount];
+
+        safeMutexLock(&job.mutex, "hw4Parallel");
+        while (!chunkPtr->isDone) {
+            safeConditionWait(&job.chunkDoneCondition, &job.mutex, "hw4Parallel");
+        }
+        safeMutexUnlock(&job.mutex, "hw4Parallel");
+
+        if (chunkPtr->outputLength > 0) {
+            safeWrite(outFileDescriptor, chunkPtr->output, chunkPtr->outputLength, "hw4Parallel");
+        }
+
+        if (nextInputOffset < mappedInputPtr->length) {
+            chunkPtr->inputStartOffset = nextInputOffset;
+            chunkPtr->inputEndOffset = findChunkBoundary(mappedInputPtr, nextInputOffset + options->chunkSize);
+            chunkPtr->isDone = false;
+            nextInputOffset = chunkPtr->inputEndOffset;
+
+            threadPoolSubmit(poolPtr, parallelChunkTask, chunkPtr);
+            submittedChunkCount += 1;
+        }
+    }
+
+    for (size_t slotIndex = 0; slotIndex < chunkSlotCount; slotIndex += 1) {
+        free(chunkSlots[slotIndex].integers);
+        free(chunkSlots[slotIndex].output);
+    }
+    free(chunkSlots);
+
+    safeMutexDestroy(&job.mutex, "hw4Parallel");
+    safeConditionDestroy(&job.chunkDoneCondition, "hw4Parallel");
+}
+
+/**
+ * Run CSCI 451 HW4 across a pool of worker threads, with every worker writing its own output. The input is split into
+ * chunks of about `options->chunkSize` bytes, which go through two passes a window of a few chunks per worker at a
+ * time. First, workers parse each chunk of the window and compute its output length. A running prefix sum over those
+ * lengths then gives each chunk's final offset in the output file, which is preallocated up to the end of the window.
+ * Second, workers format each chunk and write it straight to its offset with pwrite, so there is no single writing
+ * thread to serialize on. Only the window's parsed integers are held between the passes, however large the input.
+ *
+ * @param mappedInputPtr A pointer to the mapped input file.
+ * @param outFileDescriptor The output file descriptor, open for writing. It must refer to a regular file.
+ * @param options The options.
+ * @param poolPtr A pointer to the thread pool to run chunks on.
+ */
+void hw4ParallelPwrite(
+    struct MappedFile const * const mappedInputPtr,
+    int const outFileDescriptor,
+    struct Hw4Options const * const options,
+    struct ThreadPool * const poolPtr
+) {
+    guardNotNull(mappedInputPtr, "mappedInputPtr", "hw4ParallelPwrite");
+    guardNotNull(options, "options", "hw4ParallelPwrite");
+    guardNotNull(poolPtr, "poolPtr", "hw4ParallelPwrite");
+    guard(options->chunkSize > 0, "hw4ParallelPwrite: options->chunkSize must be positive");
+
+    struct PwriteJob job = {
+        .mappedInputPtr = mappedInputPtr,
+        .outFileDescriptor = outFileDescriptor,
+        .blockCapacity = options->blockCapacity,
+        .remainingChunkCount = 0
+    };
+    safeMutexInit(&job.mutex, NULL, "hw4ParallelPwrite");
+    safeConditionInit(&job.allChunksDoneCondition, NULL, "hw4ParallelPwrite");
+
+    size_t const windowChunkCapacity = poolPtr->threadCount * PWRITE_WINDOW_CHUNKS_PER_THREAD;
+    struct PwriteChunk * const chunks = safeMalloc(sizeof *chunks * windowChunkCapacity, "hw4ParallelPwrite");
+    for (size_t chunkIndex = 0; chunkIndex < windowChunkCapacity; chunkIndex += 1) {
+        chunks[chunkIndex] = (struct PwriteChunk){
+            .jobPtr = &job,
+            .integers = NULL,
+            .integerCapacity = 0,
+            .integerCount = 0
+        };
+    }
+
+    size_t inputOffset = 0;
+    unsigned long long outputOffset = 0;
+    while (inputOffset < mappedInputPtr->length) {
+        size_t chunkCount = 0;
+        while (chunkCount < windowChunkCapacity && inputOffset < mappedInputPtr->length) {
+            struct PwriteChunk * const chunkPtr = &chunks[chunkCount];
+            chunkPtr->inputStartOffset = inputOffset;
+            chunkPtr->inputEndOffset = findChunkBoundary(mappedInputPtr, inputOffset + options->chunkSize);
+            inputOffset = chunkPtr->inputEndOffset;
+            chunkCount += 1;
+        }
+
+        runPwriteChunkTasks(&job, chunks, chunkCount, measurePwriteChunkTask, poolPtr);
+
+        for (size_t chunkIndex = 0; chunkIndex < chunkCount; chunkIndex += 1) {
+            chunks[chunkIndex].outputOffset = outputOffset;
+            outputOffset += chunks[chunkIndex].outputLength;
+        }
+        safePreallocate(outFileDescriptor, outputOffset, "hw4ParallelPwrite");
+
+        runPwriteChunkTasks(&job, chunks, chunkCount, writePwriteChunkTask, poolPtr);
+    }
+
+    for (size_t chunkIndex = 0; chunkIndex < windowChunkCapacity; chunkIndex += 1) {
+        free(chunks[chunkIndex].integers);
+    }
+    free(chunks);
+
+    safeMutexDestroy(&job.mutex, "hw4ParallelPwrite");
+    safeConditionDestroy(&job.allChunksDoneCondition, "hw4ParallelPwrite");
+}
+
+/**
+ * Find where the chunk containing the given nominal end offset should actually end: just after the next newline, so no
+ * integer is split across chunks.
+ *
+ * @returns The chunk end offset.
+ */
+static size_t findChunkBoundary(struct MappedFile const * const mappedInputPtr, size_t const offset) {
+    if (offset >= mappedInputPtr->length) {
+        return mappedInputPtr->length;
+    }
+
+    char const * const newline = memchr(mappedInputPtr->bytes + offset, '\n', mappedInputPtr->length - offset);
+    if (newline == NULL) {
+        return mappedInputPtr->length;
+    }
+    return (size_t)(newline - mappedInputPtr->bytes) + 1;
+}
+
+static void parallelChunkTask(void * const chunkAsVoidPtr) {
+    assert(chunkAsVoidPtr != NULL);
+    struct ParallelChunk * const chunkPtr = chunkAsVoidPtr;
+    struct ParallelJob * const jobPtr = chunkPtr->jobPtr;
+
+    char const * const mappedStart = jobPtr->mappedInputPtr->bytes;
+    char const *cursor = mappedStart + chunkPtr->inputStartOffset;
+    char const * const end = mappedStart + chunkPtr->inputEndOffset;
+
+    chunkPtr->outputLength = 0;
+    while (true) {
+        size_t const count = parseIntegerLinesExact(
+            mappedStart,
+            &cursor,
+            end,
+            chunkPtr->integers,
+            jobPtr->blockCapacity,
+            "parallelChunkTask"
+        );
+
+        // A chunk of blank lines has no output, and its slot may have no output buffer yet
+        if (count > 0) {
+            size_t const maxOutputLength = chunkPtr->outputLength + count * HW4_OUTPUT_MAX_LENGTH_PER_INTEGER;
+            if (maxOutputLength > chunkPtr->outputCapacity) {
+                chunkPtr->outputCapacity = maxOutputLength * 2;
+                chunkPtr->output = safeRealloc(chunkPtr->output, chunkPtr->outputCapacity, "parallelChunkTask");
+            }
+            chunkPtr->outputLength += formatHw4Output(
+                chunkPtr->integers,
+                count,
+                chunkPtr->output + chunkPtr->outputLength
+            );
+        }
+
+        if (count < jobPtr->blockCapacity) {
+            break;
+        }
+    }
+
+    safeMutexLock(&jobPtr->mutex, "parallelChunkTask");
+    chunkPtr->isDone = true;
+    safeConditionSignal(&jobPtr->chunkDoneCondition, "parallelChunkTask");
+    safeMutexUnlock(&jobPtr->mutex, "parallelChunkTask");
+}
+
+/**
+ * Run the given routine on every chunk using the pool and wait for all of them to finish.
+ */
+static void runPwriteChunkTasks(
+    struct PwriteJob * const jobPtr,
+    struct PwriteChunk * const chunks,
+    size_t const chunkCount,
+    ThreadPoolTaskRoutine const routine,
+    struct ThreadPool * const poolPtr
+) {
+    assert(jobPtr != NULL);
+    assert(chunks != NULL);
+
+    safeMutexLock(&jobPtr->mutex, "runPwriteChunkTasks");
+    jobPtr->remainingChunkCount = chunkCount;
+    safeMutexUnlock(&jobPtr->mutex, "runPwriteChunkTasks");
+
+    for (size_t chunkIndex = 0; chunkIndex < chunkCount; chunkIndex += 1) {
+        threadPoolSubmit(poolPtr, routine, &chunks[chunkIndex]);
+    }
+
+    safeMutexLock(&jobPtr->mutex, "runPwriteChunkTasks");
+    while (jobPtr->remainingChunkCount > 0) {
+        safeConditionWait(&jobPtr->allChunksDoneCondition, &jobPtr->mutex, "runPwriteChunkTasks");
+    }
+    safeMutexUnlock(&jobPtr->mutex, "runPwriteChunkTasks");
+}
+
+static void finishPwriteChunkTask(struct PwriteJob * const jobPtr) {
+    assert(jobPtr != NULL);
+
+    safeMutexLock(&jobPtr->mutex, "finishPwriteChunkTask");
+    jobPtr->remainingChunkCount -= 1;
+    if (jobPtr->remainingChunkCount == 0) {
+        safeConditionSignal(&jobPtr->allChunksDoneCondition, "finishPwriteChunkTask");
+    }
+    safeMutexUnlock(&jobPtr->mutex, "finishPwriteChunkTask");
+}
+
+static void measurePwriteChunkTask(void * const chunkAsVoidPtr) {
+    assert(chunkAsVoidPtr != NULL);
+    struct PwriteChunk * const chunkPtr = chunkAsVoidPtr;
+    struct PwriteJob * const jobPtr = chunkPtr->jobPtr;
+
+    char const * const mappedStart = jobPtr->mappedInputPtr->bytes;
+    char const *cursor = mappedStart + chunkPtr->inputStartOffset;
+    char const * const end = mappedStart + chunkPtr->inputEndOffset;
+
+    chunkPtr->integerCount = 0;
+    while (true) {
+        if (chunkPtr->integerCapacity - chunkPtr->integerCount < jobPtr->blockCapacity) {
+            chunkPtr->integerCapacity = (chunkPtr->integerCount + jobPtr->blockCapacity) * 2;
+            chunkPtr->integers = safeRealloc(
+                chunkPtr->integers,
+                sizeof *chunkPtr->integers * chunkPtr->integerCapacity,
+                "measurePwriteChunkTask"
+            );
+        }
+
+        size_t const count = parseIntegerLinesExact(
+            mappedStart,
+            &cursor,
+            end,
+            chunkPtr->integers + chunkPtr->integerCount,
+            jobPtr->blockCapacity,
+            "measurePwriteChunkTask"
+        );
+        chunkPtr->integerCount += count;
+
+        if (count < jobPtr->blockCapacity) {
+            break;
+        }
+    }
+    chunkPtr->outputLength = hw4OutputLength(chunkPtr->integers, chunkPtr->integerCount);
+
+    finishPwriteChunkTask(jobPtr);
+}
+
+static void writePwriteChunkTask(void * const chunkAsVoidPtr) {
+    assert(chunkAsVoidPtr != NULL);
+    struct PwriteChunk * const chunkPtr = chunkAsVoidPtr;
+    struct PwriteJob * const jobPtr = chunkPtr->jobPtr;
+
+    if (chunkPtr->outputLength > 0) {
+        // The output length is exact, and formatting never writes past the end of the last line
+        char * const output = safeMalloc(chunkPtr->outputLength, "writePwriteChunkTask");
+        size_t const outputLength = formatHw4Output(chunkPtr->integers, chunkPtr->integerCount, output);
+        assert(outputLength == chunkPtr->outputLength);
+
+        safePwrite(jobPtr->outFileDescriptor, output, outputLength, chunkPtr->outputOffset, "writePwriteChunkTask");
+        free(output);
+    }
+
+    finishPwriteChunkTask(jobPtr);
+}
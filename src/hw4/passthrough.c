@@ -0,0 +1,232 @@
+#include "../../include/hw4/passthrough.h"
+
+#include "../../include/hw4/format.h"
+#include "../../include/util/thread.h"
+#include "../../include/util/file.h"
+#include "../../include/util/integer.h"
+#include "../../include/util/memory.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <assert.h>
+
+enum OutputRunKind {
+    /** A run of canonical odd lines, written once straight from the input. */
+    OUTPUT_RUN_KIND_COPY_ONCE,
+    /** A canonical even line, written twice straight from the input. */
+    OUTPUT_RUN_KIND_COPY_TWICE,
+    /** A non-canonical line, whose integer must be formatted. */
+    OUTPUT_RUN_KIND_FORMAT
+};
+
+/**
+ * A piece of output described in terms of the input, so the writing thread can assemble it without re-formatting.
+ */
+struct OutputRun {
+    enum OutputRunKind kind;
+    int integer;
+    size_t inputOffset;
+    size_t length;
+};
+
+struct OutputRunBlock {
+    size_t count;
+    struct OutputRun runs[];
+};
+
+struct ScanLinesThreadStartArg {
+    struct MappedFile const *mappedInputPtr;
+    size_t blockCapacity;
+    struct SpscQueue *filledBlockQueuePtr;
+    struct SpscQueue *freeBlockQueuePtr;
+};
+
+struct AssembleOutputThreadStartArg {
+    struct MappedFile const *mappedInputPtr;
+    int outFileDescriptor;
+    size_t scratchCapacity;
+    struct SpscQueue *filledBlockQueuePtr;
+    struct SpscQueue *freeBlockQueuePtr;
+};
+
+static void *scanLinesThreadStart(void *argAsVoidPtr);
+static void *assembleOutputThreadStart(void *argAsVoidPtr);
+
+/**
+ * Run CSCI 451 HW4 without re-formatting canonical input lines. A line is canonical when its bytes are exactly what
+ * formatting its integer would produce: no sign other than a leading '-', no leading zeros, no extra whitespace, and a
+ * '\n' terminator. Such a line's output is a copy of its input, once for an odd integer and twice for an even one.
+ *
+ * A scanning thread parses the mapped input into blocks of output runs, merging adjacent canonical odd lines into one
+ * run. An assembling thread turns each run into iovecs pointing into the mapping (a single iovec for a run of odd
+ * lines, two for an even line; adjacent ones merge) and writes them with writev, up to IOV_MAX at a time. Only
+ * non-canonical lines are formatted, into the assembling thread's scratch buffer. Blocks are passed and recycled
+ * through lock-free queues as in the pipeline mode.
+ *
+ * @param mappedInputPtr A pointer to the mapped input file. It must stay mapped until this returns.
+ * @param outFileDescriptor The output file descriptor, open for writing.
+ * @param options The options.
+ */
+void hw4Passthrough(
+    struct MappedFile const * const mappedInputPtr,
+    int const outFileDescriptor,
+    struct Hw4Options const * const options
+) {
+    guardNotNull(mappedInputPtr, "mappedInputPtr", "hw4Passthrough");
+    guardNotNull(options, "options", "hw4Passthrough");
+
+    struct SpscQueue filledBlockQueue;
+    spscQueueInit(&filledBlockQueue, options->blockCount, sizeof (struct OutputRunBlock *), "hw4Passthrough");
+    struct SpscQueue freeBlockQueue;
+    spscQueueInit(&freeBlockQueue, options->blockCount, sizeof (struct OutputRunBlock *), "hw4Passthrough");
+
+    struct OutputRunBlock ** const blocks = safeMalloc(sizeof *blocks * options->blockCount, "hw4Passthrough");
+    for (size_t blockIndex = 0; blockIndex < options->blockCount; blockIndex += 1) {
+        blocks[blockIndex] = safeMalloc(
+            sizeof *blocks[blockIndex] + sizeof blocks[blockIndex]->runs[0] * options->blockCapacity,
+            "hw4Passthrough"
+        );
+        spscQueuePush(&freeBlockQueue, &blocks[blockIndex]);
+    }
+
+    pthread_t const scanLinesThreadId = safePthreadCreate(
+        NULL,
+        scanLinesThreadStart,
+        &(struct ScanLinesThreadStartArg){
+            .mappedInputPtr = mappedInputPtr,
+            .blockCapacity = options->blockCapacity,
+            .filledBlockQueuePtr = &filledBlockQueue,
+            .freeBlockQueuePtr = &freeBlockQueue
+        },
+        "hw4Passthrough"
+    );
+    pthread_t const assembleOutputThreadId = safePthreadCreate(
+        NULL,
+        assembleOutputThreadStart,
+        &(struct AssembleOutputThreadStartArg){
+            .mappedInputPtr = mappedInputPtr,
+            .outFileDescriptor = outFileDescriptor,
+            .scratchCapacity = options->writeBufferCapacity,
+            .filledBlockQueuePtr = &filledBlockQueue,
+            .freeBlockQueuePtr = &freeBlockQueue
+        },
+        "hw4Passthrough"
+    );
+
+    safePthreadJoin(scanLinesThreadId, "hw4Passthrough");
+    safePthreadJoin(assembleOutputThreadId, "hw4Passthrough");
+
+    for (size_t blockIndex = 0; blockIndex < options->blockCount; blockIndex += 1) {
+        free(blocks[blockIndex]);
+    }
+    free(blocks);
+
+    spscQueueDestroy(&filledBlockQueue);
+    spscQueueDestroy(&freeBlockQueue);
+}
+
+static void *scanLinesThreadStart(void * const argAsVoidPtr) {
+    assert(argAsVoidPtr != NULL);
+    struct ScanLinesThreadStartArg const * const argPtr = argAsVoidPtr;
+
+    char const * const inputStart = argPtr->mappedInputPtr->bytes;
+    char const * const inputEnd = inputStart + argPtr->mappedInputPtr->length;
+    char const *cursor = inputStart;
+
+    bool isEndOfInput = false;
+    while (!isEndOfInput) {
+        struct OutputRunBlock *block;
+        spscQueuePop(argPtr->freeBlockQueuePtr, &block);
+
+        size_t count = 0;
+        while (count < argPtr->blockCapacity) {
+            char const * const lineStart = cursor;
+            int integer;
+            if (!parseIntegerLineExact(inputStart, &cursor, inputEnd, &integer, "scanLinesThreadStart")) {
+                isEndOfInput = true;
+                break;
+            }
+
+            size_t const inputOffset = (size_t)(lineStart - inputStart);
+            size_t const lineLength = (size_t)(cursor - lineStart);
+            bool const isCanonical = lineLength == formattedIntegerLineLength(integer) && cursor[-1] == '\n';
+            bool const isOdd = integer % 2 != 0;
+
+            if (isCanonical && isOdd && count > 0) {
+                // Extend the previous run of odd lines, if it ends where this line starts
+                struct OutputRun * const previousRunPtr = &block->runs[count - 1];
+                bool const isContiguous = previousRunPtr->inputOffset + previousRunPtr->length == inputOffset;
+                if (previousRunPtr->kind == OUTPUT_RUN_KIND_COPY_ONCE && isContiguous) {
+                    previousRunPtr->length += lineLength;
+                    continue;
+                }
+            }
+
+            enum OutputRunKind kind = OUTPUT_RUN_KIND_FORMAT;
+            if (isCanonical) {
+                kind = isOdd ? OUTPUT_RUN_KIND_COPY_ONCE : OUTPUT_RUN_KIND_COPY_TWICE;
+            }
+            block->runs[count] = (struct OutputRun){
+                .kind = kind,
+                .integer = integer,
+                .inputOffset = inputOffset,
+                .length = lineLength
+            };
+            count += 1;
+        }
+
+        if (count == 0) {
+            // The block is freed with the rest; it cannot go back on the free queue, which only the other thread pushes
+            break;
+        }
+        block->count = count;
+        spscQueuePush(argPtr->filledBlockQueuePtr, &block);
+    }
+    spscQueueClose(argPtr->filledBlockQueuePtr);
+
+    return NULL;
+}
+
+static void *assembleOutputThreadStart(void * const argAsVoidPtr) {
+    assert(argAsVoidPtr != NULL);
+    struct AssembleOutputThreadStartArg const * const argPtr = argAsVoidPtr;
+
+    char const * const inputStart = argPtr->mappedInputPtr->bytes;
+
+    struct IovecWriter writer;
+    iovecWriterInit(&writer, argPtr->outFileDescriptor, argPtr->scratchCapacity, "assembleOutputThreadStart");
+
+    struct OutputRunBlock *block;
+    while (spscQueuePop(argPtr->filledBlockQueuePtr, &block)) {
+        for (size_t runIndex = 0; runIndex < block->count; runIndex += 1) {
+            struct OutputRun const * const runPtr = &block->runs[runIndex];
+            switch (runPtr->kind) {
+                case OUTPUT_RUN_KIND_COPY_ONCE:
+                    iovecWriterAppend(&writer, inputStart + runPtr->inputOffset, runPtr->length);
+                    break;
+                case OUTPUT_RUN_KIND_COPY_TWICE:
+                    iovecWriterAppend(&writer, inputStart + runPtr->inputOffset, runPtr->length);
+                    iovecWriterAppend(&writer, inputStart + runPtr->inputOffset, runPtr->length);
+                    break;
+                case OUTPUT_RUN_KIND_FORMAT: {
+                    char * const output = iovecWriterReserveScratch(&writer, HW4_OUTPUT_MAX_LENGTH_PER_INTEGER);
+                    iovecWriterCommitScratch(&writer, formatHw4Output(&runPtr->integer, 1, output));
+                    break;
+                }
+                default:
+                    abortWithErrorFmt("assembleOutputThreadStart: Unknown output run kind: %d", (int)runPtr->kind);
+            }
+        }
+
+        // The runs only point into the mapping, which outlives the writer, so the block can be recycled right away
+        spscQueuePush(argPtr->freeBlockQueuePtr, &block);
+    }
+
+    iovecWriterDestroy(&writer);
+
+    return NULL;
+}
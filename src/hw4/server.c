@@ -0,0 +1,185 @@
+#define _GNU_SOURCE
+
+#include "../../include/hw4.h"
+
+#include "../../include/hw4/batch.h"
+#include "../../include/util/socket.h"
+#include "../../include/util/thread.h"
+#include "../../include/util/file.h"
+#include "../../include/util/string.h"
+#include "../../include/util/memory.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <malloc.h>
+#include <unistd.h>
+
+/**
+ * The largest allocation served from the heap rather than its own mapping: glibc's maximum, so freed buffers of up to
+ * this size stay in the heap, already faulted in, for the next request.
+ */
+#define HW4_SERVER_MMAP_THRESHOLD (32 * 1024 * 1024)
+
+static char *checkServerRequest(struct Hw4BatchEntry const *entries, size_t entryCount);
+
+/**
+ * Serve CSCI 451 HW4 requests on a Unix domain socket, forever. Each connection carries one request: a batch manifest
+ * (see hw4BatchManifest) whose paths are all absolute, ended by the client shutting down its side. The pairs are run
+ * as with hw4Batch, and the server then replies with one line, "OK <pair count>" or "ERROR <message>", and closes the
+ * connection. Connections are served one at a time; the listen backlog holds the rest.
+ *
+ * Unlike hw4Batch, the worker pool is started once and kept for every request, and freed buffers are kept in the heap
+ * rather than returned to the system, so a request pays for neither thread creation nor fresh page faults. A request
+ * whose manifest is malformed, or whose paths are relative or unreadable, is rejected with an error reply; other
+ * errors (e.g., a write failure) abort the server as they would any hw4 call.
+ *
+ * @param socketPath The path at which to listen. A socket file left there by an earlier server is replaced.
+ * @param options The options for every request.
+ */
+void hw4Serve(char const * const socketPath, struct Hw4Options const * const options) {
+    guardNotNull(socketPath, "socketPath", "hw4Serve");
+    guardNotNull(options, "options", "hw4Serve");
+
+    // Best effort: without these, large freed buffers would be unmapped and their pages faulted in again next time
+    mallopt(M_MMAP_THRESHOLD, HW4_SERVER_MMAP_THRESHOLD);
+    mallopt(M_TRIM_THRESHOLD, HW4_SERVER_MMAP_THRESHOLD * 4);
+
+    struct ThreadPool pool;
+    threadPoolInit(&pool, options->threadCount, "hw4Serve");
+
+    int const listenFileDescriptor = safeListenUnix(socketPath, "hw4Serve");
+    while (true) {
+        int const connectionFileDescriptor = safeAcceptUnix(listenFileDescriptor, "hw4Serve");
+
+        size_t requestLength;
+        char * const request = safeReadAll(connectionFileDescriptor, &requestLength, "hw4Serve");
+
+        struct Hw4BatchEntry *entries;
+        size_t entryCount;
+        size_t errorLineNumber;
+        char *reply;
+        if (!tryParseBatchManifest(request, requestLength, &entries, &entryCount, &errorLineNumber)) {
+            reply = formatString("ERROR Line %zu must hold an input path and an output path\n", errorLineNumber);
+        } else {
+            reply = checkServerRequest(entries, entryCount);
+            if (reply == NULL) {
+                if (entryCount > 0) {
+                    hw4BatchOnPool(entries, entryCount, options, &pool);
+                }
+                reply = formatString("OK %zu\n", entryCount);
+            }
+        }
+
+        // The client may have gone away; that is its loss, not the server's
+        trySendAll(connectionFileDescriptor, reply, strlen(reply));
+        safeClose(connectionFileDescriptor, "hw4Serve");
+
+        free(reply);
+        free(entries);
+        free(request);
+    }
+}
+
+/**
+ * Send a request to an hw4Serve server and wait for it to be done. If the server cannot be reached or rejects the
+ * request, abort the program with an error message.
+ *
+ * @param socketPath The path at which the server listens.
+ * @param entries The input/output pairs. The paths must be absolute, since the server does not share the caller's
+ *                working directory, and cannot contain whitespace.
+ * @param entryCount The number of pairs.
+ */
+void hw4Request(
+    char const * const socketPath,
+    struct Hw4BatchEntry const * const entries,
+    size_t const entryCount
+) {
+    guardNotNull(socketPath, "socketPath", "hw4Request");
+    guardNotNull(entries, "entries", "hw4Request");
+
+    size_t requestCapacity = 4096;
+    size_t requestLength = 0;
+    char *request = safeMalloc(requestCapacity, "hw4Request");
+    for (size_t entryIndex = 0; entryIndex < entryCount; entryIndex += 1) {
+        struct Hw4BatchEntry const * const entryPtr = &entries[entryIndex];
+        guardNotNull(entryPtr->inFilePath, "entries[].inFilePath", "hw4Request");
+        guardNotNull(entryPtr->outFilePath, "entries[].outFilePath", "hw4Request");
+        guardFmt(
+            strpbrk(entryPtr->inFilePath, " \t\r\n") == NULL && strpbrk(entryPtr->outFilePath, " \t\r\n") == NULL,
+            "hw4Request: Paths cannot contain whitespace: \"%s\" \"%s\"",
+            entryPtr->inFilePath,
+            entryPtr->outFilePath
+        );
+
+        size_t const lineLength = strlen(entryPtr->inFilePath) + strlen(entryPtr->outFilePath) + 2;
+        while (requestCapacity - requestLength < lineLength + 1) {
+            requestCapacity *= 2;
+            request = safeRealloc(request, requestCapacity, "hw4Request");
+        }
+        requestLength += safeSprintf(
+            request + requestLength,
+            "hw4Request",
+            "%s\t%s\n",
+            entryPtr->inFilePath,
+            entryPtr->outFilePath
+        );
+    }
+
+    int const socketFileDescriptor = safeConnectUnix(socketPath, "hw4Request");
+    safeWrite(socketFileDescriptor, request, requestLength, "hw4Request");
+    safeShutdownWrite(socketFileDescriptor, "hw4Request");
+    free(request);
+
+    size_t replyLength;
+    char * const reply = safeReadAll(socketFileDescriptor, &replyLength, "hw4Request");
+    safeClose(socketFileDescriptor, "hw4Request");
+
+    if (replyLength > 0 && reply[replyLength - 1] == '\n') {
+        reply[replyLength - 1] = '\0';
+    }
+    guardFmt(
+        strncmp(reply, "OK ", 3) == 0,
+        "hw4Request: Server at \"%s\" failed the request: \"%s\"",
+        socketPath,
+        reply
+    );
+    free(reply);
+}
+
+/**
+ * Check that every path of a request is absolute and every input is readable, so that the batch will not abort the
+ * server over a bad path.
+ *
+ * @returns NULL if the request is acceptable, or else an error reply, which the caller is responsible for freeing.
+ */
+static char *checkServerRequest(struct Hw4BatchEntry const * const entries, size_t const entryCount) {
+    assert(entries != NULL || entryCount == 0);
+
+    for (size_t entryIndex = 0; entryIndex < entryCount; entryIndex += 1) {
+        struct Hw4BatchEntry const * const entryPtr = &entries[entryIndex];
+        if (entryPtr->inFilePath[0] != '/' || entryPtr->outFilePath[0] != '/') {
+            return formatString(
+                "ERROR Pair %zu must use absolute paths: \"%s\" \"%s\"\n",
+                entryIndex + 1,
+                entryPtr->inFilePath,
+                entryPtr->outFilePath
+            );
+        }
+        if (access(entryPtr->inFilePath, R_OK) == -1) {
+            int const accessErrorCode = errno;
+            char const * const accessErrorMessage = strerror(accessErrorCode);
+            return formatString(
+                "ERROR Cannot read \"%s\" (error code: %d; error message: \"%s\")\n",
+                entryPtr->inFilePath,
+                accessErrorCode,
+                accessErrorMessage
+            );
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,356 @@
+#include "../../include/hw4/varint.h"
+
+#include "../../include/hw4/binary.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * An in-progress frame: its count, and the group currently being filled.
+ */
+struct VarintFrameEncoder {
+    char *output;
+    char *cursor;
+    char *groupControlPtr;
+    size_t groupCount;
+    size_t count;
+};
+
+static void varintFrameEncoderPush(struct VarintFrameEncoder *encoderPtr, int integer);
+static size_t encodeRawFrame(int const *integers, size_t count, bool isEvenDuplicated, char *output);
+static size_t decodeVarintGroup(char const *input, size_t availableLength, size_t valueCount, int *integers);
+static size_t varintGroupLength(unsigned char control, size_t valueCount);
+static uint32_t zigzagEncode(int integer);
+static int zigzagDecode(uint32_t value);
+static void storeUint32Le(uint32_t value, char *output);
+static uint32_t loadUint32Le(char const *input);
+
+/**
+ * Write a varint stream header.
+ *
+ * @param output The buffer into which to write HW4_VARINT_HEADER_LENGTH bytes.
+ */
+void encodeHw4VarintHeader(char * const output) {
+    guardNotNull(output, "output", "encodeHw4VarintHeader");
+
+    memcpy(output, HW4_VARINT_MAGIC, 4);
+    storeUint32Le(HW4_VARINT_VERSION, output + 4);
+}
+
+/**
+ * Check a varint stream header. If the magic or version does not match, abort the program with an error message.
+ *
+ * @param input The HW4_VARINT_HEADER_LENGTH header bytes.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void decodeHw4VarintHeader(char const * const input, char const * const callerDescription) {
+    guardNotNull(input, "input", "decodeHw4VarintHeader");
+    guardNotNull(callerDescription, "callerDescription", "decodeHw4VarintHeader");
+
+    if (memcmp(input, HW4_VARINT_MAGIC, 4) != 0) {
+        abortWithErrorFmt(
+            "%s: Input does not start with the varint format magic \"%s\"",
+            callerDescription,
+            HW4_VARINT_MAGIC
+        );
+    }
+    uint32_t const version = loadUint32Le(input + 4);
+    if (version < HW4_VARINT_MIN_VERSION || version > HW4_VARINT_VERSION) {
+        abortWithErrorFmt(
+            "%s: Unsupported varint format version %u (expected %u to %u)",
+            callerDescription,
+            version,
+            HW4_VARINT_MIN_VERSION,
+            HW4_VARINT_VERSION
+        );
+    }
+}
+
+/**
+ * Write the given integers as one varint frame, or as a raw frame if that would be no larger. Nothing is written for
+ * zero integers, since an empty frame would end the stream.
+ *
+ * @param integers The integers.
+ * @param count The number of integers.
+ * @param isEvenDuplicated Whether to write each even integer twice, as the HW4 output does.
+ * @param output The buffer into which to write. It must have room for HW4_VARINT_FRAME_HEADER_LENGTH bytes plus
+ *               HW4_VARINT_MAX_GROUP_LENGTH bytes per group of (possibly duplicated) integers.
+ *
+ * @returns The number of bytes written.
+ */
+size_t encodeHw4VarintFrame(
+    int const * const integers,
+    size_t const count,
+    bool const isEvenDuplicated,
+    char * const output
+) {
+    guardNotNull(integers, "integers", "encodeHw4VarintFrame");
+    guardNotNull(output, "output", "encodeHw4VarintFrame");
+    guard(count <= HW4_VARINT_RAW_FRAME_FLAG / 2 - 1, "encodeHw4VarintFrame: count does not fit in a frame");
+
+    if (count == 0) {
+        return 0;
+    }
+
+    struct VarintFrameEncoder encoder = {
+        .output = output,
+        .cursor = output + HW4_VARINT_FRAME_HEADER_LENGTH,
+        .groupControlPtr = NULL,
+        .groupCount = HW4_VARINT_GROUP_SIZE,
+        .count = 0
+    };
+    for (size_t integerIndex = 0; integerIndex < count; integerIndex += 1) {
+        int const integer = integers[integerIndex];
+        varintFrameEncoderPush(&encoder, integer);
+        if (isEvenDuplicated && integer % 2 == 0) {
+            varintFrameEncoderPush(&encoder, integer);
+        }
+    }
+
+    // Mostly wide integers pack no tighter than int32 values, and group varints add a control byte to every four
+    size_t const varintLength = (size_t)(encoder.cursor - output);
+    size_t const rawLength = HW4_VARINT_FRAME_HEADER_LENGTH + encoder.count * HW4_BINARY_INTEGER_LENGTH;
+    if (rawLength <= varintLength) {
+        return encodeRawFrame(integers, count, isEvenDuplicated, output);
+    }
+
+    storeUint32Le((uint32_t)encoder.count, output);
+    return varintLength;
+}
+
+/**
+ * Write the empty frame that ends a varint stream.
+ *
+ * @param output The buffer into which to write HW4_VARINT_FRAME_HEADER_LENGTH bytes.
+ *
+ * @returns The number of bytes written.
+ */
+size_t encodeHw4VarintTrailer(char * const output) {
+    guardNotNull(output, "output", "encodeHw4VarintTrailer");
+
+    storeUint32Le(0, output);
+    return HW4_VARINT_FRAME_HEADER_LENGTH;
+}
+
+/**
+ * Initialize a decoder positioned at the first frame of a stream, just after its header.
+ *
+ * @param decoderOutPtr A pointer to the decoder to initialize.
+ */
+void hw4VarintDecoderInit(struct Hw4VarintDecoder * const decoderOutPtr) {
+    guardNotNull(decoderOutPtr, "decoderOutPtr", "hw4VarintDecoderInit");
+
+    *decoderOutPtr = (struct Hw4VarintDecoder){
+        .frameRemainingCount = 0,
+        .isFrameRaw = false,
+        .pendingIndex = 0,
+        .pendingCount = 0,
+        .isEnd = false
+    };
+}
+
+/**
+ * Decode up to maxCount integers from the given bytes. Decoding stops early at the end of the stream (decoderPtr->isEnd
+ * is then set) or when the rest of the bytes do not hold a whole frame header or group, which are left unread for the
+ * caller to read more after. Away from the end of the bytes, values are decoded with fixed 4-byte loads and masks, so
+ * decoding does not branch on the individual value lengths.
+ *
+ * @param decoderPtr A pointer to the decoder.
+ * @param cursorPtr A pointer to the cursor into the bytes, advanced past everything decoded.
+ * @param end The end of the available bytes.
+ * @param integers The array into which to store the integers.
+ * @param maxCount The maximum number of integers to decode.
+ *
+ * @returns The number of integers decoded.
+ */
+size_t hw4VarintDecoderDecode(
+    struct Hw4VarintDecoder * const decoderPtr,
+    char const ** const cursorPtr,
+    char const * const end,
+    int * const integers,
+    size_t const maxCount
+) {
+    guardNotNull(decoderPtr, "decoderPtr", "hw4VarintDecoderDecode");
+    guardNotNull(cursorPtr, "cursorPtr", "hw4VarintDecoderDecode");
+    guardNotNull(integers, "integers", "hw4VarintDecoderDecode");
+
+    char const *cursor = *cursorPtr;
+    size_t count = 0;
+    while (count < maxCount) {
+        if (decoderPtr->pendingIndex < decoderPtr->pendingCount) {
+            // Hand out what is left of a group that did not fit in the previous call's array
+            integers[count] = decoderPtr->pendingIntegers[decoderPtr->pendingIndex];
+            decoderPtr->pendingIndex += 1;
+            count += 1;
+            continue;
+        }
+        if (decoderPtr->isEnd) {
+            break;
+        }
+
+        if (decoderPtr->frameRemainingCount == 0) {
+            if ((size_t)(end - cursor) < HW4_VARINT_FRAME_HEADER_LENGTH) {
+                break;
+            }
+            uint32_t const frameHeader = loadUint32Le(cursor);
+            decoderPtr->isFrameRaw = (frameHeader & HW4_VARINT_RAW_FRAME_FLAG) != 0;
+            decoderPtr->frameRemainingCount = frameHeader & ~HW4_VARINT_RAW_FRAME_FLAG;
+            decoderPtr->isEnd = decoderPtr->frameRemainingCount == 0;
+            cursor += HW4_VARINT_FRAME_HEADER_LENGTH;
+            continue;
+        }
+
+        if (decoderPtr->isFrameRaw) {
+            size_t const wantedCount = maxCount - count < decoderPtr->frameRemainingCount
+                ? maxCount - count
+                : decoderPtr->frameRemainingCount;
+            size_t const rawCount = decodeHw4BinaryIntegers(&cursor, end, integers + count, wantedCount);
+            if (rawCount == 0) {
+                break;
+            }
+            count += rawCount;
+            decoderPtr->frameRemainingCount -= rawCount;
+            continue;
+        }
+
+        size_t const groupValueCount = decoderPtr->frameRemainingCount < HW4_VARINT_GROUP_SIZE
+            ? decoderPtr->frameRemainingCount
+            : HW4_VARINT_GROUP_SIZE;
+        size_t const availableLength = (size_t)(end - cursor);
+        if (availableLength == 0 || availableLength < varintGroupLength((unsigned char)*cursor, groupValueCount)) {
+            break;
+        }
+
+        if (maxCount - count >= groupValueCount) {
+            cursor += decodeVarintGroup(cursor, availableLength, groupValueCount, integers + count);
+            count += groupValueCount;
+        } else {
+            cursor += decodeVarintGroup(cursor, availableLength, groupValueCount, decoderPtr->pendingIntegers);
+            decoderPtr->pendingIndex = 0;
+            decoderPtr->pendingCount = groupValueCount;
+        }
+        decoderPtr->frameRemainingCount -= groupValueCount;
+    }
+
+    *cursorPtr = cursor;
+    return count;
+}
+
+static void varintFrameEncoderPush(struct VarintFrameEncoder * const encoderPtr, int const integer) {
+    if (encoderPtr->groupCount == HW4_VARINT_GROUP_SIZE) {
+        encoderPtr->groupControlPtr = encoderPtr->cursor;
+        *encoderPtr->groupControlPtr = 0;
+        encoderPtr->cursor += 1;
+        encoderPtr->groupCount = 0;
+    }
+
+    uint32_t const value = zigzagEncode(integer);
+    unsigned int const length = 1u + (value > 0xFFu) + (value > 0xFFFFu) + (value > 0xFFFFFFu);
+    char bytes[4];
+    storeUint32Le(value, bytes);
+    memcpy(encoderPtr->cursor, bytes, length);
+    encoderPtr->cursor += length;
+
+    unsigned int const control = (unsigned char)*encoderPtr->groupControlPtr;
+    *encoderPtr->groupControlPtr = (char)(control | (length - 1u) << (2u * (unsigned int)encoderPtr->groupCount));
+    encoderPtr->groupCount += 1;
+    encoderPtr->count += 1;
+}
+
+/**
+ * Write the given integers as a raw frame of little-endian int32 values.
+ *
+ * @returns The number of bytes written.
+ */
+static size_t encodeRawFrame(
+    int const * const integers,
+    size_t const count,
+    bool const isEvenDuplicated,
+    char * const output
+) {
+    char *cursor = output + HW4_VARINT_FRAME_HEADER_LENGTH;
+    for (size_t integerIndex = 0; integerIndex < count; integerIndex += 1) {
+        int const integer = integers[integerIndex];
+        storeUint32Le((uint32_t)integer, cursor);
+        cursor += HW4_BINARY_INTEGER_LENGTH;
+        if (isEvenDuplicated && integer % 2 == 0) {
+            storeUint32Le((uint32_t)integer, cursor);
+            cursor += HW4_BINARY_INTEGER_LENGTH;
+        }
+    }
+
+    size_t const frameCount = (size_t)(cursor - output - HW4_VARINT_FRAME_HEADER_LENGTH) / HW4_BINARY_INTEGER_LENGTH;
+    storeUint32Le((uint32_t)frameCount | HW4_VARINT_RAW_FRAME_FLAG, output);
+    return (size_t)(cursor - output);
+}
+
+/**
+ * Decode a group whose bytes are known to be available. When at least HW4_VARINT_MAX_GROUP_LENGTH bytes are available,
+ * each value is read with a whole 4-byte load and masked down to its length; otherwise only its own bytes are read.
+ *
+ * @returns The length of the group, control byte included.
+ */
+static size_t decodeVarintGroup(
+    char const * const input,
+    size_t const availableLength,
+    size_t const valueCount,
+    int * const integers
+) {
+    static uint32_t const lengthMasks[4] = {0xFFu, 0xFFFFu, 0xFFFFFFu, 0xFFFFFFFFu};
+
+    unsigned int const control = (unsigned char)input[0];
+    char const *cursor = input + 1;
+    if (availableLength >= HW4_VARINT_MAX_GROUP_LENGTH) {
+        for (size_t valueIndex = 0; valueIndex < valueCount; valueIndex += 1) {
+            unsigned int const lengthCode = control >> (2u * (unsigned int)valueIndex) & 3u;
+            integers[valueIndex] = zigzagDecode(loadUint32Le(cursor) & lengthMasks[lengthCode]);
+            cursor += lengthCode + 1u;
+        }
+    } else {
+        for (size_t valueIndex = 0; valueIndex < valueCount; valueIndex += 1) {
+            unsigned int const lengthCode = control >> (2u * (unsigned int)valueIndex) & 3u;
+            char bytes[4] = {0, 0, 0, 0};
+            memcpy(bytes, cursor, lengthCode + 1u);
+            integers[valueIndex] = zigzagDecode(loadUint32Le(bytes));
+            cursor += lengthCode + 1u;
+        }
+    }
+    return (size_t)(cursor - input);
+}
+
+/**
+ * @returns The length of a group of valueCount values with the given control byte, control byte included.
+ */
+static size_t varintGroupLength(unsigned char const control, size_t const valueCount) {
+    size_t length = 1;
+    for (size_t valueIndex = 0; valueIndex < valueCount; valueIndex += 1) {
+        length += ((unsigned int)control >> (2u * (unsigned int)valueIndex) & 3u) + 1u;
+    }
+    return length;
+}
+
+static uint32_t zigzagEncode(int const integer) {
+    uint32_t const value = (uint32_t)integer;
+    return value << 1 ^ (0u - (value >> 31));
+}
+
+static int zigzagDecode(uint32_t const value) {
+    return (int)(value >> 1 ^ (0u - (value & 1u)));
+}
+
+static void storeUint32Le(uint32_t const value, char * const output) {
+    output[0] = (char)(value & 0xFF);
+    output[1] = (char)(value >> 8 & 0xFF);
+    output[2] = (char)(value >> 16 & 0xFF);
+    output[3] = (char)(value >> 24 & 0xFF);
+}
+
+static uint32_t loadUint32Le(char const * const input) {
+    unsigned char const * const bytes = (unsigned char const *)input;
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
@@ -0,0 +1,647 @@
+#define _GNU_SOURCE
+
+#include "../../include/hw4.h"
+
+#include "../../include/hw4/format.h"
+#include "../../include/util/thread.h"
+#include "../../include/util/file.h"
+#include "../../include/util/integer.h"
+#include "../../include/util/memory.h"
+#include "../../include/util/guard.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * The minimum length of the input windows verified at a time. Windows are at least four chunks per worker, so every
+ * worker is kept busy.
+ */
+#define HW4_VERIFY_WINDOW_LENGTH (64 * 1024 * 1024)
+
+/**
+ * One side of a verification: a mapped file, or a file read into a buffer a window at a time.
+ */
+struct VerifySource {
+    int fileDescriptor;
+    bool isMapped;
+    struct MappedFile mappedFile;
+    unsigned long long offset;
+
+    char *buffer;
+    size_t bufferCapacity;
+    size_t bufferLength;
+    size_t windowLength;
+    bool isEndOfFile;
+};
+
+struct VerifyJob;
+
+/**
+ * One chunk of an input window. Measuring parses the chunk and finds how much output it should produce; comparing then
+ * checks the output at the chunk's offset against what hw4 would write for it. The chunk's integers are kept between
+ * the two, so the input is only parsed once.
+ */
+struct VerifyChunk {
+    struct VerifyJob *jobPtr;
+    size_t inputStartOffset;
+    size_t inputEndOffset;
+
+    int *integers;
+    size_t integerCount;
+
+    unsigned long long newlineCount;
+    unsigned long long outputLineCount;
+    size_t outputLength;
+    size_t outputOffset;
+
+    bool isDiverged;
+    size_t divergenceIntegerIndex;
+    size_t divergenceOutputOffset;
+};
+
+struct VerifyJob {
+    char const *input;
+    unsigned long long inputBaseOffset;
+    char const *output;
+    size_t outputLength;
+    bool isOutputEnded;
+    size_t blockCapacity;
+
+    size_t remainingChunkCount;
+    pthread_mutex_t mutex;
+    pthread_cond_t allChunksDoneCondition;
+};
+
+static void verifySourceInit(
+    struct VerifySource *sourceOutPtr,
+    char const *filePath,
+    char const *callerDescription
+);
+static char const *nextInputWindow(struct VerifySource *sourcePtr, size_t windowLength, size_t *lengthOutPtr);
+static char const *nextOutputWindow(struct VerifySource *sourcePtr, size_t length, size_t *lengthOutPtr);
+static void verifySourceDestroy(struct VerifySource *sourcePtr);
+static void runVerifyChunkTasks(
+    struct VerifyJob *jobPtr,
+    struct VerifyChunk *chunks,
+    size_t chunkCount,
+    ThreadPoolTaskRoutine routine,
+    struct ThreadPool *poolPtr
+);
+static void finishVerifyChunkTask(struct VerifyJob *jobPtr);
+static size_t parseVerifyBlock(struct VerifyChunk const *chunkPtr, char const **cursorPtr, int *integers);
+static void measureVerifyChunkTask(void *chunkAsVoidPtr);
+static void compareVerifyChunkTask(void *chunkAsVoidPtr);
+static void describeDivergence(
+    struct VerifyChunk const *chunkPtr,
+    unsigned long long inputLineCount,
+    unsigned long long outputLineCount,
+    struct Hw4Divergence *divergenceOutPtr
+);
+static void copyActualLine(
+    char const *output,
+    size_t length,
+    bool isOutputEnded,
+    struct Hw4Divergence *divergenceOutPtr
+);
+static unsigned long long countNewlines(char const *bytes, size_t length);
+
+/**
+ * Check that the given output is exactly what hw4 writes for the given input: each input integer, in order, as a
+ * canonical "%d\n" line, once if odd and twice if even. The input is verified a window at a time, each split into
+ * chunks of about `options->chunkSize` bytes on `options->threadCount` worker threads (0 meaning one per online CPU).
+ * Each worker first parses its chunk and measures its output; after the offsets are summed, each formats its chunk
+ * `options->blockCapacity` integers at a time and compares them with the output at its offset using memcmp, which
+ * glibc vectorizes. Nothing is written.
+ *
+ * Regular files are mapped; pipes (and "-", meaning standard input) are read a window at a time, reading just the
+ * output the input window should produce. Either way, memory use is bounded by the window length (64 MiB, or four
+ * chunks per worker if more) for inputs of any size. If the input itself cannot be parsed, abort the program with an
+ * error message.
+ *
+ * @param inFilePath The path of the input file.
+ * @param outFilePath The path of the output file.
+ * @param options The options. Only the thread count, chunk size, and block capacity are used.
+ * @param divergenceOutPtr A pointer to the memory where the first divergence should be stored, if there is one.
+ *
+ * @returns Whether the output matches.
+ */
+bool hw4Verify(
+    char const * const inFilePath,
+    char const * const outFilePath,
+    struct Hw4Options const * const options,
+    struct Hw4Divergence * const divergenceOutPtr
+) {
+    guardNotNull(inFilePath, "inFilePath", "hw4Verify");
+    guardNotNull(outFilePath, "outFilePath", "hw4Verify");
+    guardNotNull(options, "options", "hw4Verify");
+    guardNotNull(divergenceOutPtr, "divergenceOutPtr", "hw4Verify");
+    guard(options->chunkSize > 0, "hw4Verify: options->chunkSize must be positive");
+    guard(options->blockCapacity > 0, "hw4Verify: options->blockCapacity must be positive");
+    guard(
+        strcmp(inFilePath, "-") != 0 || strcmp(outFilePath, "-") != 0,
+        "hw4Verify: Only one of the files can be standard input"
+    );
+
+    struct VerifySource inSource;
+    struct VerifySource outSource;
+    verifySourceInit(&inSource, inFilePath, "hw4Verify");
+    verifySourceInit(&outSource, outFilePath, "hw4Verify");
+
+    struct VerifyJob job = { .blockCapacity = options->blockCapacity };
+    safeMutexInit(&job.mutex, NULL, "hw4Verify");
+    safeConditionInit(&job.allChunksDoneCondition, NULL, "hw4Verify");
+    struct ThreadPool pool;
+    threadPoolInit(&pool, options->threadCount, "hw4Verify");
+    size_t windowLength = pool.threadCount * 4 * options->chunkSize;
+    windowLength = windowLength > HW4_VERIFY_WINDOW_LENGTH ? windowLength : HW4_VERIFY_WINDOW_LENGTH;
+
+    size_t chunkCapacity = 16;
+    struct VerifyChunk *chunks = safeMalloc(sizeof *chunks * chunkCapacity, "hw4Verify");
+    unsigned long long inputLineCount = 0;
+    unsigned long long outputLineCount = 0;
+    bool isMatch = true;
+    while (isMatch) {
+        size_t inputLength;
+        job.inputBaseOffset = inSource.offset;
+        job.input = nextInputWindow(&inSource, windowLength, &inputLength);
+        if (inputLength == 0) {
+            break;
+        }
+
+        size_t chunkCount = 0;
+        for (size_t inputOffset = 0; inputOffset < inputLength; chunkCount += 1) {
+            if (chunkCount == chunkCapacity) {
+                chunkCapacity *= 2;
+                chunks = safeRealloc(chunks, sizeof *chunks * chunkCapacity, "hw4Verify");
+            }
+
+            size_t inputEndOffset = inputLength;
+            if (inputLength - inputOffset > options->chunkSize) {
+                char const * const newline = memchr(
+                    job.input + inputOffset + options->chunkSize,
+                    '\n',
+                    inputLength - inputOffset - options->chunkSize
+                );
+                inputEndOffset = newline == NULL ? inputLength : (size_t)(newline - job.input) + 1;
+            }
+            chunks[chunkCount] = (struct VerifyChunk){
+                .jobPtr = &job,
+                .inputStartOffset = inputOffset,
+                .inputEndOffset = inputEndOffset,
+                .integers = NULL,
+                .integerCount = 0
+            };
+            inputOffset = inputEndOffset;
+        }
+
+        runVerifyChunkTasks(&job, chunks, chunkCount, measureVerifyChunkTask, &pool);
+
+        size_t outputLength = 0;
+        for (size_t chunkIndex = 0; chunkIndex < chunkCount; chunkIndex += 1) {
+            chunks[chunkIndex].outputOffset = outputLength;
+            outputLength += chunks[chunkIndex].outputLength;
+        }
+        job.output = nextOutputWindow(&outSource, outputLength, &job.outputLength);
+        job.isOutputEnded = job.outputLength < outputLength;
+
+        runVerifyChunkTasks(&job, chunks, chunkCount, compareVerifyChunkTask, &pool);
+
+        for (size_t chunkIndex = 0; chunkIndex < chunkCount && isMatch; chunkIndex += 1) {
+            struct VerifyChunk const * const chunkPtr = &chunks[chunkIndex];
+            if (chunkPtr->isDiverged) {
+                describeDivergence(chunkPtr, inputLineCount, outputLineCount, divergenceOutPtr);
+                isMatch = false;
+            }
+            inputLineCount += chunkPtr->newlineCount;
+            outputLineCount += chunkPtr->outputLineCount;
+        }
+    }
+
+    // Anything left in the output is more than the input accounts for
+    if (isMatch) {
+        size_t extraLength;
+        char const * const extra = nextOutputWindow(&outSource, HW4_DIVERGENCE_LINE_CAPACITY, &extraLength);
+        if (extraLength > 0) {
+            divergenceOutPtr->inputLineNumber = 0;
+            divergenceOutPtr->outputLineNumber = outputLineCount + 1;
+            divergenceOutPtr->expectedLine[0] = '\0';
+            copyActualLine(extra, extraLength, extraLength < HW4_DIVERGENCE_LINE_CAPACITY, divergenceOutPtr);
+            isMatch = false;
+        }
+    }
+
+    free(chunks);
+    threadPoolDestroy(&pool);
+    safeConditionDestroy(&job.allChunksDoneCondition, "hw4Verify");
+    safeMutexDestroy(&job.mutex, "hw4Verify");
+    verifySourceDestroy(&outSource);
+    verifySourceDestroy(&inSource);
+    return isMatch;
+}
+
+static void verifySourceInit(
+    struct VerifySource * const sourceOutPtr,
+    char const * const filePath,
+    char const * const callerDescription
+) {
+    assert(sourceOutPtr != NULL);
+    assert(filePath != NULL);
+
+    int const fileDescriptor = strcmp(filePath, "-") == 0
+        ? STDIN_FILENO
+        : safeOpen(filePath, O_RDONLY, callerDescription);
+    *sourceOutPtr = (struct VerifySource){
+        .fileDescriptor = fileDescriptor,
+        .offset = 0,
+        .buffer = NULL,
+        .bufferCapacity = 0,
+        .bufferLength = 0,
+        .windowLength = 0,
+        .isEndOfFile = false
+    };
+    sourceOutPtr->isMapped = tryMapFile(fileDescriptor, &sourceOutPtr->mappedFile, callerDescription);
+    if (!sourceOutPtr->isMapped) {
+        tryResizePipe(fileDescriptor, HW4_VERIFY_WINDOW_LENGTH, callerDescription);
+    }
+}
+
+/**
+ * Get the next window of input: about `windowLength` bytes, ending just after a newline (or at the end of the input),
+ * so no integer is split across windows.
+ *
+ * @returns The window, valid until the next call.
+ */
+static char const *nextInputWindow(
+    struct VerifySource * const sourcePtr,
+    size_t const windowLength,
+    size_t * const lengthOutPtr
+) {
+    assert(sourcePtr != NULL);
+    assert(lengthOutPtr != NULL);
+
+    if (sourcePtr->isMapped) {
+        struct MappedFile const * const mappedFilePtr = &sourcePtr->mappedFile;
+        size_t const offset = (size_t)sourcePtr->offset;
+        size_t length = mappedFilePtr->length - offset;
+        if (length > windowLength) {
+            char const * const windowStart = mappedFilePtr->bytes + offset;
+            char const * const newline = memchr(windowStart + windowLength, '\n', length - windowLength);
+            length = newline == NULL ? length : (size_t)(newline - windowStart) + 1;
+        }
+        sourcePtr->offset += length;
+        *lengthOutPtr = length;
+        return length == 0 ? NULL : mappedFilePtr->bytes + offset;
+    }
+
+    // Keep whatever followed the last window's final newline
+    if (sourcePtr->windowLength > 0) {
+        sourcePtr->bufferLength -= sourcePtr->windowLength;
+        memmove(sourcePtr->buffer, sourcePtr->buffer + sourcePtr->windowLength, sourcePtr->bufferLength);
+        sourcePtr->windowLength = 0;
+    }
+
+    while (true) {
+        if (sourcePtr->bufferCapacity - sourcePtr->bufferLength < windowLength / 2) {
+            sourcePtr->bufferCapacity = sourcePtr->bufferLength + windowLength;
+            sourcePtr->buffer = safeRealloc(sourcePtr->buffer, sourcePtr->bufferCapacity, "nextInputWindow");
+        }
+        while (!sourcePtr->isEndOfFile && sourcePtr->bufferLength < sourcePtr->bufferCapacity) {
+            size_t const readLength = safeRead(
+                sourcePtr->fileDescriptor,
+                sourcePtr->buffer + sourcePtr->bufferLength,
+                sourcePtr->bufferCapacity - sourcePtr->bufferLength,
+                "nextInputWindow"
+            );
+            sourcePtr->isEndOfFile = readLength == 0;
+            sourcePtr->bufferLength += readLength;
+        }
+
+        if (sourcePtr->isEndOfFile) {
+            sourcePtr->windowLength = sourcePtr->bufferLength;
+            break;
+        }
+        char const * const lastNewline = memrchr(sourcePtr->buffer, '\n', sourcePtr->bufferLength);
+        if (lastNewline != NULL) {
+            sourcePtr->windowLength = (size_t)(lastNewline - sourcePtr->buffer) + 1;
+            break;
+        }
+        // A window's worth of input without a newline: read on until one turns up
+    }
+
+    sourcePtr->offset += sourcePtr->windowLength;
+    *lengthOutPtr = sourcePtr->windowLength;
+    return sourcePtr->buffer;
+}
+
+/**
+ * Get the next `length` bytes of output, or as many as remain.
+ *
+ * @returns The window, valid until the next call.
+ */
+static char const *nextOutputWindow(
+    struct VerifySource * const sourcePtr,
+    size_t const length,
+    size_t * const lengthOutPtr
+) {
+    assert(sourcePtr != NULL);
+    assert(lengthOutPtr != NULL);
+
+    if (sourcePtr->isMapped) {
+        struct MappedFile const * const mappedFilePtr = &sourcePtr->mappedFile;
+        size_t const offset = (size_t)sourcePtr->offset;
+        size_t const remainingLength = mappedFilePtr->length - offset;
+        size_t const windowLength = length < remainingLength ? length : remainingLength;
+        sourcePtr->offset += windowLength;
+        *lengthOutPtr = windowLength;
+        return windowLength == 0 ? NULL : mappedFilePtr->bytes + offset;
+    }
+
+    if (sourcePtr->bufferCapacity < length) {
+        sourcePtr->bufferCapacity = length;
+        sourcePtr->buffer = safeRealloc(sourcePtr->buffer, sourcePtr->bufferCapacity, "nextOutputWindow");
+    }
+    size_t windowLength = 0;
+    while (!sourcePtr->isEndOfFile && windowLength < length) {
+        size_t const readLength = safeRead(
+            sourcePtr->fileDescriptor,
+            sourcePtr->buffer + windowLength,
+            length - windowLength,
+            "nextOutputWindow"
+        );
+        sourcePtr->isEndOfFile = readLength == 0;
+        windowLength += readLength;
+    }
+    sourcePtr->offset += windowLength;
+    *lengthOutPtr = windowLength;
+    return sourcePtr->buffer;
+}
+
+static void verifySourceDestroy(struct VerifySource * const sourcePtr) {
+    assert(sourcePtr != NULL);
+
+    if (sourcePtr->isMapped) {
+        unmapFile(&sourcePtr->mappedFile, "verifySourceDestroy");
+    }
+    free(sourcePtr->buffer);
+    if (sourcePtr->fileDescriptor != STDIN_FILENO) {
+        safeClose(sourcePtr->fileDescriptor, "verifySourceDestroy");
+    }
+}
+
+/**
+ * Run the given routine on every chunk using the pool and wait for all of them to finish.
+ */
+static void runVerifyChunkTasks(
+    struct VerifyJob * const jobPtr,
+    struct VerifyChunk * const chunks,
+    size_t const chunkCount,
+    ThreadPoolTaskRoutine const routine,
+    struct ThreadPool * const poolPtr
+) {
+    assert(jobPtr != NULL);
+    assert(chunks != NULL);
+
+    safeMutexLock(&jobPtr->mutex, "runVerifyChunkTasks");
+    jobPtr->remainingChunkCount = chunkCount;
+    safeMutexUnlock(&jobPtr->mutex, "runVerifyChunkTasks");
+
+    for (size_t chunkIndex = 0; chunkIndex < chunkCount; chunkIndex += 1) {
+        threadPoolSubmit(poolPtr, routine, &chunks[chunkIndex]);
+    }
+
+    safeMutexLock(&jobPtr->mutex, "runVerifyChunkTasks");
+    while (jobPtr->remainingChunkCount > 0) {
+        safeConditionWait(&jobPtr->allChunksDoneCondition, &jobPtr->mutex, "runVerifyChunkTasks");
+    }
+    safeMutexUnlock(&jobPtr->mutex, "runVerifyChunkTasks");
+}
+
+static void finishVerifyChunkTask(struct VerifyJob * const jobPtr) {
+    assert(jobPtr != NULL);
+
+    safeMutexLock(&jobPtr->mutex, "finishVerifyChunkTask");
+    jobPtr->remainingChunkCount -= 1;
+    if (jobPtr->remainingChunkCount == 0) {
+        safeConditionSignal(&jobPtr->allChunksDoneCondition, "finishVerifyChunkTask");
+    }
+    safeMutexUnlock(&jobPtr->mutex, "finishVerifyChunkTask");
+}
+
+/**
+ * Parse up to a block of integers from the chunk. If the input cannot be parsed, abort the program with an error
+ * message giving the byte offset within the whole input.
+ *
+ * @returns The number of integers parsed. Fewer than a block means the chunk is done.
+ */
+static size_t parseVerifyBlock(
+    struct VerifyChunk const * const chunkPtr,
+    char const ** const cursorPtr,
+    int * const integers
+) {
+    struct VerifyJob const * const jobPtr = chunkPtr->jobPtr;
+
+    enum ParseIntegerLineResult lastResult;
+    size_t const count = parseIntegerLines(
+        cursorPtr,
+        jobPtr->input + chunkPtr->inputEndOffset,
+        true,
+        integers,
+        jobPtr->blockCapacity,
+        &lastResult
+    );
+    if (lastResult != PARSE_INTEGER_LINE_PARSED && lastResult != PARSE_INTEGER_LINE_END_OF_INPUT) {
+        unsigned long long const windowOffset = (unsigned long long)(*cursorPtr - jobPtr->input);
+        abortWithParseIntegerLineError(lastResult, jobPtr->inputBaseOffset + windowOffset, "hw4Verify");
+    }
+    return count;
+}
+
+static void measureVerifyChunkTask(void * const chunkAsVoidPtr) {
+    assert(chunkAsVoidPtr != NULL);
+    struct VerifyChunk * const chunkPtr = chunkAsVoidPtr;
+    struct VerifyJob * const jobPtr = chunkPtr->jobPtr;
+
+    char const *cursor = jobPtr->input + chunkPtr->inputStartOffset;
+    size_t integerCapacity = 0;
+    while (true) {
+        if (integerCapacity - chunkPtr->integerCount < jobPtr->blockCapacity) {
+            integerCapacity = (chunkPtr->integerCount + jobPtr->blockCapacity) * 2;
+            chunkPtr->integers = safeRealloc(
+                chunkPtr->integers,
+                sizeof *chunkPtr->integers * integerCapacity,
+                "measureVerifyChunkTask"
+            );
+        }
+
+        size_t const count = parseVerifyBlock(chunkPtr, &cursor, chunkPtr->integers + chunkPtr->integerCount);
+        chunkPtr->integerCount += count;
+        if (count < jobPtr->blockCapacity) {
+            break;
+        }
+    }
+    chunkPtr->outputLength = hw4OutputLength(chunkPtr->integers, chunkPtr->integerCount);
+    chunkPtr->outputLineCount = hw4OutputCount(chunkPtr->integers, chunkPtr->integerCount);
+    chunkPtr->newlineCount = countNewlines(
+        jobPtr->input + chunkPtr->inputStartOffset,
+        chunkPtr->inputEndOffset - chunkPtr->inputStartOffset
+    );
+
+    finishVerifyChunkTask(jobPtr);
+}
+
+static void compareVerifyChunkTask(void * const chunkAsVoidPtr) {
+    assert(chunkAsVoidPtr != NULL);
+    struct VerifyChunk * const chunkPtr = chunkAsVoidPtr;
+    struct VerifyJob * const jobPtr = chunkPtr->jobPtr;
+
+    // The output may end before this chunk's share of it does
+    size_t availableLength = 0;
+    if (jobPtr->outputLength > chunkPtr->outputOffset) {
+        availableLength = jobPtr->outputLength - chunkPtr->outputOffset;
+        availableLength = availableLength < chunkPtr->outputLength ? availableLength : chunkPtr->outputLength;
+    }
+    char const * const actualStart = jobPtr->output + chunkPtr->outputOffset;
+
+    char * const expected = safeMalloc(
+        jobPtr->blockCapacity * HW4_OUTPUT_MAX_LENGTH_PER_INTEGER,
+        "compareVerifyChunkTask"
+    );
+    size_t comparedLength = 0;
+    for (size_t integerIndex = 0; integerIndex < chunkPtr->integerCount; integerIndex += jobPtr->blockCapacity) {
+        int const * const integers = chunkPtr->integers + integerIndex;
+        size_t const remainingCount = chunkPtr->integerCount - integerIndex;
+        size_t const count = remainingCount < jobPtr->blockCapacity ? remainingCount : jobPtr->blockCapacity;
+        size_t const expectedLength = formatHw4Output(integers, count, expected);
+        size_t const blockAvailableLength = availableLength - comparedLength;
+        char const * const actual = actualStart + comparedLength;
+
+        if (expectedLength > blockAvailableLength || memcmp(expected, actual, expectedLength) != 0) {
+            // Rare, so found the slow way: the first differing byte, then the integer whose output holds it
+            size_t const matchableLength = expectedLength < blockAvailableLength
+                ? expectedLength
+                : blockAvailableLength;
+            size_t matchLength = 0;
+            while (matchLength < matchableLength && expected[matchLength] == actual[matchLength]) {
+                matchLength += 1;
+            }
+
+            size_t integerOutputEnd = 0;
+            size_t blockIntegerIndex = 0;
+            while (true) {
+                integerOutputEnd += hw4OutputLength(&integers[blockIntegerIndex], 1);
+                if (matchLength < integerOutputEnd) {
+                    break;
+                }
+                blockIntegerIndex += 1;
+            }
+
+            chunkPtr->isDiverged = true;
+            chunkPtr->divergenceIntegerIndex = integerIndex + blockIntegerIndex;
+            chunkPtr->divergenceOutputOffset = chunkPtr->outputOffset + comparedLength + matchLength;
+            break;
+        }
+
+        comparedLength += expectedLength;
+    }
+    free(expected);
+    free(chunkPtr->integers);
+    chunkPtr->integers = NULL;
+
+    finishVerifyChunkTask(jobPtr);
+}
+
+/**
+ * Locate a chunk's divergence by walking its integers up to the one whose output differs.
+ *
+ * @param chunkPtr A pointer to the diverged chunk.
+ * @param inputLineCount The number of input lines before the chunk.
+ * @param outputLineCount The number of output lines before the chunk's output.
+ * @param divergenceOutPtr A pointer to the memory where the divergence should be stored.
+ */
+static void describeDivergence(
+    struct VerifyChunk const * const chunkPtr,
+    unsigned long long const inputLineCount,
+    unsigned long long const outputLineCount,
+    struct Hw4Divergence * const divergenceOutPtr
+) {
+    struct VerifyJob const * const jobPtr = chunkPtr->jobPtr;
+    char const * const chunkStart = jobPtr->input + chunkPtr->inputStartOffset;
+    char const * const chunkEnd = jobPtr->input + chunkPtr->inputEndOffset;
+
+    char const *cursor = chunkStart;
+    int integer = 0;
+    size_t integerOutputOffset = chunkPtr->outputOffset;
+    unsigned long long lineNumber = outputLineCount + 1;
+    for (size_t integerIndex = 0; integerIndex < chunkPtr->divergenceIntegerIndex; integerIndex += 1) {
+        parseIntegerLineExact(jobPtr->input, &cursor, chunkEnd, &integer, "describeDivergence");
+        integerOutputOffset += hw4OutputLength(&integer, 1);
+        lineNumber += hw4OutputCount(&integer, 1);
+    }
+
+    // Only the chunk's leading whitespace can precede the diverging integer; the rest was skipped while parsing
+    while (cursor < chunkEnd && *cursor != '\0' && strchr(" \t\n\v\f\r", *cursor) != NULL) {
+        cursor += 1;
+    }
+    char const * const integerStart = cursor;
+    parseIntegerLineExact(jobPtr->input, &cursor, chunkEnd, &integer, "describeDivergence");
+    size_t const lineLength = formatIntegerLine(integer, divergenceOutPtr->expectedLine);
+    divergenceOutPtr->expectedLine[lineLength - 1] = '\0';
+
+    // An even integer's second line differs only if its first matched
+    size_t lineOffset = integerOutputOffset;
+    if (chunkPtr->divergenceOutputOffset >= integerOutputOffset + lineLength) {
+        lineOffset += lineLength;
+        lineNumber += 1;
+    }
+
+    unsigned long long const newlineCount = countNewlines(chunkStart, (size_t)(integerStart - chunkStart));
+    divergenceOutPtr->inputLineNumber = inputLineCount + newlineCount + 1;
+    divergenceOutPtr->outputLineNumber = lineNumber;
+    size_t const actualLength = jobPtr->outputLength > lineOffset ? jobPtr->outputLength - lineOffset : 0;
+    copyActualLine(jobPtr->output + lineOffset, actualLength, jobPtr->isOutputEnded, divergenceOutPtr);
+}
+
+/**
+ * Copy the start of an output line, without its newline, into a divergence's actualLine, and note whether the line is
+ * cut off by the end of the output.
+ *
+ * @param output The output from the start of the line.
+ * @param length The number of output bytes available from the start of the line.
+ * @param isOutputEnded Whether the output ends after those bytes, rather than just the window holding them.
+ * @param divergenceOutPtr A pointer to the divergence.
+ */
+static void copyActualLine(
+    char const * const output,
+    size_t const length,
+    bool const isOutputEnded,
+    struct Hw4Divergence * const divergenceOutPtr
+) {
+    char * const actualLine = divergenceOutPtr->actualLine;
+    size_t const maxLength = HW4_DIVERGENCE_LINE_CAPACITY - 1;
+    size_t lineLength = 0;
+    while (lineLength < length && lineLength < maxLength && output[lineLength] != '\n') {
+        actualLine[lineLength] = output[lineLength];
+        lineLength += 1;
+    }
+    actualLine[lineLength] = '\0';
+
+    divergenceOutPtr->isActualLineUnterminated = isOutputEnded
+        && length > 0
+        && memchr(output, '\n', length) == NULL;
+}
+
+static unsigned long long countNewlines(char const * const bytes, size_t const length) {
+    unsigned long long newlineCount = 0;
+    char const * const end = bytes + length;
+    char const *cursor = bytes;
+    while (cursor < end && (cursor = memchr(cursor, '\n', (size_t)(end - cursor))) != NULL) {
+        newlineCount += 1;
+        cursor += 1;
+    }
+    return newlineCount;
+}
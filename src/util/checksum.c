@@ -0,0 +1,100 @@
+#include "../../include/util/checksum.h"
+
+#include "../../include/util/guard.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+static unsigned long long loadWord(unsigned char const *bytes);
+
+/**
+ * Initialize the given checksum to that of no bytes.
+ *
+ * @param checksumOutPtr A pointer to the memory where the checksum should be initialized.
+ */
+void runningChecksumInit(struct RunningChecksum * const checksumOutPtr) {
+    guardNotNull(checksumOutPtr, "checksumOutPtr", "runningChecksumInit");
+
+    *checksumOutPtr = (struct RunningChecksum){
+        .sum = 0,
+        .sumOfSums = 0,
+        .length = 0,
+        .pendingLength = 0
+    };
+}
+
+/**
+ * Add the given bytes to the end of the checksummed stream. Whole 8-byte words are summed directly from the bytes;
+ * only a trailing partial word is copied aside until the next update completes it.
+ *
+ * @param checksumPtr A pointer to the checksum.
+ * @param bytes The bytes.
+ * @param length The number of bytes.
+ */
+void runningChecksumUpdate(struct RunningChecksum * const checksumPtr, void const * const bytes, size_t const length) {
+    guardNotNull(checksumPtr, "checksumPtr", "runningChecksumUpdate");
+    guardNotNull(bytes, "bytes", "runningChecksumUpdate");
+
+    unsigned char const *cursor = bytes;
+    unsigned char const * const end = cursor + length;
+    unsigned long long sum = checksumPtr->sum;
+    unsigned long long sumOfSums = checksumPtr->sumOfSums;
+
+    if (checksumPtr->pendingLength > 0) {
+        size_t const neededLength = sizeof checksumPtr->pendingBytes - checksumPtr->pendingLength;
+        size_t const takenLength = length < neededLength ? length : neededLength;
+        memcpy(checksumPtr->pendingBytes + checksumPtr->pendingLength, cursor, takenLength);
+        checksumPtr->pendingLength += takenLength;
+        cursor += takenLength;
+        if (checksumPtr->pendingLength == sizeof checksumPtr->pendingBytes) {
+            sum += loadWord(checksumPtr->pendingBytes);
+            sumOfSums += sum;
+            checksumPtr->pendingLength = 0;
+        }
+    }
+
+    while ((size_t)(end - cursor) >= sizeof (uint64_t)) {
+        sum += loadWord(cursor);
+        sumOfSums += sum;
+        cursor += sizeof (uint64_t);
+    }
+
+    if (cursor < end) {
+        memcpy(checksumPtr->pendingBytes, cursor, (size_t)(end - cursor));
+        checksumPtr->pendingLength = (size_t)(end - cursor);
+    }
+
+    checksumPtr->sum = sum;
+    checksumPtr->sumOfSums = sumOfSums;
+    checksumPtr->length += length;
+}
+
+/**
+ * Get the checksum of the bytes added so far. The checksum can keep being updated afterward.
+ *
+ * @param checksumPtr A pointer to the checksum.
+ *
+ * @returns The checksum value.
+ */
+unsigned long long runningChecksumValue(struct RunningChecksum const * const checksumPtr) {
+    guardNotNull(checksumPtr, "checksumPtr", "runningChecksumValue");
+
+    unsigned long long sum = checksumPtr->sum;
+    unsigned long long sumOfSums = checksumPtr->sumOfSums;
+    if (checksumPtr->pendingLength > 0) {
+        // Zero-pad the partial word; the length mixed in below tells the padding apart from real zero bytes
+        unsigned char lastWord[8] = {0};
+        memcpy(lastWord, checksumPtr->pendingBytes, checksumPtr->pendingLength);
+        sum += loadWord(lastWord);
+        sumOfSums += sum;
+    }
+
+    return (sumOfSums ^ (sum << 32 | sum >> 32)) + checksumPtr->length * 0x9E3779B97F4A7C15ULL;
+}
+
+static unsigned long long loadWord(unsigned char const * const bytes) {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof word);
+    return word;
+}
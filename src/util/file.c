@@ -1,46 +1,934 @@
+#define _GNU_SOURCE
+
 #include "../../include/util/file.h"
 
-#include "../../include/util/guard.h"
-#include "../../include/util/error.h"
+#include "../../include/util/integer.h"
+#include "../../include/util/ioring.h"
+#include "../../include/util/readahead.h"
+#include "../../include/util/memory.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <time.h>
+
+#define BUFFERED_WRITER_ALIGNMENT 4096
+
+static long long monotonicNanoseconds(void);
+
+/**
+ * Open the file using fopen. If the operation fails, abort the program with an error message.
+ *
+ * @param filePath The file path.
+ * @param modes The fopen modes string.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The opened file.
+ */
+FILE *safeFopen(char const * const filePath, char const * const modes, char const * const callerDescription) {
+    guardNotNull(filePath, "filePath", "safeFopen");
+    guardNotNull(modes, "modes", "safeFopen");
+    guardNotNull(callerDescription, "callerDescription", "safeFopen");
+
+    FILE * const file = fopen(filePath, modes);
+    if (file == NULL) {
+        int const fopenErrorCode = errno;
+        char const * const fopenErrorMessage = strerror(fopenErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to open file \"%s\" with modes \"%s\" using fopen (error code: %d; error message: \"%s\")",
+            callerDescription,
+            filePath,
+            modes,
+            fopenErrorCode,
+            fopenErrorMessage
+        );
+        return NULL;
+    }
+
+    return file;
+}
+
+/**
+ * Open the file using open. If the operation fails, abort the program with an error message.
+ *
+ * @param filePath The file path.
+ * @param flags The open flags. O_CLOEXEC is always added.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The opened file descriptor.
+ */
+int safeOpen(char const * const filePath, int const flags, char const * const callerDescription) {
+    guardNotNull(filePath, "filePath", "safeOpen");
+    guardNotNull(callerDescription, "callerDescription", "safeOpen");
+
+    int const fileDescriptor = open(filePath, flags | O_CLOEXEC, 0666);
+    if (fileDescriptor == -1) {
+        int const openErrorCode = errno;
+        char const * const openErrorMessage = strerror(openErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to open file \"%s\" with flags %d using open (error code: %d; error message: \"%s\")",
+            callerDescription,
+            filePath,
+            flags,
+            openErrorCode,
+            openErrorMessage
+        );
+        return -1;
+    }
+
+    return fileDescriptor;
+}
+
+/**
+ * Close the given file descriptor. If the operation fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeClose(int const fileDescriptor, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "safeClose");
+
+    if (close(fileDescriptor) == -1) {
+        int const closeErrorCode = errno;
+        char const * const closeErrorMessage = strerror(closeErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to close file descriptor %d using close (error code: %d; error message: \"%s\")",
+            callerDescription,
+            fileDescriptor,
+            closeErrorCode,
+            closeErrorMessage
+        );
+    }
+}
+
+/**
+ * Read up to `length` bytes from the given file descriptor, retrying if interrupted by a signal. If the operation
+ * fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor.
+ * @param buffer The buffer into which to read.
+ * @param length The maximum number of bytes to read.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The number of bytes read. 0 means the end of the file was reached.
+ */
+size_t safeRead(
+    int const fileDescriptor,
+    void * const buffer,
+    size_t const length,
+    char const * const callerDescription
+) {
+    guardNotNull(buffer, "buffer", "safeRead");
+    guardNotNull(callerDescription, "callerDescription", "safeRead");
+
+    while (true) {
+        ssize_t const readResult = read(fileDescriptor, buffer, length);
+        if (readResult >= 0) {
+            return (size_t)readResult;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+
+        int const readErrorCode = errno;
+        char const * const readErrorMessage = strerror(readErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to read %zu bytes using read (error code: %d; error message: \"%s\")",
+            callerDescription,
+            length,
+            readErrorCode,
+            readErrorMessage
+        );
+        return 0;
+    }
+}
+
+/**
+ * Read from the given file descriptor until the end of the file. If the operation fails, abort the program with an
+ * error message.
+ *
+ * @param fileDescriptor The file descriptor.
+ * @param lengthOutPtr Where to write the number of bytes read.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The bytes read, followed by a string terminator. The caller is responsible for freeing the memory.
+ */
+char *safeReadAll(int const fileDescriptor, size_t * const lengthOutPtr, char const * const callerDescription) {
+    guardNotNull(lengthOutPtr, "lengthOutPtr", "safeReadAll");
+    guardNotNull(callerDescription, "callerDescription", "safeReadAll");
+
+    size_t capacity = 4096;
+    size_t length = 0;
+    char *bytes = safeMalloc(capacity, callerDescription);
+    while (true) {
+        if (capacity - length < 2) {
+            capacity *= 2;
+            bytes = safeRealloc(bytes, capacity, callerDescription);
+        }
+        size_t const readLength = safeRead(fileDescriptor, bytes + length, capacity - length - 1, callerDescription);
+        if (readLength == 0) {
+            break;
+        }
+        length += readLength;
+    }
+    bytes[length] = '\0';
+
+    *lengthOutPtr = length;
+    return bytes;
+}
+
+/**
+ * Write all of the given bytes to the given file descriptor, continuing after partial writes and retrying if
+ * interrupted by a signal. If the operation fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor.
+ * @param buffer The bytes.
+ * @param length The number of bytes.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeWrite(
+    int const fileDescriptor,
+    void const * const buffer,
+    size_t const length,
+    char const * const callerDescription
+) {
+    guardNotNull(buffer, "buffer", "safeWrite");
+    guardNotNull(callerDescription, "callerDescription", "safeWrite");
+
+    char const *cursor = buffer;
+    size_t remainingLength = length;
+    while (remainingLength > 0) {
+        ssize_t const writeResult = write(fileDescriptor, cursor, remainingLength);
+        if (writeResult >= 0) {
+            cursor += writeResult;
+            remainingLength -= (size_t)writeResult;
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+
+        int const writeErrorCode = errno;
+        char const * const writeErrorMessage = strerror(writeErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to write %zu bytes using write (error code: %d; error message: \"%s\")",
+            callerDescription,
+            remainingLength,
+            writeErrorCode,
+            writeErrorMessage
+        );
+        return;
+    }
+}
+
+/**
+ * Write all of the given bytes to the file descriptor at the given offset using pwrite, retrying after partial writes
+ * and interrupts. The file offset is not changed, so several threads may write disjoint ranges of one file at once. If
+ * the operation fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor. It must refer to a seekable file.
+ * @param buffer The bytes to write.
+ * @param length The number of bytes to write.
+ * @param offset The file offset at which to write the first byte.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safePwrite(
+    int const fileDescriptor,
+    void const * const buffer,
+    size_t const length,
+    unsigned long long const offset,
+    char const * const callerDescription
+) {
+    guardNotNull(buffer, "buffer", "safePwrite");
+    guardNotNull(callerDescription, "callerDescription", "safePwrite");
+
+    char const *cursor = buffer;
+    size_t remainingLength = length;
+    unsigned long long cursorOffset = offset;
+    while (remainingLength > 0) {
+        ssize_t const writeResult = pwrite(fileDescriptor, cursor, remainingLength, (off_t)cursorOffset);
+        if (writeResult >= 0) {
+            cursor += writeResult;
+            remainingLength -= (size_t)writeResult;
+            cursorOffset += (unsigned long long)writeResult;
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+
+        int const pwriteErrorCode = errno;
+        char const * const pwriteErrorMessage = strerror(pwriteErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to write %zu bytes at offset %llu using pwrite (error code: %d; error message: \"%s\")",
+            callerDescription,
+            remainingLength,
+            cursorOffset,
+            pwriteErrorCode,
+            pwriteErrorMessage
+        );
+        return;
+    }
+}
+
+/**
+ * Read up to `length` bytes from the given file descriptor at the given offset using pread, without moving its file
+ * offset, retrying if interrupted by a signal. If the operation fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor. It must refer to a seekable file.
+ * @param buffer The buffer into which to read.
+ * @param length The maximum number of bytes to read.
+ * @param offset The file offset at which to read.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The number of bytes read. Fewer than `length` means the end of the file was reached.
+ */
+size_t safePread(
+    int const fileDescriptor,
+    void * const buffer,
+    size_t const length,
+    unsigned long long const offset,
+    char const * const callerDescription
+) {
+    guardNotNull(buffer, "buffer", "safePread");
+    guardNotNull(callerDescription, "callerDescription", "safePread");
+
+    char *cursor = buffer;
+    size_t remainingLength = length;
+    unsigned long long cursorOffset = offset;
+    while (remainingLength > 0) {
+        ssize_t const readResult = pread(fileDescriptor, cursor, remainingLength, (off_t)cursorOffset);
+        if (readResult > 0) {
+            cursor += readResult;
+            remainingLength -= (size_t)readResult;
+            cursorOffset += (unsigned long long)readResult;
+            continue;
+        }
+        if (readResult == 0) {
+            break;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+
+        int const preadErrorCode = errno;
+        char const * const preadErrorMessage = strerror(preadErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to read %zu bytes at offset %llu using pread (error code: %d; error message: \"%s\")",
+            callerDescription,
+            remainingLength,
+            cursorOffset,
+            preadErrorCode,
+            preadErrorMessage
+        );
+        return 0;
+    }
+    return length - remainingLength;
+}
+
+/**
+ * Copy up to `length` bytes from the front of the given pipe without consuming them, using tee into a scratch pipe, so
+ * the next read of the pipe (by this process or another) still returns them. This waits until the pipe holds data or
+ * has no writers left, then copies what it holds, which may be fewer than `length` bytes before the end of the input
+ * too. If the operation fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor. It must refer to a pipe or FIFO.
+ * @param buffer The buffer into which to copy.
+ * @param length The maximum number of bytes to copy.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The number of bytes copied. 0 means the pipe is empty and has no writers left.
+ */
+size_t safePeekPipe(
+    int const fileDescriptor,
+    void * const buffer,
+    size_t const length,
+    char const * const callerDescription
+) {
+    guardNotNull(buffer, "buffer", "safePeekPipe");
+    guardNotNull(callerDescription, "callerDescription", "safePeekPipe");
+
+    int scratchFileDescriptors[2];
+    safePipe(scratchFileDescriptors, callerDescription);
+
+    ssize_t teeResult;
+    do {
+        teeResult = tee(fileDescriptor, scratchFileDescriptors[1], length, 0);
+    } while (teeResult == -1 && errno == EINTR);
+    if (teeResult == -1) {
+        int const teeErrorCode = errno;
+        char const * const teeErrorMessage = strerror(teeErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to peek at %zu bytes of file descriptor %d using tee "
+                "(error code: %d; error message: \"%s\")",
+            callerDescription,
+            length,
+            fileDescriptor,
+            teeErrorCode,
+            teeErrorMessage
+        );
+        return 0;
+    }
+    safeClose(scratchFileDescriptors[1], callerDescription);
+
+    size_t peekedLength = 0;
+    while (peekedLength < (size_t)teeResult) {
+        char * const cursor = (char *)buffer + peekedLength;
+        size_t const remainingLength = (size_t)teeResult - peekedLength;
+        peekedLength += safeRead(scratchFileDescriptors[0], cursor, remainingLength, callerDescription);
+    }
+    safeClose(scratchFileDescriptors[0], callerDescription);
+    return peekedLength;
+}
+
+/**
+ * Allocate disk space for the first `length` bytes of the given file and extend it to at least that length, using
+ * fallocate. File systems that do not support fallocate fall back to ftruncate, which extends the file without
+ * reserving space. If the operation fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor. It must refer to a regular file open for writing.
+ * @param length The length to allocate.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safePreallocate(int const fileDescriptor, unsigned long long const length, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "safePreallocate");
+
+    if (length == 0) {
+        return;
+    }
+
+    int fallocateResult;
+    do {
+        fallocateResult = fallocate(fileDescriptor, 0, 0, (off_t)length);
+    } while (fallocateResult == -1 && errno == EINTR);
+    if (fallocateResult == 0) {
+        return;
+    }
+    if (errno == EOPNOTSUPP && ftruncate(fileDescriptor, (off_t)length) == 0) {
+        return;
+    }
+
+    int const preallocateErrorCode = errno;
+    char const * const preallocateErrorMessage = strerror(preallocateErrorCode);
+
+    abortWithErrorFmt(
+        "%s: Failed to preallocate %llu bytes of file descriptor %d (error code: %d; error message: \"%s\")",
+        callerDescription,
+        length,
+        fileDescriptor,
+        preallocateErrorCode,
+        preallocateErrorMessage
+    );
+}
+
+/**
+ * Truncate or extend the given file to exactly `length` bytes using ftruncate. If the operation fails, abort the
+ * program with an error message.
+ *
+ * @param fileDescriptor The file descriptor. It must refer to a regular file open for writing.
+ * @param length The new length.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeTruncate(int const fileDescriptor, unsigned long long const length, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "safeTruncate");
+
+    int ftruncateResult;
+    do {
+        ftruncateResult = ftruncate(fileDescriptor, (off_t)length);
+    } while (ftruncateResult == -1 && errno == EINTR);
+    if (ftruncateResult == -1) {
+        int const ftruncateErrorCode = errno;
+        char const * const ftruncateErrorMessage = strerror(ftruncateErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to truncate file descriptor %d to %llu bytes (error code: %d; error message: \"%s\")",
+            callerDescription,
+            fileDescriptor,
+            length,
+            ftruncateErrorCode,
+            ftruncateErrorMessage
+        );
+    }
+}
+
+/**
+ * Move the given file descriptor's offset to `offset` bytes from the start of the file using lseek. If the operation
+ * fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor. It must be seekable.
+ * @param offset The new offset.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeSeek(int const fileDescriptor, unsigned long long const offset, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "safeSeek");
+
+    if (lseek(fileDescriptor, (off_t)offset, SEEK_SET) == -1) {
+        int const lseekErrorCode = errno;
+        char const * const lseekErrorMessage = strerror(lseekErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to seek file descriptor %d to offset %llu using lseek (error code: %d; error message: \"%s\")",
+            callerDescription,
+            fileDescriptor,
+            offset,
+            lseekErrorCode,
+            lseekErrorMessage
+        );
+    }
+}
+
+/**
+ * Get the given file descriptor's current offset from the start of the file using lseek. If the operation fails, abort
+ * the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor. It must be seekable.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The current offset.
+ */
+unsigned long long safeTell(int const fileDescriptor, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "safeTell");
+
+    off_t const offset = lseek(fileDescriptor, 0, SEEK_CUR);
+    if (offset == -1) {
+        int const lseekErrorCode = errno;
+        char const * const lseekErrorMessage = strerror(lseekErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to get the offset of file descriptor %d using lseek (error code: %d; error message: \"%s\")",
+            callerDescription,
+            fileDescriptor,
+            lseekErrorCode,
+            lseekErrorMessage
+        );
+        return 0;
+    }
+
+    return (unsigned long long)offset;
+}
+
+/**
+ * Wait until the data written to the given file is on the storage device, using fdatasync. If the operation fails,
+ * abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeSyncData(int const fileDescriptor, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "safeSyncData");
+
+    int fdatasyncResult;
+    do {
+        fdatasyncResult = fdatasync(fileDescriptor);
+    } while (fdatasyncResult == -1 && errno == EINTR);
+    if (fdatasyncResult == -1) {
+        int const fdatasyncErrorCode = errno;
+        char const * const fdatasyncErrorMessage = strerror(fdatasyncErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to sync file descriptor %d using fdatasync (error code: %d; error message: \"%s\")",
+            callerDescription,
+            fileDescriptor,
+            fdatasyncErrorCode,
+            fdatasyncErrorMessage
+        );
+    }
+}
+
+/**
+ * Rename a file using rename, atomically replacing any file at the new path. If the operation fails, abort the program
+ * with an error message.
+ *
+ * @param oldFilePath The current path.
+ * @param newFilePath The new path.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeRename(char const * const oldFilePath, char const * const newFilePath, char const * const callerDescription) {
+    guardNotNull(oldFilePath, "oldFilePath", "safeRename");
+    guardNotNull(newFilePath, "newFilePath", "safeRename");
+    guardNotNull(callerDescription, "callerDescription", "safeRename");
+
+    if (rename(oldFilePath, newFilePath) == -1) {
+        int const renameErrorCode = errno;
+        char const * const renameErrorMessage = strerror(renameErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to rename \"%s\" to \"%s\" using rename (error code: %d; error message: \"%s\")",
+            callerDescription,
+            oldFilePath,
+            newFilePath,
+            renameErrorCode,
+            renameErrorMessage
+        );
+    }
+}
+
+/**
+ * Write all of the bytes referenced by the given iovecs to the file descriptor using writev, retrying after partial
+ * writes and interrupts. If the operation fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor.
+ * @param iovecs The iovecs, at most IOV_MAX of them. They are modified to track partial writes.
+ * @param iovecCount The number of iovecs.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeWritev(
+    int const fileDescriptor,
+    struct iovec * const iovecs,
+    size_t const iovecCount,
+    char const * const callerDescription
+) {
+    guardNotNull(iovecs, "iovecs", "safeWritev");
+    guardNotNull(callerDescription, "callerDescription", "safeWritev");
+    guardFmt(iovecCount <= IOV_MAX, "%s: safeWritev iovecCount must be at most IOV_MAX", callerDescription);
+
+    struct iovec *iovecCursor = iovecs;
+    size_t remainingIovecCount = iovecCount;
+    while (remainingIovecCount > 0) {
+        ssize_t const writeResult = writev(fileDescriptor, iovecCursor, (int)remainingIovecCount);
+        if (writeResult < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            int const writevErrorCode = errno;
+            char const * const writevErrorMessage = strerror(writevErrorCode);
+
+            abortWithErrorFmt(
+                "%s: Failed to write %zu iovecs using writev (error code: %d; error message: \"%s\")",
+                callerDescription,
+                remainingIovecCount,
+                writevErrorCode,
+                writevErrorMessage
+            );
+            return;
+        }
+
+        // Skip the fully-written iovecs and trim the partially-written one
+        size_t writtenLength = (size_t)writeResult;
+        while (remainingIovecCount > 0 && writtenLength >= iovecCursor->iov_len) {
+            writtenLength -= iovecCursor->iov_len;
+            iovecCursor += 1;
+            remainingIovecCount -= 1;
+        }
+        if (remainingIovecCount > 0) {
+            iovecCursor->iov_base = (char *)iovecCursor->iov_base + writtenLength;
+            iovecCursor->iov_len -= writtenLength;
+        }
+    }
+}
+
+/**
+ * Create a pipe using pipe2. Both ends are close-on-exec, so child processes only get the ends they are explicitly
+ * given. If the operation fails, abort the program with an error message.
+ *
+ * @param fileDescriptorsOut The array into which to store the read end (index 0) and the write end (index 1).
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safePipe(int fileDescriptorsOut[2], char const * const callerDescription) {
+    guardNotNull(fileDescriptorsOut, "fileDescriptorsOut", "safePipe");
+    guardNotNull(callerDescription, "callerDescription", "safePipe");
+
+    if (pipe2(fileDescriptorsOut, O_CLOEXEC) == -1) {
+        int const pipeErrorCode = errno;
+        char const * const pipeErrorMessage = strerror(pipeErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to create pipe using pipe2 (error code: %d; error message: \"%s\")",
+            callerDescription,
+            pipeErrorCode,
+            pipeErrorMessage
+        );
+    }
+}
+
+/**
+ * Determine whether the given file descriptor refers to a regular file. If the operation fails, abort the program with
+ * an error message.
+ *
+ * @param fileDescriptor The file descriptor.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns Whether the file descriptor refers to a regular file.
+ */
+bool isRegularFile(int const fileDescriptor, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "isRegularFile");
+
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) == -1) {
+        int const fstatErrorCode = errno;
+        char const * const fstatErrorMessage = strerror(fstatErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to stat file descriptor %d using fstat (error code: %d; error message: \"%s\")",
+            callerDescription,
+            fileDescriptor,
+            fstatErrorCode,
+            fstatErrorMessage
+        );
+        return false;
+    }
+
+    return S_ISREG(fileStatus.st_mode);
+}
+
+/**
+ * Determine whether the given file descriptor was opened with O_APPEND, so every write lands at the end of the file
+ * whatever offset it is given. If the operation fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns Whether the file descriptor is appending.
+ */
+bool isAppending(int const fileDescriptor, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "isAppending");
+
+    int const flags = fcntl(fileDescriptor, F_GETFL);
+    if (flags == -1) {
+        int const fcntlErrorCode = errno;
+        char const * const fcntlErrorMessage = strerror(fcntlErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to get the flags of file descriptor %d using fcntl (error code: %d; error message: \"%s\")",
+            callerDescription,
+            fileDescriptor,
+            fcntlErrorCode,
+            fcntlErrorMessage
+        );
+        return false;
+    }
+
+    return (flags & O_APPEND) != 0;
+}
+
+/**
+ * Determine whether the given file descriptor refers to a pipe or FIFO. If the operation fails, abort the program with
+ * an error message.
+ *
+ * @param fileDescriptor The file descriptor.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns Whether the file descriptor refers to a pipe.
+ */
+bool isPipe(int const fileDescriptor, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "isPipe");
+
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) == -1) {
+        int const fstatErrorCode = errno;
+        char const * const fstatErrorMessage = strerror(fstatErrorCode);
 
-#include <stdbool.h>
-#include <string.h>
-#include <stdarg.h>
-#include <errno.h>
-#include <stdio.h>
+        abortWithErrorFmt(
+            "%s: Failed to stat file descriptor %d using fstat (error code: %d; error message: \"%s\")",
+            callerDescription,
+            fileDescriptor,
+            fstatErrorCode,
+            fstatErrorMessage
+        );
+        return false;
+    }
+
+    return S_ISFIFO(fileStatus.st_mode);
+}
 
 /**
- * Open the file using fopen. If the operation fails, abort the program with an error message.
+ * Grow the kernel buffer of the given pipe toward `capacity` bytes using F_SETPIPE_SZ, so each read or write of it can
+ * move more bytes. Unprivileged processes are limited by /proc/sys/fs/pipe-max-size, so smaller sizes are tried in
+ * turn; the pipe is left as is if none is allowed.
  *
- * @param filePath The file path.
- * @param modes The fopen modes string.
+ * @param fileDescriptor The file descriptor of either end of the pipe.
+ * @param capacity The desired capacity, in bytes.
  * @param callerDescription A description of the caller to be included in the error message. This could be the name of
  *                          the calling function, plus extra information if useful.
  *
- * @returns The opened file.
+ * @returns The pipe's capacity afterward, or 0 if the file descriptor is not a pipe.
  */
-FILE *safeFopen(char const * const filePath, char const * const modes, char const * const callerDescription) {
-    guardNotNull(filePath, "filePath", "safeFopen");
-    guardNotNull(modes, "modes", "safeFopen");
-    guardNotNull(callerDescription, "callerDescription", "safeFopen");
+size_t tryResizePipe(int const fileDescriptor, size_t const capacity, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "tryResizePipe");
 
-    FILE * const file = fopen(filePath, modes);
-    if (file == NULL) {
-        int const fopenErrorCode = errno;
-        char const * const fopenErrorMessage = strerror(fopenErrorCode);
+    if (!isPipe(fileDescriptor, callerDescription)) {
+        return 0;
+    }
+
+    int const currentCapacity = fcntl(fileDescriptor, F_GETPIPE_SZ);
+    if (currentCapacity == -1) {
+        return 0;
+    }
+    size_t const maxCapacity = (size_t)INT_MAX;
+    for (
+        size_t tryCapacity = capacity < maxCapacity ? capacity : maxCapacity;
+        tryCapacity > (size_t)currentCapacity;
+        tryCapacity /= 2
+    ) {
+        int const newCapacity = fcntl(fileDescriptor, F_SETPIPE_SZ, (int)tryCapacity);
+        if (newCapacity != -1) {
+            return (size_t)newCapacity;
+        }
+    }
+    return (size_t)currentCapacity;
+}
+
+/**
+ * Map the given file into memory for sequential reading, if it is a regular file. Pipes, terminals, and other
+ * non-regular files cannot be mapped; for those, false is returned and the caller should fall back to streaming. Only
+ * the bytes from the file descriptor's current offset on are mapped, as only those would be read from it, e.g. when
+ * an inherited standard input has been partly read already; the offset itself is not moved. The file descriptor is not
+ * closed and may be closed as soon as this returns. If the file cannot be mapped, abort the program with an error
+ * message.
+ *
+ * @param fileDescriptor The file descriptor, open for reading.
+ * @param mappedFileOutPtr A pointer to the memory where the mapping should be stored. A file with nothing left to read
+ *                         is mapped as a null pointer with length 0.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns Whether the file was mapped.
+ */
+bool tryMapFile(
+    int const fileDescriptor,
+    struct MappedFile * const mappedFileOutPtr,
+    char const * const callerDescription
+) {
+    guardNotNull(mappedFileOutPtr, "mappedFileOutPtr", "tryMapFile");
+    guardNotNull(callerDescription, "callerDescription", "tryMapFile");
+
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) == -1) {
+        int const fstatErrorCode = errno;
+        char const * const fstatErrorMessage = strerror(fstatErrorCode);
 
         abortWithErrorFmt(
-            "%s: Failed to open file \"%s\" with modes \"%s\" using fopen (error code: %d; error message: \"%s\")",
+            "%s: Failed to stat file descriptor %d using fstat (error code: %d; error message: \"%s\")",
             callerDescription,
-            filePath,
-            modes,
-            fopenErrorCode,
-            fopenErrorMessage
+            fileDescriptor,
+            fstatErrorCode,
+            fstatErrorMessage
         );
-        return NULL;
+        return false;
     }
 
-    return file;
+    if (!S_ISREG(fileStatus.st_mode)) {
+        return false;
+    }
+
+    unsigned long long const fileLength = (unsigned long long)fileStatus.st_size;
+    unsigned long long const offset = safeTell(fileDescriptor, callerDescription);
+    if (offset >= fileLength) {
+        *mappedFileOutPtr = (struct MappedFile){ .bytes = NULL, .length = 0, .offset = offset, .pageOffset = 0 };
+        return true;
+    }
+
+    size_t const length = (size_t)(fileLength - offset);
+    size_t const pageOffset = (size_t)(offset % (unsigned long long)sysconf(_SC_PAGESIZE));
+    void * const mapping = mmap(
+        NULL,
+        pageOffset + length,
+        PROT_READ,
+        MAP_PRIVATE,
+        fileDescriptor,
+        (off_t)(offset - pageOffset)
+    );
+    if (mapping == MAP_FAILED) {
+        int const mmapErrorCode = errno;
+        char const * const mmapErrorMessage = strerror(mmapErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to map %zu bytes of file descriptor %d using mmap (error code: %d; error message: \"%s\")",
+            callerDescription,
+            length,
+            fileDescriptor,
+            mmapErrorCode,
+            mmapErrorMessage
+        );
+        return false;
+    }
+
+    // Read-ahead and huge page hints; failures only cost performance, so they are ignored
+    madvise(mapping, pageOffset + length, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(mapping, pageOffset + length, MADV_HUGEPAGE);
+#endif
+
+    *mappedFileOutPtr = (struct MappedFile){
+        .bytes = (char const *)mapping + pageOffset,
+        .length = length,
+        .offset = offset,
+        .pageOffset = pageOffset
+    };
+    return true;
+}
+
+/**
+ * Unmap the given file mapping. If the operation fails, abort the program with an error message.
+ *
+ * @param mappedFilePtr A pointer to the mapping created by tryMapFile.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void unmapFile(struct MappedFile * const mappedFilePtr, char const * const callerDescription) {
+    guardNotNull(mappedFilePtr, "mappedFilePtr", "unmapFile");
+    guardNotNull(callerDescription, "callerDescription", "unmapFile");
+
+    if (mappedFilePtr->length == 0) {
+        return;
+    }
+
+    void * const mapping = (void *)(uintptr_t)(mappedFilePtr->bytes - mappedFilePtr->pageOffset);
+    if (munmap(mapping, mappedFilePtr->pageOffset + mappedFilePtr->length) == -1) {
+        int const munmapErrorCode = errno;
+        char const * const munmapErrorMessage = strerror(munmapErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to unmap file using munmap (error code: %d; error message: \"%s\")",
+            callerDescription,
+            munmapErrorCode,
+            munmapErrorMessage
+        );
+    }
+
+    *mappedFilePtr = (struct MappedFile){ .bytes = NULL, .length = 0, .offset = 0, .pageOffset = 0 };
 }
 
 /**
@@ -287,3 +1175,508 @@ bool scanFileExactVA(
 
     return true;
 }
+
+/**
+ * Initialize the given buffered reader, which reads the given file descriptor in large chunks so that integers can be
+ * parsed without a syscall or stdio call per value.
+ *
+ * @param readerOutPtr A pointer to the memory where the reader should be initialized.
+ * @param fileDescriptor The file descriptor, open for reading. The reader does not close it.
+ * @param capacity The size of the read buffer, in bytes.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void bufferedReaderInit(
+    struct BufferedReader * const readerOutPtr,
+    int const fileDescriptor,
+    size_t const capacity,
+    char const * const callerDescription
+) {
+    guardNotNull(readerOutPtr, "readerOutPtr", "bufferedReaderInit");
+    guardNotNull(callerDescription, "callerDescription", "bufferedReaderInit");
+    guardFmt(capacity > 0, "%s: bufferedReaderInit capacity must be positive", callerDescription);
+
+    readerOutPtr->fileDescriptor = fileDescriptor;
+    readerOutPtr->buffer = safeMalloc(capacity, callerDescription);
+    readerOutPtr->capacity = capacity;
+    readerOutPtr->cursor = readerOutPtr->buffer;
+    readerOutPtr->end = readerOutPtr->buffer;
+    readerOutPtr->isEndOfFile = false;
+    readerOutPtr->bufferOffset = 0;
+    readerOutPtr->ringReaderPtr = NULL;
+    readerOutPtr->readAheadReaderPtr = NULL;
+}
+
+/**
+ * Make the given buffered reader refill from an io_uring reader instead of calling read(2) directly. The io_uring
+ * reader must be reading the same file descriptor, and must outlive the buffered reader.
+ *
+ * @param readerPtr A pointer to the reader.
+ * @param ringReaderPtr A pointer to the io_uring reader.
+ */
+void bufferedReaderUseIoRing(struct BufferedReader * const readerPtr, struct IoRingReader * const ringReaderPtr) {
+    guardNotNull(readerPtr, "readerPtr", "bufferedReaderUseIoRing");
+    guardNotNull(ringReaderPtr, "ringReaderPtr", "bufferedReaderUseIoRing");
+
+    readerPtr->ringReaderPtr = ringReaderPtr;
+}
+
+/**
+ * Make the given buffered reader refill from a read-ahead reader instead of calling read(2) directly. The read-ahead
+ * reader must be reading the same file descriptor, and must outlive the buffered reader.
+ *
+ * @param readerPtr A pointer to the reader.
+ * @param readAheadReaderPtr A pointer to the read-ahead reader.
+ */
+void bufferedReaderUseReadAhead(
+    struct BufferedReader * const readerPtr,
+    struct ReadAheadReader * const readAheadReaderPtr
+) {
+    guardNotNull(readerPtr, "readerPtr", "bufferedReaderUseReadAhead");
+    guardNotNull(readAheadReaderPtr, "readAheadReaderPtr", "bufferedReaderUseReadAhead");
+
+    readerPtr->readAheadReaderPtr = readAheadReaderPtr;
+}
+
+/**
+ * Move the unconsumed bytes to the start of the buffer and read more bytes after them. If the operation fails, abort
+ * the program with an error message.
+ *
+ * @param readerPtr A pointer to the reader.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns Whether more bytes were read. False means the end of the file was reached.
+ */
+bool bufferedReaderRefill(struct BufferedReader * const readerPtr, char const * const callerDescription) {
+    guardNotNull(readerPtr, "readerPtr", "bufferedReaderRefill");
+    guardNotNull(callerDescription, "callerDescription", "bufferedReaderRefill");
+
+    if (readerPtr->isEndOfFile) {
+        return false;
+    }
+
+    size_t const consumedLength = (size_t)(readerPtr->cursor - readerPtr->buffer);
+    size_t const unconsumedLength = (size_t)(readerPtr->end - readerPtr->cursor);
+    guardFmt(
+        unconsumedLength < readerPtr->capacity,
+        "%s: A single token is longer than the %zu byte read buffer",
+        callerDescription,
+        readerPtr->capacity
+    );
+
+    memmove(readerPtr->buffer, readerPtr->cursor, unconsumedLength);
+    readerPtr->bufferOffset += consumedLength;
+    readerPtr->cursor = readerPtr->buffer;
+
+    char * const readBuffer = readerPtr->buffer + unconsumedLength;
+    size_t const readBufferLength = readerPtr->capacity - unconsumedLength;
+    size_t readLength;
+    if (readerPtr->ringReaderPtr != NULL) {
+        readLength = ioRingReaderRead(readerPtr->ringReaderPtr, readBuffer, readBufferLength, callerDescription);
+    } else if (readerPtr->readAheadReaderPtr != NULL) {
+        readLength = readAheadReaderRead(readerPtr->readAheadReaderPtr, readBuffer, readBufferLength);
+    } else {
+        readLength = safeRead(readerPtr->fileDescriptor, readBuffer, readBufferLength, callerDescription);
+    }
+    readerPtr->end = readerPtr->buffer + unconsumedLength + readLength;
+    readerPtr->isEndOfFile = readLength == 0;
+
+    return readLength > 0;
+}
+
+/**
+ * Read up to maxCount integers using the "%d\n" format (see parseIntegerLines), refilling the buffer as needed. If the
+ * input does not match the format, an integer does not fit in an int, or the read fails, abort the program with an
+ * error message.
+ *
+ * @param readerPtr A pointer to the reader.
+ * @param integers The array into which to store the integers.
+ * @param maxCount The maximum number of integers to read.
+ *
+ * @returns The number of integers read. Fewer than maxCount means only whitespace remained.
+ */
+size_t bufferedReaderScanIntegers(
+    struct BufferedReader * const readerPtr,
+    int * const integers,
+    size_t const maxCount
+) {
+    guardNotNull(readerPtr, "readerPtr", "bufferedReaderScanIntegers");
+    guardNotNull(integers, "integers", "bufferedReaderScanIntegers");
+
+    size_t count = 0;
+    while (count < maxCount) {
+        char const *cursor = readerPtr->cursor;
+        enum ParseIntegerLineResult lastResult;
+        count += parseIntegerLines(
+            &cursor,
+            readerPtr->end,
+            readerPtr->isEndOfFile,
+            integers + count,
+            maxCount - count,
+            &lastResult
+        );
+        readerPtr->cursor = cursor;
+
+        switch (lastResult) {
+            case PARSE_INTEGER_LINE_PARSED:
+            case PARSE_INTEGER_LINE_END_OF_INPUT:
+                return count;
+            case PARSE_INTEGER_LINE_INCOMPLETE:
+                bufferedReaderRefill(readerPtr, "bufferedReaderScanIntegers");
+                break;
+            case PARSE_INTEGER_LINE_INVALID:
+            case PARSE_INTEGER_LINE_OVERFLOW:
+            default:
+                abortWithParseIntegerLineError(
+                    lastResult,
+                    readerPtr->bufferOffset + (unsigned long long)(readerPtr->cursor - readerPtr->buffer),
+                    "bufferedReaderScanIntegers"
+                );
+                return count;
+        }
+    }
+    return count;
+}
+
+/**
+ * Destroy the given buffered reader. The file descriptor is not closed.
+ *
+ * @param readerPtr A pointer to the reader.
+ */
+void bufferedReaderDestroy(struct BufferedReader * const readerPtr) {
+    guardNotNull(readerPtr, "readerPtr", "bufferedReaderDestroy");
+
+    free(readerPtr->buffer);
+    readerPtr->buffer = NULL;
+}
+
+/**
+ * Initialize the given buffered writer.
+ *
+ * @param writerOutPtr A pointer to the memory where the writer should be initialized.
+ * @param fileDescriptor The file descriptor, open for writing. The writer does not close it.
+ * @param capacity The size of the write buffer, in bytes. The buffer is page-aligned.
+ * @param flushPolicy When to write buffered bytes out. The buffer is always flushed when full and on destroy.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void bufferedWriterInit(
+    struct BufferedWriter * const writerOutPtr,
+    int const fileDescriptor,
+    size_t const capacity,
+    struct FlushPolicy const flushPolicy,
+    char const * const callerDescription
+) {
+    guardNotNull(writerOutPtr, "writerOutPtr", "bufferedWriterInit");
+    guardNotNull(callerDescription, "callerDescription", "bufferedWriterInit");
+    guardFmt(capacity > 0, "%s: bufferedWriterInit capacity must be positive", callerDescription);
+
+    writerOutPtr->fileDescriptor = fileDescriptor;
+    writerOutPtr->buffer = safeAlignedMalloc(BUFFERED_WRITER_ALIGNMENT, capacity, callerDescription);
+    writerOutPtr->capacity = capacity;
+    writerOutPtr->length = 0;
+    writerOutPtr->flushPolicy = flushPolicy;
+    writerOutPtr->firstBufferedTimeNanoseconds = 0;
+    writerOutPtr->writtenLength = 0;
+    writerOutPtr->ringWriterPtr = NULL;
+}
+
+/**
+ * Make the given buffered writer build its output directly in an io_uring writer's fixed buffers, submitting each one
+ * on flush instead of calling write(2). Flushed bytes are then written asynchronously without being copied; destroying
+ * the io_uring writer waits for them. The writer's own buffer is freed, and its capacity becomes the io_uring writer's
+ * buffer size. The io_uring writer must be writing the same file descriptor, and must outlive the buffered writer.
+ *
+ * @param writerPtr A pointer to the writer. Nothing must be buffered yet.
+ * @param ringWriterPtr A pointer to the io_uring writer.
+ */
+void bufferedWriterUseIoRing(struct BufferedWriter * const writerPtr, struct IoRingWriter * const ringWriterPtr) {
+    guardNotNull(writerPtr, "writerPtr", "bufferedWriterUseIoRing");
+    guardNotNull(ringWriterPtr, "ringWriterPtr", "bufferedWriterUseIoRing");
+    guard(writerPtr->length == 0, "bufferedWriterUseIoRing: Output is already buffered");
+
+    free(writerPtr->buffer);
+    writerPtr->buffer = NULL;
+    writerPtr->capacity = ringWriterPtr->slotCapacity;
+    writerPtr->ringWriterPtr = ringWriterPtr;
+}
+
+/**
+ * Get space for at least `length` bytes at the end of the buffer, flushing first if there is not enough room. The
+ * caller writes into the space and then calls bufferedWriterCommit with the number of bytes actually used.
+ *
+ * @param writerPtr A pointer to the writer.
+ * @param length The number of bytes needed. Must not exceed the writer's capacity.
+ *
+ * @returns A pointer to the space.
+ */
+char *bufferedWriterReserve(struct BufferedWriter * const writerPtr, size_t const length) {
+    guardNotNull(writerPtr, "writerPtr", "bufferedWriterReserve");
+    guardFmt(
+        length <= writerPtr->capacity,
+        "bufferedWriterReserve: Cannot reserve %zu bytes in a %zu byte buffer",
+        length,
+        writerPtr->capacity
+    );
+
+    if (writerPtr->capacity - writerPtr->length < length) {
+        bufferedWriterFlush(writerPtr);
+    }
+    if (writerPtr->buffer == NULL) {
+        // The last fixed buffer was submitted, so move on to the next one
+        writerPtr->buffer = ioRingWriterAcquire(writerPtr->ringWriterPtr, "bufferedWriterReserve");
+    }
+    return writerPtr->buffer + writerPtr->length;
+}
+
+/**
+ * Append `length` bytes written into space from bufferedWriterReserve to the buffered output, then flush if the flush
+ * policy says so.
+ *
+ * @param writerPtr A pointer to the writer.
+ * @param length The number of bytes written into the reserved space.
+ */
+void bufferedWriterCommit(struct BufferedWriter * const writerPtr, size_t const length) {
+    guardNotNull(writerPtr, "writerPtr", "bufferedWriterCommit");
+    guard(length <= writerPtr->capacity - writerPtr->length, "bufferedWriterCommit: length exceeds reserved space");
+
+    if (length == 0) {
+        return;
+    }
+
+    struct FlushPolicy const * const flushPolicyPtr = &writerPtr->flushPolicy;
+    if (writerPtr->length == 0 && flushPolicyPtr->kind == FLUSH_POLICY_TIME) {
+        writerPtr->firstBufferedTimeNanoseconds = monotonicNanoseconds();
+    }
+    writerPtr->length += length;
+
+    bool shouldFlush = writerPtr->length == writerPtr->capacity;
+    switch (flushPolicyPtr->kind) {
+        case FLUSH_POLICY_SIZE:
+            shouldFlush = shouldFlush || writerPtr->length >= flushPolicyPtr->size;
+            break;
+        case FLUSH_POLICY_TIME:
+            shouldFlush = shouldFlush || (
+                monotonicNanoseconds() - writerPtr->firstBufferedTimeNanoseconds
+                >= (long long)flushPolicyPtr->intervalMilliseconds * 1000000
+            );
+            break;
+        case FLUSH_POLICY_END_OF_STREAM:
+        default:
+            break;
+    }
+
+    if (shouldFlush) {
+        bufferedWriterFlush(writerPtr);
+    }
+}
+
+/**
+ * Get how long the writer can wait before its flush policy requires the buffered output to be flushed, which only
+ * applies to FLUSH_POLICY_TIME with output buffered. Callers that wait for more output should wait no longer than this
+ * and then call bufferedWriterFlush, so buffered bytes do not outlive the interval while no more output arrives.
+ *
+ * @param writerPtr A pointer to the writer.
+ *
+ * @returns The number of nanoseconds left (0 if the flush is overdue), or -1 if no flush is pending.
+ */
+long long bufferedWriterFlushTimeout(struct BufferedWriter const * const writerPtr) {
+    guardNotNull(writerPtr, "writerPtr", "bufferedWriterFlushTimeout");
+
+    if (writerPtr->flushPolicy.kind != FLUSH_POLICY_TIME || writerPtr->length == 0) {
+        return -1;
+    }
+
+    long long const deadlineNanoseconds = writerPtr->firstBufferedTimeNanoseconds
+        + (long long)writerPtr->flushPolicy.intervalMilliseconds * 1000000;
+    long long const remainingNanoseconds = deadlineNanoseconds - monotonicNanoseconds();
+    return remainingNanoseconds > 0 ? remainingNanoseconds : 0;
+}
+
+/**
+ * Write every buffered byte to the file descriptor, or submit them through the writer's io_uring writer. If the
+ * operation fails, abort the program with an error message.
+ *
+ * @param writerPtr A pointer to the writer.
+ */
+void bufferedWriterFlush(struct BufferedWriter * const writerPtr) {
+    guardNotNull(writerPtr, "writerPtr", "bufferedWriterFlush");
+
+    if (writerPtr->length == 0) {
+        return;
+    }
+
+    if (writerPtr->ringWriterPtr != NULL) {
+        ioRingWriterSubmit(writerPtr->ringWriterPtr, writerPtr->length, "bufferedWriterFlush");
+        writerPtr->buffer = NULL;
+    } else {
+        safeWrite(writerPtr->fileDescriptor, writerPtr->buffer, writerPtr->length, "bufferedWriterFlush");
+    }
+    writerPtr->writtenLength += writerPtr->length;
+    writerPtr->length = 0;
+}
+
+/**
+ * Flush and destroy the given buffered writer. The file descriptor is not closed.
+ *
+ * @param writerPtr A pointer to the writer.
+ */
+void bufferedWriterDestroy(struct BufferedWriter * const writerPtr) {
+    guardNotNull(writerPtr, "writerPtr", "bufferedWriterDestroy");
+
+    bufferedWriterFlush(writerPtr);
+
+    // An io_uring writer's fixed buffers belong to it
+    if (writerPtr->ringWriterPtr == NULL) {
+        free(writerPtr->buffer);
+    }
+    writerPtr->buffer = NULL;
+}
+
+/**
+ * Initialize the given iovec writer.
+ *
+ * @param writerOutPtr A pointer to the memory where the writer should be initialized.
+ * @param fileDescriptor The file descriptor, open for writing. The writer does not close it.
+ * @param scratchCapacity The size of the scratch buffer for generated bytes.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void iovecWriterInit(
+    struct IovecWriter * const writerOutPtr,
+    int const fileDescriptor,
+    size_t const scratchCapacity,
+    char const * const callerDescription
+) {
+    guardNotNull(writerOutPtr, "writerOutPtr", "iovecWriterInit");
+    guardNotNull(callerDescription, "callerDescription", "iovecWriterInit");
+    guardFmt(scratchCapacity > 0, "%s: iovecWriterInit scratchCapacity must be positive", callerDescription);
+
+    writerOutPtr->fileDescriptor = fileDescriptor;
+    writerOutPtr->iovecCapacity = IOV_MAX;
+    writerOutPtr->iovecs = safeMalloc(sizeof *writerOutPtr->iovecs * writerOutPtr->iovecCapacity, callerDescription);
+    writerOutPtr->iovecCount = 0;
+    writerOutPtr->scratch = safeMalloc(scratchCapacity, callerDescription);
+    writerOutPtr->scratchCapacity = scratchCapacity;
+    writerOutPtr->scratchLength = 0;
+    writerOutPtr->writtenLength = 0;
+}
+
+/**
+ * Append a reference to the given bytes. They must not change until the next flush.
+ *
+ * @param writerPtr A pointer to the writer.
+ * @param bytes The bytes.
+ * @param length The number of bytes.
+ */
+void iovecWriterAppend(struct IovecWriter * const writerPtr, void const * const bytes, size_t const length) {
+    guardNotNull(writerPtr, "writerPtr", "iovecWriterAppend");
+    guardNotNull(bytes, "bytes", "iovecWriterAppend");
+
+    if (length == 0) {
+        return;
+    }
+
+    if (writerPtr->iovecCount > 0) {
+        struct iovec * const lastIovecPtr = &writerPtr->iovecs[writerPtr->iovecCount - 1];
+        if ((char const *)lastIovecPtr->iov_base + lastIovecPtr->iov_len == bytes) {
+            lastIovecPtr->iov_len += length;
+            return;
+        }
+    }
+
+    if (writerPtr->iovecCount == writerPtr->iovecCapacity) {
+        iovecWriterFlush(writerPtr);
+    }
+    // writev only reads through iov_base, so dropping the const is safe
+    writerPtr->iovecs[writerPtr->iovecCount] = (struct iovec){
+        .iov_base = (void *)(uintptr_t)bytes,
+        .iov_len = length
+    };
+    writerPtr->iovecCount += 1;
+}
+
+/**
+ * Get space in the scratch buffer for at least `length` generated bytes, flushing first if the scratch buffer is too
+ * full. The bytes are written out after a call to iovecWriterCommitScratch.
+ *
+ * @param writerPtr A pointer to the writer.
+ * @param length The number of bytes to reserve. It must not exceed the scratch capacity.
+ *
+ * @returns The reserved space.
+ */
+char *iovecWriterReserveScratch(struct IovecWriter * const writerPtr, size_t const length) {
+    guardNotNull(writerPtr, "writerPtr", "iovecWriterReserveScratch");
+    guard(
+        length <= writerPtr->scratchCapacity,
+        "iovecWriterReserveScratch: length must not exceed the scratch capacity"
+    );
+
+    // Also make room for the iovec now, since flushing after generating the bytes would discard them
+    bool const isScratchFull = writerPtr->scratchCapacity - writerPtr->scratchLength < length;
+    bool const isIovecListFull = writerPtr->iovecCount == writerPtr->iovecCapacity;
+    if (isScratchFull || isIovecListFull) {
+        iovecWriterFlush(writerPtr);
+    }
+    return writerPtr->scratch + writerPtr->scratchLength;
+}
+
+/**
+ * Append the first `length` bytes of the space returned by the last call to iovecWriterReserveScratch.
+ *
+ * @param writerPtr A pointer to the writer.
+ * @param length The number of bytes generated.
+ */
+void iovecWriterCommitScratch(struct IovecWriter * const writerPtr, size_t const length) {
+    guardNotNull(writerPtr, "writerPtr", "iovecWriterCommitScratch");
+    guard(
+        length <= writerPtr->scratchCapacity - writerPtr->scratchLength,
+        "iovecWriterCommitScratch: length must not exceed the reserved space"
+    );
+
+    char const * const bytes = writerPtr->scratch + writerPtr->scratchLength;
+    writerPtr->scratchLength += length;
+    iovecWriterAppend(writerPtr, bytes, length);
+}
+
+/**
+ * Write every referenced byte to the file descriptor, then reset the iovec list and scratch buffer. If the operation
+ * fails, abort the program with an error message.
+ *
+ * @param writerPtr A pointer to the writer.
+ */
+void iovecWriterFlush(struct IovecWriter * const writerPtr) {
+    guardNotNull(writerPtr, "writerPtr", "iovecWriterFlush");
+
+    for (size_t iovecIndex = 0; iovecIndex < writerPtr->iovecCount; iovecIndex += 1) {
+        writerPtr->writtenLength += writerPtr->iovecs[iovecIndex].iov_len;
+    }
+    if (writerPtr->iovecCount > 0) {
+        safeWritev(writerPtr->fileDescriptor, writerPtr->iovecs, writerPtr->iovecCount, "iovecWriterFlush");
+    }
+    writerPtr->iovecCount = 0;
+    writerPtr->scratchLength = 0;
+}
+
+/**
+ * Flush and destroy the given iovec writer. The file descriptor is not closed.
+ *
+ * @param writerPtr A pointer to the writer.
+ */
+void iovecWriterDestroy(struct IovecWriter * const writerPtr) {
+    guardNotNull(writerPtr, "writerPtr", "iovecWriterDestroy");
+
+    iovecWriterFlush(writerPtr);
+
+    free(writerPtr->iovecs);
+    writerPtr->iovecs = NULL;
+    free(writerPtr->scratch);
+    writerPtr->scratch = NULL;
+}
+
+static long long monotonicNanoseconds(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (long long)time.tv_sec * 1000000000 + time.tv_nsec;
+}
@@ -0,0 +1,114 @@
+#include "../../include/util/histogram.h"
+
+#include "../../include/util/guard.h"
+
+#include <stddef.h>
+#include <string.h>
+
+static size_t bucketIndex(unsigned long long value);
+static unsigned long long bucketHighestValue(size_t index);
+
+/**
+ * Initialize the given histogram with no values.
+ *
+ * @param histogramOutPtr A pointer to the memory where the histogram should be initialized.
+ */
+void hdrHistogramInit(struct HdrHistogram * const histogramOutPtr) {
+    guardNotNull(histogramOutPtr, "histogramOutPtr", "hdrHistogramInit");
+
+    memset(histogramOutPtr, 0, sizeof *histogramOutPtr);
+}
+
+/**
+ * Record a value.
+ *
+ * @param histogramPtr A pointer to the histogram.
+ * @param value The value.
+ */
+void hdrHistogramRecord(struct HdrHistogram * const histogramPtr, unsigned long long const value) {
+    guardNotNull(histogramPtr, "histogramPtr", "hdrHistogramRecord");
+
+    if (histogramPtr->count == 0 || value < histogramPtr->min) {
+        histogramPtr->min = value;
+    }
+    if (value > histogramPtr->max) {
+        histogramPtr->max = value;
+    }
+    histogramPtr->count += 1;
+    histogramPtr->sum += value;
+    histogramPtr->bucketCounts[bucketIndex(value)] += 1;
+}
+
+/**
+ * Get the value at or below which the given share of recorded values fall, to the histogram's precision.
+ *
+ * @param histogramPtr A pointer to the histogram.
+ * @param perMille The share, in thousandths: 500 for the median, 999 for the 99.9th percentile, 1000 for the maximum.
+ *
+ * @returns The highest value in the bucket holding that share (never above the maximum recorded), or 0 if no values
+ *          were recorded.
+ */
+unsigned long long hdrHistogramValueAtPerMille(
+    struct HdrHistogram const * const histogramPtr,
+    unsigned int const perMille
+) {
+    guardNotNull(histogramPtr, "histogramPtr", "hdrHistogramValueAtPerMille");
+    guard(perMille <= 1000, "hdrHistogramValueAtPerMille: perMille must be at most 1000");
+
+    if (histogramPtr->count == 0) {
+        return 0;
+    }
+
+    // The rank of the value, counting from 1, rounded up so that e.g. the median of two values is the first
+    unsigned long long rank = (histogramPtr->count * perMille + 999) / 1000;
+    rank = rank == 0 ? 1 : rank;
+
+    unsigned long long cumulativeCount = 0;
+    for (size_t index = 0; index < HDR_HISTOGRAM_BUCKET_COUNT; index += 1) {
+        cumulativeCount += histogramPtr->bucketCounts[index];
+        if (cumulativeCount >= rank) {
+            unsigned long long const value = bucketHighestValue(index);
+            return value < histogramPtr->max ? value : histogramPtr->max;
+        }
+    }
+    return histogramPtr->max;
+}
+
+/**
+ * Get the exact mean of the recorded values.
+ *
+ * @param histogramPtr A pointer to the histogram.
+ *
+ * @returns The mean, or 0 if no values were recorded.
+ */
+double hdrHistogramMean(struct HdrHistogram const * const histogramPtr) {
+    guardNotNull(histogramPtr, "histogramPtr", "hdrHistogramMean");
+
+    return histogramPtr->count == 0 ? 0 : (double)histogramPtr->sum / (double)histogramPtr->count;
+}
+
+/**
+ * Values below the sub-bucket count get a bucket each. Above that, the bucket is picked by the value's highest set
+ * bit, then by the next HDR_HISTOGRAM_SUB_BUCKET_BITS bits.
+ */
+static size_t bucketIndex(unsigned long long const value) {
+    if (value < HDR_HISTOGRAM_SUB_BUCKET_COUNT) {
+        return (size_t)value;
+    }
+
+    unsigned int const highestBit = 63 - (unsigned int)__builtin_clzll(value);
+    unsigned int const shift = highestBit - HDR_HISTOGRAM_SUB_BUCKET_BITS;
+    size_t const subBucket = (size_t)(value >> shift) & (HDR_HISTOGRAM_SUB_BUCKET_COUNT - 1);
+    return ((size_t)(shift + 1) << HDR_HISTOGRAM_SUB_BUCKET_BITS) + subBucket;
+}
+
+static unsigned long long bucketHighestValue(size_t const index) {
+    if (index < HDR_HISTOGRAM_SUB_BUCKET_COUNT) {
+        return index;
+    }
+
+    unsigned int const shift = (unsigned int)(index >> HDR_HISTOGRAM_SUB_BUCKET_BITS) - 1;
+    unsigned long long const subBucket = index & (HDR_HISTOGRAM_SUB_BUCKET_COUNT - 1);
+    unsigned long long const lowestValue = (HDR_HISTOGRAM_SUB_BUCKET_COUNT + subBucket) << shift;
+    return lowestValue + ((1ULL << shift) - 1);
+}
@@ -0,0 +1,516 @@
+#include "../../include/util/integer.h"
+
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INTEGER_SIMD_X86
+#endif
+
+/**
+ * A parse kernel parses as many short canonical lines (an optional '-', 1 to 8 digits, then '\n') as it can from the
+ * start of the input, and stops at the first line it cannot handle so that parseIntegerLine can take over.
+ */
+typedef size_t (*ParseIntegerLinesKernel)(char const **cursorPtr, char const *end, int *integers, size_t maxCount);
+
+static char const twoDigitTable[200] = {
+    '0','0', '0','1', '0','2', '0','3', '0','4', '0','5', '0','6', '0','7', '0','8', '0','9',
+    '1','0', '1','1', '1','2', '1','3', '1','4', '1','5', '1','6', '1','7', '1','8', '1','9',
+    '2','0', '2','1', '2','2', '2','3', '2','4', '2','5', '2','6', '2','7', '2','8', '2','9',
+    '3','0', '3','1', '3','2', '3','3', '3','4', '3','5', '3','6', '3','7', '3','8', '3','9',
+    '4','0', '4','1', '4','2', '4','3', '4','4', '4','5', '4','6', '4','7', '4','8', '4','9',
+    '5','0', '5','1', '5','2', '5','3', '5','4', '5','5', '5','6', '5','7', '5','8', '5','9',
+    '6','0', '6','1', '6','2', '6','3', '6','4', '6','5', '6','6', '6','7', '6','8', '6','9',
+    '7','0', '7','1', '7','2', '7','3', '7','4', '7','5', '7','6', '7','7', '7','8', '7','9',
+    '8','0', '8','1', '8','2', '8','3', '8','4', '8','5', '8','6', '8','7', '8','8', '8','9',
+    '9','0', '9','1', '9','2', '9','3', '9','4', '9','5', '9','6', '9','7', '9','8', '9','9'
+};
+
+static unsigned int countDecimalDigits(uint32_t magnitude);
+static ParseIntegerLinesKernel selectParseIntegerLinesKernel(void);
+static size_t parseIntegerLinesScalarKernel(
+    char const **cursorPtr,
+    char const *end,
+    int *integers,
+    size_t maxCount
+);
+#ifdef INTEGER_SIMD_X86
+static size_t parseIntegerLinesSse2Kernel(char const **cursorPtr, char const *end, int *integers, size_t maxCount);
+static size_t parseIntegerLinesAvx2Kernel(char const **cursorPtr, char const *end, int *integers, size_t maxCount);
+#endif
+static size_t parseNewlineMaskedWindow(
+    char const *window,
+    size_t windowLength,
+    uint64_t newlineMask,
+    int *integers,
+    size_t *countPtr,
+    size_t maxCount
+);
+static bool convertShortField(
+    char const *window,
+    size_t windowLength,
+    size_t fieldOffset,
+    size_t newlineOffset,
+    int *integerOutPtr
+);
+static bool isFormatWhitespace(char c);
+
+/**
+ * Parse the next integer from the given characters, with the same semantics as the "%d\n" scanf format: leading
+ * whitespace, an optional sign, at least one digit, then trailing whitespace. Unlike scanf, a value that does not fit
+ * in an int is reported rather than silently wrapped.
+ *
+ * @param cursorPtr A pointer to the cursor into the characters. On PARSED, the cursor is advanced past the integer and
+ *                  its trailing whitespace. On END_OF_INPUT and INCOMPLETE, it is advanced past the leading whitespace
+ *                  so that a caller refilling a buffer need not keep it. Otherwise, it is left unchanged.
+ * @param end The end of the available characters.
+ * @param isEndOfInput Whether no characters follow `end`. If false, an integer running up to `end` may continue past
+ *                     it, so INCOMPLETE is returned instead of parsing it.
+ * @param integerOutPtr A pointer to the memory where the parsed integer should be stored.
+ *
+ * @returns PARSED if an integer was parsed; END_OF_INPUT if only whitespace remained and isEndOfInput is true;
+ *          INCOMPLETE if more characters are needed; INVALID if the characters do not match the format; OVERFLOW if the
+ *          integer does not fit in an int.
+ */
+enum ParseIntegerLineResult parseIntegerLine(
+    char const ** const cursorPtr,
+    char const * const end,
+    bool const isEndOfInput,
+    int * const integerOutPtr
+) {
+    guardNotNull(cursorPtr, "cursorPtr", "parseIntegerLine");
+    guardNotNull(integerOutPtr, "integerOutPtr", "parseIntegerLine");
+
+    char const *cursor = *cursorPtr;
+    while (cursor < end && isFormatWhitespace(*cursor)) {
+        cursor += 1;
+    }
+    if (cursor == end) {
+        *cursorPtr = cursor;
+        return isEndOfInput ? PARSE_INTEGER_LINE_END_OF_INPUT : PARSE_INTEGER_LINE_INCOMPLETE;
+    }
+    char const * const integerStart = cursor;
+
+    bool const isNegative = *cursor == '-';
+    if (*cursor == '-' || *cursor == '+') {
+        cursor += 1;
+    }
+
+    // Accumulating in 64 bits and stopping as soon as the limit is passed means the magnitude itself can never wrap
+    uint64_t const maxMagnitude = isNegative ? (uint64_t)INT32_MAX + 1 : (uint64_t)INT32_MAX;
+    uint64_t magnitude = 0;
+    char const * const digitsStart = cursor;
+    while (cursor < end && (unsigned char)(*cursor - '0') <= 9) {
+        magnitude = magnitude * 10 + (uint64_t)(*cursor - '0');
+        if (magnitude > maxMagnitude) {
+            *cursorPtr = integerStart;
+            return PARSE_INTEGER_LINE_OVERFLOW;
+        }
+        cursor += 1;
+    }
+
+    if (cursor == end && !isEndOfInput) {
+        *cursorPtr = integerStart;
+        return PARSE_INTEGER_LINE_INCOMPLETE;
+    }
+    if (cursor == digitsStart) {
+        *cursorPtr = integerStart;
+        return PARSE_INTEGER_LINE_INVALID;
+    }
+
+    while (cursor < end && isFormatWhitespace(*cursor)) {
+        cursor += 1;
+    }
+
+    *integerOutPtr = isNegative ? (int)(0 - (int64_t)magnitude) : (int)magnitude;
+    *cursorPtr = cursor;
+    return PARSE_INTEGER_LINE_PARSED;
+}
+
+/**
+ * Parse the next integer from the given complete input (see parseIntegerLine). If the characters do not match the
+ * format or the integer does not fit in an int, abort the program with an error message.
+ *
+ * @param inputStart The start of the input, used to report the byte offset of a bad integer.
+ * @param cursorPtr A pointer to the cursor into the input.
+ * @param end The end of the input.
+ * @param integerOutPtr A pointer to the memory where the parsed integer should be stored.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns Whether an integer was parsed. False means only whitespace remained.
+ */
+bool parseIntegerLineExact(
+    char const * const inputStart,
+    char const ** const cursorPtr,
+    char const * const end,
+    int * const integerOutPtr,
+    char const * const callerDescription
+) {
+    enum ParseIntegerLineResult const result = parseIntegerLine(cursorPtr, end, true, integerOutPtr);
+    if (result == PARSE_INTEGER_LINE_PARSED) {
+        return true;
+    }
+    if (result == PARSE_INTEGER_LINE_END_OF_INPUT) {
+        return false;
+    }
+
+    abortWithParseIntegerLineError(result, (unsigned long long)(*cursorPtr - inputStart), callerDescription);
+    return false;
+}
+
+/**
+ * Parse up to maxCount integers from the given characters (see parseIntegerLine). Runs of short canonical lines are
+ * handled by a vectorized kernel that finds newlines a whole register at a time (AVX2 or SSE2, picked at runtime, with
+ * a scalar fallback) and converts each field with 8-digits-at-a-time arithmetic; anything else goes through
+ * parseIntegerLine one integer at a time.
+ *
+ * @param cursorPtr A pointer to the cursor into the characters, advanced past everything parsed.
+ * @param end The end of the available characters.
+ * @param isEndOfInput Whether no characters follow `end`.
+ * @param integers The array into which to store the parsed integers.
+ * @param maxCount The maximum number of integers to parse.
+ * @param lastResultOutPtr A pointer to the memory where the result that stopped parsing should be stored: PARSED if
+ *                         maxCount integers were parsed, or else the non-PARSED result of parseIntegerLine.
+ *
+ * @returns The number of integers parsed.
+ */
+size_t parseIntegerLines(
+    char const ** const cursorPtr,
+    char const * const end,
+    bool const isEndOfInput,
+    int * const integers,
+    size_t const maxCount,
+    enum ParseIntegerLineResult * const lastResultOutPtr
+) {
+    guardNotNull(cursorPtr, "cursorPtr", "parseIntegerLines");
+    guardNotNull(integers, "integers", "parseIntegerLines");
+    guardNotNull(lastResultOutPtr, "lastResultOutPtr", "parseIntegerLines");
+
+    ParseIntegerLinesKernel const kernel = selectParseIntegerLinesKernel();
+
+    size_t count = 0;
+    while (count < maxCount) {
+        count += kernel(cursorPtr, end, integers + count, maxCount - count);
+        if (count == maxCount) {
+            break;
+        }
+
+        enum ParseIntegerLineResult const result = parseIntegerLine(cursorPtr, end, isEndOfInput, &integers[count]);
+        if (result != PARSE_INTEGER_LINE_PARSED) {
+            *lastResultOutPtr = result;
+            return count;
+        }
+        count += 1;
+    }
+
+    *lastResultOutPtr = PARSE_INTEGER_LINE_PARSED;
+    return count;
+}
+
+/**
+ * Parse up to maxCount integers from the given complete input (see parseIntegerLines). If the characters do not match
+ * the format or an integer does not fit in an int, abort the program with an error message.
+ *
+ * @param inputStart The start of the input, used to report the byte offset of a bad integer.
+ * @param cursorPtr A pointer to the cursor into the input.
+ * @param end The end of the input.
+ * @param integers The array into which to store the parsed integers.
+ * @param maxCount The maximum number of integers to parse.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The number of integers parsed. Fewer than maxCount means only whitespace remained.
+ */
+size_t parseIntegerLinesExact(
+    char const * const inputStart,
+    char const ** const cursorPtr,
+    char const * const end,
+    int * const integers,
+    size_t const maxCount,
+    char const * const callerDescription
+) {
+    enum ParseIntegerLineResult lastResult;
+    size_t const count = parseIntegerLines(cursorPtr, end, true, integers, maxCount, &lastResult);
+    if (lastResult != PARSE_INTEGER_LINE_PARSED && lastResult != PARSE_INTEGER_LINE_END_OF_INPUT) {
+        abortWithParseIntegerLineError(lastResult, (unsigned long long)(*cursorPtr - inputStart), callerDescription);
+    }
+    return count;
+}
+
+/**
+ * Abort the program with an error message describing why an integer could not be parsed.
+ *
+ * @param result The INVALID or OVERFLOW parse result.
+ * @param byteOffset The byte offset of the integer within the input.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void abortWithParseIntegerLineError(
+    enum ParseIntegerLineResult const result,
+    unsigned long long const byteOffset,
+    char const * const callerDescription
+) {
+    guardNotNull(callerDescription, "callerDescription", "abortWithParseIntegerLineError");
+
+    switch (result) {
+        case PARSE_INTEGER_LINE_OVERFLOW:
+            abortWithErrorFmt("%s: Integer at byte offset %llu does not fit in an int", callerDescription, byteOffset);
+            break;
+        case PARSE_INTEGER_LINE_INVALID:
+        case PARSE_INTEGER_LINE_INCOMPLETE:
+            abortWithErrorFmt(
+                "%s: Failed to parse exact format \"%%d\\n\" at byte offset %llu",
+                callerDescription,
+                byteOffset
+            );
+            break;
+        case PARSE_INTEGER_LINE_PARSED:
+        case PARSE_INTEGER_LINE_END_OF_INPUT:
+        default:
+            abortWithErrorFmt("abortWithParseIntegerLineError: result %d is not an error", (int)result);
+            break;
+    }
+}
+
+static bool isFormatWhitespace(char const c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\v' || c == '\f' || c == '\r';
+}
+
+/**
+ * Get the number of characters formatIntegerLine would write for the given integer, without formatting it.
+ *
+ * @param integer The integer.
+ *
+ * @returns The length of the integer's decimal representation plus the newline.
+ */
+size_t formattedIntegerLineLength(int const integer) {
+    uint32_t magnitude = (uint32_t)integer;
+    size_t signLength = 0;
+    if (integer < 0) {
+        signLength = 1;
+        magnitude = 0 - magnitude;
+    }
+    return signLength + countDecimalDigits(magnitude) + 1;
+}
+
+/**
+ * Format the given integer as a "%d\n" line, writing two digits at a time from a lookup table instead of going through
+ * printf format interpretation.
+ *
+ * @param integer The integer.
+ * @param buffer The buffer into which to write. It must have room for INTEGER_LINE_MAX_LENGTH characters. No string
+ *               terminator is written.
+ *
+ * @returns The number of characters written, including the newline.
+ */
+size_t formatIntegerLine(int const integer, char * const buffer) {
+    guardNotNull(buffer, "buffer", "formatIntegerLine");
+
+    char *cursor = buffer;
+    uint32_t magnitude = (uint32_t)integer;
+    if (integer < 0) {
+        *cursor = '-';
+        cursor += 1;
+        magnitude = 0 - magnitude;
+    }
+
+    unsigned int const digitCount = countDecimalDigits(magnitude);
+    char *digitCursor = cursor + digitCount;
+    *digitCursor = '\n';
+
+    while (magnitude >= 100) {
+        uint32_t const twoDigits = magnitude % 100;
+        magnitude /= 100;
+        digitCursor -= 2;
+        memcpy(digitCursor, &twoDigitTable[twoDigits * 2], 2);
+    }
+    if (magnitude >= 10) {
+        digitCursor -= 2;
+        memcpy(digitCursor, &twoDigitTable[magnitude * 2], 2);
+    } else {
+        digitCursor -= 1;
+        *digitCursor = (char)('0' + magnitude);
+    }
+
+    return (size_t)(cursor - buffer) + digitCount + 1;
+}
+
+static unsigned int countDecimalDigits(uint32_t const magnitude) {
+    unsigned int digitCount = 1;
+    uint32_t threshold = 10;
+    while (digitCount < 10 && magnitude >= threshold) {
+        digitCount += 1;
+        threshold *= 10;
+    }
+    return digitCount;
+}
+
+static ParseIntegerLinesKernel selectParseIntegerLinesKernel(void) {
+#ifdef INTEGER_SIMD_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return parseIntegerLinesAvx2Kernel;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return parseIntegerLinesSse2Kernel;
+    }
+#endif
+    return parseIntegerLinesScalarKernel;
+}
+
+static size_t parseIntegerLinesScalarKernel(
+    char const ** const cursorPtr,
+    char const * const end,
+    int * const integers,
+    size_t const maxCount
+) {
+    size_t count = 0;
+    while (count < maxCount && end - *cursorPtr >= 16) {
+        uint64_t newlineMask = 0;
+        for (unsigned int byteIndex = 0; byteIndex < 16; byteIndex += 1) {
+            newlineMask |= (uint64_t)((*cursorPtr)[byteIndex] == '\n') << byteIndex;
+        }
+
+        size_t const consumedLength = parseNewlineMaskedWindow(*cursorPtr, 16, newlineMask, integers, &count, maxCount);
+        if (consumedLength == 0) {
+            break;
+        }
+        *cursorPtr += consumedLength;
+    }
+    return count;
+}
+
+#ifdef INTEGER_SIMD_X86
+__attribute__((target("sse2")))
+static size_t parseIntegerLinesSse2Kernel(
+    char const ** const cursorPtr,
+    char const * const end,
+    int * const integers,
+    size_t const maxCount
+) {
+    __m128i const newlines = _mm_set1_epi8('\n');
+
+    size_t count = 0;
+    while (count < maxCount && end - *cursorPtr >= 16) {
+        __m128i const window = _mm_loadu_si128((__m128i const *)*cursorPtr);
+        uint64_t const newlineMask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(window, newlines));
+
+        size_t const consumedLength = parseNewlineMaskedWindow(*cursorPtr, 16, newlineMask, integers, &count, maxCount);
+        if (consumedLength == 0) {
+            break;
+        }
+        *cursorPtr += consumedLength;
+    }
+    return count;
+}
+
+__attribute__((target("avx2")))
+static size_t parseIntegerLinesAvx2Kernel(
+    char const ** const cursorPtr,
+    char const * const end,
+    int * const integers,
+    size_t const maxCount
+) {
+    __m256i const newlines = _mm256_set1_epi8('\n');
+
+    size_t count = 0;
+    while (count < maxCount && end - *cursorPtr >= 32) {
+        __m256i const window = _mm256_loadu_si256((__m256i const *)*cursorPtr);
+        uint64_t const newlineMask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(window, newlines));
+
+        size_t const consumedLength = parseNewlineMaskedWindow(*cursorPtr, 32, newlineMask, integers, &count, maxCount);
+        if (consumedLength == 0) {
+            break;
+        }
+        *cursorPtr += consumedLength;
+    }
+    return count;
+}
+#endif
+
+/**
+ * Convert each newline-terminated field in the window, in order, stopping at the first one convertShortField rejects.
+ *
+ * @returns The number of bytes consumed, which is the offset just past the last converted field's newline.
+ */
+static size_t parseNewlineMaskedWindow(
+    char const * const window,
+    size_t const windowLength,
+    uint64_t newlineMask,
+    int * const integers,
+    size_t * const countPtr,
+    size_t const maxCount
+) {
+    size_t fieldOffset = 0;
+    while (newlineMask != 0 && *countPtr < maxCount) {
+        size_t const newlineOffset = (size_t)__builtin_ctzll(newlineMask);
+        if (!convertShortField(window, windowLength, fieldOffset, newlineOffset, &integers[*countPtr])) {
+            break;
+        }
+
+        *countPtr += 1;
+        fieldOffset = newlineOffset + 1;
+        newlineMask &= newlineMask - 1;
+    }
+    return fieldOffset;
+}
+
+/**
+ * Convert a field of an optional '-' followed by 1 to 8 digits. The digits are gathered into one 64-bit word (loaded
+ * from whichever side of the field stays inside the window), left-padded with '0' characters, validated, and then
+ * combined pairwise in three multiply steps.
+ *
+ * @returns Whether the field was converted. False means it must go through parseIntegerLine instead.
+ */
+static bool convertShortField(
+    char const * const window,
+    size_t const windowLength,
+    size_t const fieldOffset,
+    size_t const newlineOffset,
+    int * const integerOutPtr
+) {
+    bool const isNegative = fieldOffset < newlineOffset && window[fieldOffset] == '-';
+    size_t const digitsOffset = isNegative ? fieldOffset + 1 : fieldOffset;
+    size_t const digitCount = newlineOffset - digitsOffset;
+    if (digitCount == 0 || digitCount > 8) {
+        return false;
+    }
+
+    // Place the digits in the high bytes of the word, most significant digit first (little-endian)
+    uint64_t word;
+    if (newlineOffset >= 8) {
+        memcpy(&word, window + newlineOffset - 8, sizeof word);
+    } else {
+        assert(digitsOffset + sizeof word <= windowLength);
+        memcpy(&word, window + digitsOffset, sizeof word);
+        word <<= 8 * (8 - digitCount);
+    }
+    uint64_t const digitsMask = UINT64_MAX << (8 * (8 - digitCount));
+    word = (word & digitsMask) | (0x3030303030303030u & ~digitsMask);
+
+    // Every byte must be in '0'..'9': high nibble 3, and adding 6 must not carry out of the low nibble
+    if ((word & 0xF0F0F0F0F0F0F0F0u) != 0x3030303030303030u) {
+        return false;
+    }
+    if (((word + 0x0606060606060606u) & 0xF0F0F0F0F0F0F0F0u) != 0x3030303030303030u) {
+        return false;
+    }
+
+    word -= 0x3030303030303030u;
+    word = word * 10 + (word >> 8);
+    word = (
+        ((word & 0x000000FF000000FFu) * (100 + (1000000ull << 32)))
+        + (((word >> 16) & 0x000000FF000000FFu) * (1 + (10000ull << 32)))
+    ) >> 32;
+
+    int const magnitude = (int)(uint32_t)word;
+    *integerOutPtr = isNegative ? -magnitude : magnitude;
+    return true;
+}
@@ -0,0 +1,882 @@
+#define _GNU_SOURCE
+
+#include "../../include/util/ioring.h"
+
+#include "../../include/util/file.h"
+#include "../../include/util/memory.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#define IO_RING_BUFFER_ALIGNMENT 4096
+
+static struct io_uring_sqe *ioRingNextSubmissionEntry(struct IoRing *ringPtr, char const *callerDescription);
+static void ioRingQueue(
+    struct IoRing *ringPtr,
+    unsigned char readOrWriteOpcode,
+    unsigned char fixedOpcode,
+    int fileDescriptor,
+    struct IoRingSlot const *slots,
+    size_t slotIndex,
+    size_t length,
+    long long offset
+);
+static void ioRingUnmap(struct IoRing *ringPtr);
+
+static struct IoRingSlot *ioRingSlotsCreate(size_t slotCount, size_t slotCapacity, char const *callerDescription);
+static void ioRingSlotsDestroy(struct IoRingSlot *slots, size_t slotCount);
+
+static void ioRingReaderSubmitReads(struct IoRingReader *readerPtr, char const *callerDescription);
+static void ioRingReaderAwaitCompletion(struct IoRingReader *readerPtr, char const *callerDescription);
+static void ioRingReaderFinishShortRead(
+    struct IoRingReader *readerPtr,
+    struct IoRingSlot *slotPtr,
+    char const *callerDescription
+);
+
+static void ioRingWriterAwaitCompletion(struct IoRingWriter *writerPtr, char const *callerDescription);
+
+/**
+ * Set up an io_uring with at least the given number of submission entries and map its rings.
+ *
+ * @param ringOutPtr A pointer to the memory where the ring should be initialized.
+ * @param entryCount The minimum number of submission entries.
+ * @param callerDescription A description of the caller to be included in error messages. This could be the name of the
+ *                          calling function, plus extra information if useful.
+ *
+ * @returns Whether the ring was set up. False means io_uring is unavailable (e.g., an old kernel, or blocked by a
+ *          seccomp policy), and the caller should fall back to plain read/write.
+ */
+bool tryIoRingInit(
+    struct IoRing * const ringOutPtr,
+    unsigned int const entryCount,
+    char const * const callerDescription
+) {
+    guardNotNull(ringOutPtr, "ringOutPtr", "tryIoRingInit");
+    guardNotNull(callerDescription, "callerDescription", "tryIoRingInit");
+    guardFmt(entryCount > 0, "%s: tryIoRingInit entryCount must be positive", callerDescription);
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof params);
+    long const setupResult = syscall(__NR_io_uring_setup, entryCount, &params);
+    if (setupResult < 0) {
+        return false;
+    }
+
+    *ringOutPtr = (struct IoRing){
+        .ringFileDescriptor = (int)setupResult,
+        .submissionRingBytes = MAP_FAILED,
+        .completionRingBytes = MAP_FAILED,
+        .submissionEntries = MAP_FAILED,
+        .unsubmittedCount = 0,
+        .hasRegisteredBuffers = false
+    };
+
+    ringOutPtr->submissionRingLength = params.sq_off.array + params.sq_entries * sizeof (unsigned int);
+    ringOutPtr->completionRingLength = params.cq_off.cqes + params.cq_entries * sizeof (struct io_uring_cqe);
+    bool const isSingleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (isSingleMapping) {
+        if (ringOutPtr->completionRingLength > ringOutPtr->submissionRingLength) {
+            ringOutPtr->submissionRingLength = ringOutPtr->completionRingLength;
+        }
+        ringOutPtr->completionRingLength = ringOutPtr->submissionRingLength;
+    }
+
+    ringOutPtr->submissionRingBytes = mmap(
+        NULL,
+        ringOutPtr->submissionRingLength,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        ringOutPtr->ringFileDescriptor,
+        IORING_OFF_SQ_RING
+    );
+    if (ringOutPtr->submissionRingBytes == MAP_FAILED) {
+        ioRingUnmap(ringOutPtr);
+        close(ringOutPtr->ringFileDescriptor);
+        return false;
+    }
+    if (isSingleMapping) {
+        ringOutPtr->completionRingBytes = ringOutPtr->submissionRingBytes;
+    } else {
+        ringOutPtr->completionRingBytes = mmap(
+            NULL,
+            ringOutPtr->completionRingLength,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE,
+            ringOutPtr->ringFileDescriptor,
+            IORING_OFF_CQ_RING
+        );
+    }
+    ringOutPtr->submissionEntriesLength = params.sq_entries * sizeof (struct io_uring_sqe);
+    ringOutPtr->submissionEntries = mmap(
+        NULL,
+        ringOutPtr->submissionEntriesLength,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        ringOutPtr->ringFileDescriptor,
+        (off_t)IORING_OFF_SQES
+    );
+    if (ringOutPtr->completionRingBytes == MAP_FAILED || ringOutPtr->submissionEntries == MAP_FAILED) {
+        ioRingUnmap(ringOutPtr);
+        close(ringOutPtr->ringFileDescriptor);
+        return false;
+    }
+
+    unsigned char * const submissionRingBytes = ringOutPtr->submissionRingBytes;
+    ringOutPtr->submissionHeadPtr = (atomic_uint *)(void *)(submissionRingBytes + params.sq_off.head);
+    ringOutPtr->submissionTailPtr = (atomic_uint *)(void *)(submissionRingBytes + params.sq_off.tail);
+    ringOutPtr->submissionRingMask = *(unsigned int *)(void *)(submissionRingBytes + params.sq_off.ring_mask);
+    ringOutPtr->submissionIndices = (unsigned int *)(void *)(submissionRingBytes + params.sq_off.array);
+
+    unsigned char * const completionRingBytes = ringOutPtr->completionRingBytes;
+    ringOutPtr->completionHeadPtr = (atomic_uint *)(void *)(completionRingBytes + params.cq_off.head);
+    ringOutPtr->completionTailPtr = (atomic_uint *)(void *)(completionRingBytes + params.cq_off.tail);
+    ringOutPtr->completionRingMask = *(unsigned int *)(void *)(completionRingBytes + params.cq_off.ring_mask);
+    ringOutPtr->completionEntries = completionRingBytes + params.cq_off.cqes;
+
+    return true;
+}
+
+/**
+ * Register the given slots' buffers with the ring, so reads and writes using them skip the per-operation page pinning.
+ *
+ * @param ringPtr A pointer to the ring.
+ * @param slots The slots.
+ * @param slotCount The number of slots.
+ *
+ * @returns Whether the buffers were registered. Registration can fail under a low RLIMIT_MEMLOCK; the ring still works
+ *          without it.
+ */
+bool tryIoRingRegisterBuffers(
+    struct IoRing * const ringPtr,
+    struct IoRingSlot const * const slots,
+    size_t const slotCount
+) {
+    guardNotNull(ringPtr, "ringPtr", "tryIoRingRegisterBuffers");
+    guardNotNull(slots, "slots", "tryIoRingRegisterBuffers");
+
+    struct iovec * const iovecs = safeMalloc(sizeof *iovecs * slotCount, "tryIoRingRegisterBuffers");
+    for (size_t slotIndex = 0; slotIndex < slotCount; slotIndex += 1) {
+        iovecs[slotIndex] = (struct iovec){ .iov_base = slots[slotIndex].buffer, .iov_len = slots[slotIndex].length };
+    }
+    long const registerResult = syscall(
+        __NR_io_uring_register,
+        ringPtr->ringFileDescriptor,
+        IORING_REGISTER_BUFFERS,
+        iovecs,
+        (unsigned int)slotCount
+    );
+    free(iovecs);
+
+    ringPtr->hasRegisteredBuffers = registerResult == 0;
+    return ringPtr->hasRegisteredBuffers;
+}
+
+/**
+ * Queue a read of up to `length` bytes into the given slot's buffer. The slot index is the completion's user data.
+ *
+ * @param offset The file offset to read from, or -1 to read from the current file position.
+ */
+void ioRingQueueRead(
+    struct IoRing * const ringPtr,
+    int const fileDescriptor,
+    struct IoRingSlot const * const slots,
+    size_t const slotIndex,
+    size_t const length,
+    long long const offset
+) {
+    ioRingQueue(ringPtr, IORING_OP_READ, IORING_OP_READ_FIXED, fileDescriptor, slots, slotIndex, length, offset);
+}
+
+/**
+ * Queue a write of the given slot's buffered bytes. The slot index is the completion's user data.
+ *
+ * @param offset The file offset to write at, or -1 to write at the current file position.
+ */
+void ioRingQueueWrite(
+    struct IoRing * const ringPtr,
+    int const fileDescriptor,
+    struct IoRingSlot const * const slots,
+    size_t const slotIndex,
+    long long const offset
+) {
+    ioRingQueue(
+        ringPtr,
+        IORING_OP_WRITE,
+        IORING_OP_WRITE_FIXED,
+        fileDescriptor,
+        slots,
+        slotIndex,
+        slots[slotIndex].length,
+        offset
+    );
+}
+
+/**
+ * Submit all queued operations, and optionally wait for completions. If the operation fails, abort the program with an
+ * error message.
+ *
+ * @param ringPtr A pointer to the ring.
+ * @param minCompleteCount The number of completions to wait for, or 0 to not wait.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void ioRingSubmit(
+    struct IoRing * const ringPtr,
+    unsigned int const minCompleteCount,
+    char const * const callerDescription
+) {
+    guardNotNull(ringPtr, "ringPtr", "ioRingSubmit");
+    guardNotNull(callerDescription, "callerDescription", "ioRingSubmit");
+
+    while (true) {
+        unsigned int const enterFlags = minCompleteCount > 0 ? IORING_ENTER_GETEVENTS : 0;
+        long const enterResult = syscall(
+            __NR_io_uring_enter,
+            ringPtr->ringFileDescriptor,
+            ringPtr->unsubmittedCount,
+            minCompleteCount,
+            enterFlags,
+            NULL,
+            0
+        );
+        if (enterResult >= 0) {
+            ringPtr->unsubmittedCount -= (unsigned int)enterResult;
+            if (ringPtr->unsubmittedCount == 0) {
+                return;
+            }
+            continue;
+        }
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+            continue;
+        }
+
+        int const enterErrorCode = errno;
+        char const * const enterErrorMessage = strerror(enterErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to submit %u operations using io_uring_enter (error code: %d; error message: \"%s\")",
+            callerDescription,
+            ringPtr->unsubmittedCount,
+            enterErrorCode,
+            enterErrorMessage
+        );
+        return;
+    }
+}
+
+/**
+ * Take the oldest completion off of the completion queue, if there is one.
+ *
+ * @param ringPtr A pointer to the ring.
+ * @param userDataOutPtr Where to store the completed operation's user data.
+ * @param resultOutPtr Where to store the completed operation's result: a byte count, or a negated errno value.
+ *
+ * @returns Whether there was a completion.
+ */
+bool ioRingPopCompletion(
+    struct IoRing * const ringPtr,
+    unsigned long long * const userDataOutPtr,
+    int * const resultOutPtr
+) {
+    guardNotNull(ringPtr, "ringPtr", "ioRingPopCompletion");
+    guardNotNull(userDataOutPtr, "userDataOutPtr", "ioRingPopCompletion");
+    guardNotNull(resultOutPtr, "resultOutPtr", "ioRingPopCompletion");
+
+    unsigned int const head = atomic_load_explicit(ringPtr->completionHeadPtr, memory_order_relaxed);
+    unsigned int const tail = atomic_load_explicit(ringPtr->completionTailPtr, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+
+    struct io_uring_cqe const * const completionEntries = ringPtr->completionEntries;
+    struct io_uring_cqe const * const completionEntryPtr = &completionEntries[head & ringPtr->completionRingMask];
+    *userDataOutPtr = completionEntryPtr->user_data;
+    *resultOutPtr = completionEntryPtr->res;
+
+    atomic_store_explicit(ringPtr->completionHeadPtr, head + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Tear down the given ring. Any operations still in flight must have completed, as their buffers may be freed next.
+ *
+ * @param ringPtr A pointer to the ring.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void ioRingDestroy(struct IoRing * const ringPtr, char const * const callerDescription) {
+    guardNotNull(ringPtr, "ringPtr", "ioRingDestroy");
+    guardNotNull(callerDescription, "callerDescription", "ioRingDestroy");
+
+    ioRingUnmap(ringPtr);
+    safeClose(ringPtr->ringFileDescriptor, callerDescription);
+}
+
+/**
+ * Initialize the given reader and start reading ahead.
+ *
+ * @param readerOutPtr A pointer to the memory where the reader should be initialized.
+ * @param fileDescriptor The file descriptor, open for reading. The reader does not close it.
+ * @param slotCount The number of fixed buffers.
+ * @param slotCapacity The size of each fixed buffer, in bytes.
+ * @param callerDescription A description of the caller to be included in error messages. This could be the name of the
+ *                          calling function, plus extra information if useful.
+ *
+ * @returns Whether the reader was initialized. False means io_uring is unavailable.
+ */
+bool tryIoRingReaderInit(
+    struct IoRingReader * const readerOutPtr,
+    int const fileDescriptor,
+    size_t const slotCount,
+    size_t const slotCapacity,
+    char const * const callerDescription
+) {
+    guardNotNull(readerOutPtr, "readerOutPtr", "tryIoRingReaderInit");
+    guardNotNull(callerDescription, "callerDescription", "tryIoRingReaderInit");
+    guardFmt(slotCount > 0, "%s: tryIoRingReaderInit slotCount must be positive", callerDescription);
+    guardFmt(slotCapacity > 0, "%s: tryIoRingReaderInit slotCapacity must be positive", callerDescription);
+
+    if (!tryIoRingInit(&readerOutPtr->ring, (unsigned int)slotCount, callerDescription)) {
+        return false;
+    }
+
+    readerOutPtr->fileDescriptor = fileDescriptor;
+    readerOutPtr->isSeekable = isRegularFile(fileDescriptor, callerDescription);
+    readerOutPtr->slots = ioRingSlotsCreate(slotCount, slotCapacity, callerDescription);
+    readerOutPtr->slotCount = slotCount;
+    readerOutPtr->slotCapacity = slotCapacity;
+    readerOutPtr->nextSubmitSlotIndex = 0;
+    readerOutPtr->nextConsumeSlotIndex = 0;
+    readerOutPtr->inFlightCount = 0;
+    // The file may have been partly consumed already, as an inherited standard input can be
+    readerOutPtr->nextReadOffset = readerOutPtr->isSeekable ? safeTell(fileDescriptor, callerDescription) : 0;
+    readerOutPtr->consumedOffset = readerOutPtr->nextReadOffset;
+    readerOutPtr->isEndOfFileSubmitted = false;
+    readerOutPtr->isEndOfFile = false;
+
+    tryIoRingRegisterBuffers(&readerOutPtr->ring, readerOutPtr->slots, slotCount);
+    for (size_t slotIndex = 0; slotIndex < slotCount; slotIndex += 1) {
+        readerOutPtr->slots[slotIndex].length = 0;
+    }
+
+    ioRingReaderSubmitReads(readerOutPtr, callerDescription);
+    return true;
+}
+
+/**
+ * Copy up to `length` bytes of the file, in order, into the given buffer. This has the same contract as safeRead. If a
+ * read fails, abort the program with an error message.
+ *
+ * @param readerPtr A pointer to the reader.
+ * @param buffer The buffer into which to copy.
+ * @param length The maximum number of bytes to copy.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The number of bytes copied. 0 means the end of the file was reached.
+ */
+size_t ioRingReaderRead(
+    struct IoRingReader * const readerPtr,
+    void * const buffer,
+    size_t const length,
+    char const * const callerDescription
+) {
+    guardNotNull(readerPtr, "readerPtr", "ioRingReaderRead");
+    guardNotNull(buffer, "buffer", "ioRingReaderRead");
+    guardNotNull(callerDescription, "callerDescription", "ioRingReaderRead");
+
+    if (readerPtr->isEndOfFile || length == 0) {
+        return 0;
+    }
+
+    struct IoRingSlot * const slotPtr = &readerPtr->slots[readerPtr->nextConsumeSlotIndex];
+    if (!slotPtr->isInFlight && !slotPtr->isComplete) {
+        ioRingReaderSubmitReads(readerPtr, callerDescription);
+        if (!slotPtr->isInFlight) {
+            // Nothing left to read was submitted, since an earlier read already reached the end of the file
+            readerPtr->isEndOfFile = true;
+            return 0;
+        }
+    }
+    while (!slotPtr->isComplete) {
+        ioRingReaderAwaitCompletion(readerPtr, callerDescription);
+    }
+
+    if (slotPtr->length == 0) {
+        readerPtr->isEndOfFile = true;
+        return 0;
+    }
+
+    size_t const availableLength = slotPtr->length - slotPtr->consumedLength;
+    size_t const copyLength = length < availableLength ? length : availableLength;
+    memcpy(buffer, slotPtr->buffer + slotPtr->consumedLength, copyLength);
+    slotPtr->consumedLength += copyLength;
+    readerPtr->consumedOffset += copyLength;
+
+    if (slotPtr->consumedLength == slotPtr->length) {
+        slotPtr->isComplete = false;
+        slotPtr->length = 0;
+        slotPtr->consumedLength = 0;
+        readerPtr->nextConsumeSlotIndex = (readerPtr->nextConsumeSlotIndex + 1) % readerPtr->slotCount;
+        ioRingReaderSubmitReads(readerPtr, callerDescription);
+    }
+
+    return copyLength;
+}
+
+/**
+ * Destroy the given reader, waiting for any reads still in flight. The file descriptor is not closed.
+ *
+ * @param readerPtr A pointer to the reader.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void ioRingReaderDestroy(struct IoRingReader * const readerPtr, char const * const callerDescription) {
+    guardNotNull(readerPtr, "readerPtr", "ioRingReaderDestroy");
+    guardNotNull(callerDescription, "callerDescription", "ioRingReaderDestroy");
+
+    // Reads past the point where the consumer stopped are simply discarded, but their buffers must outlive them
+    readerPtr->isEndOfFile = true;
+    while (readerPtr->inFlightCount > 0) {
+        ioRingReaderAwaitCompletion(readerPtr, callerDescription);
+    }
+
+    // Leave the file descriptor where a plain reader would have, just past what was consumed
+    if (readerPtr->isSeekable) {
+        safeSeek(readerPtr->fileDescriptor, readerPtr->consumedOffset, callerDescription);
+    }
+
+    ioRingDestroy(&readerPtr->ring, callerDescription);
+    ioRingSlotsDestroy(readerPtr->slots, readerPtr->slotCount);
+    readerPtr->slots = NULL;
+}
+
+/**
+ * Initialize the given writer.
+ *
+ * @param writerOutPtr A pointer to the memory where the writer should be initialized.
+ * @param fileDescriptor The file descriptor, open for writing. The writer does not close it.
+ * @param slotCount The number of fixed buffers. One is filled while the others are written.
+ * @param slotCapacity The size of each fixed buffer, in bytes.
+ * @param callerDescription A description of the caller to be included in error messages. This could be the name of the
+ *                          calling function, plus extra information if useful.
+ *
+ * @returns Whether the writer was initialized. False means io_uring is unavailable.
+ */
+bool tryIoRingWriterInit(
+    struct IoRingWriter * const writerOutPtr,
+    int const fileDescriptor,
+    size_t const slotCount,
+    size_t const slotCapacity,
+    char const * const callerDescription
+) {
+    guardNotNull(writerOutPtr, "writerOutPtr", "tryIoRingWriterInit");
+    guardNotNull(callerDescription, "callerDescription", "tryIoRingWriterInit");
+    guardFmt(slotCount > 0, "%s: tryIoRingWriterInit slotCount must be positive", callerDescription);
+    guardFmt(slotCapacity > 0, "%s: tryIoRingWriterInit slotCapacity must be positive", callerDescription);
+
+    if (!tryIoRingInit(&writerOutPtr->ring, (unsigned int)slotCount, callerDescription)) {
+        return false;
+    }
+
+    writerOutPtr->fileDescriptor = fileDescriptor;
+    // Appending writes ignore their offsets, so several in flight could land out of order
+    writerOutPtr->isSeekable = isRegularFile(fileDescriptor, callerDescription)
+        && !isAppending(fileDescriptor, callerDescription);
+    writerOutPtr->slots = ioRingSlotsCreate(slotCount, slotCapacity, callerDescription);
+    writerOutPtr->slotCount = slotCount;
+    writerOutPtr->slotCapacity = slotCapacity;
+    writerOutPtr->currentSlotIndex = 0;
+    writerOutPtr->inFlightCount = 0;
+    // The file may have been written to already, as an inherited standard output can be
+    writerOutPtr->nextWriteOffset = writerOutPtr->isSeekable ? safeTell(fileDescriptor, callerDescription) : 0;
+
+    tryIoRingRegisterBuffers(&writerOutPtr->ring, writerOutPtr->slots, slotCount);
+    for (size_t slotIndex = 0; slotIndex < slotCount; slotIndex += 1) {
+        writerOutPtr->slots[slotIndex].length = 0;
+    }
+
+    return true;
+}
+
+/**
+ * Get the writer's current fixed buffer for the caller to fill, waiting for its previous write to complete first. The
+ * caller writes up to `slotCapacity` bytes into it and then submits them with ioRingWriterSubmit, so output is written
+ * straight from the registered buffers without being copied into them.
+ *
+ * @param writerPtr A pointer to the writer.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The buffer, which is `slotCapacity` bytes long. It is the same one until the next submit.
+ */
+char *ioRingWriterAcquire(struct IoRingWriter * const writerPtr, char const * const callerDescription) {
+    guardNotNull(writerPtr, "writerPtr", "ioRingWriterAcquire");
+    guardNotNull(callerDescription, "callerDescription", "ioRingWriterAcquire");
+
+    struct IoRingSlot * const slotPtr = &writerPtr->slots[writerPtr->currentSlotIndex];
+    while (slotPtr->isInFlight) {
+        ioRingWriterAwaitCompletion(writerPtr, callerDescription);
+    }
+    return slotPtr->buffer;
+}
+
+/**
+ * Submit the write of the first `length` bytes of the buffer from ioRingWriterAcquire, without waiting for it. The
+ * next acquire moves on to the next buffer.
+ *
+ * @param writerPtr A pointer to the writer.
+ * @param length The number of bytes filled in. Nothing is submitted if it is 0.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void ioRingWriterSubmit(
+    struct IoRingWriter * const writerPtr,
+    size_t const length,
+    char const * const callerDescription
+) {
+    guardNotNull(writerPtr, "writerPtr", "ioRingWriterSubmit");
+    guardNotNull(callerDescription, "callerDescription", "ioRingWriterSubmit");
+    guardFmt(
+        length <= writerPtr->slotCapacity,
+        "%s: ioRingWriterSubmit length exceeds the %zu byte buffer",
+        callerDescription,
+        writerPtr->slotCapacity
+    );
+
+    struct IoRingSlot * const slotPtr = &writerPtr->slots[writerPtr->currentSlotIndex];
+    guardFmt(!slotPtr->isInFlight, "%s: ioRingWriterSubmit called without ioRingWriterAcquire", callerDescription);
+    if (length == 0) {
+        return;
+    }
+
+    // Writes at the current file position could be reordered, so keep only one in flight
+    if (!writerPtr->isSeekable) {
+        while (writerPtr->inFlightCount > 0) {
+            ioRingWriterAwaitCompletion(writerPtr, callerDescription);
+        }
+    }
+
+    slotPtr->length = length;
+    long long const offset = writerPtr->isSeekable ? (long long)writerPtr->nextWriteOffset : -1;
+    ioRingQueueWrite(
+        &writerPtr->ring,
+        writerPtr->fileDescriptor,
+        writerPtr->slots,
+        writerPtr->currentSlotIndex,
+        offset
+    );
+    ioRingSubmit(&writerPtr->ring, 0, callerDescription);
+
+    slotPtr->isInFlight = true;
+    slotPtr->offset = writerPtr->nextWriteOffset;
+    writerPtr->inFlightCount += 1;
+    writerPtr->nextWriteOffset += length;
+    writerPtr->currentSlotIndex = (writerPtr->currentSlotIndex + 1) % writerPtr->slotCount;
+}
+
+/**
+ * Wait for every submitted write to complete, and destroy the given writer. An acquired buffer that was not submitted
+ * is discarded. The file descriptor is not closed.
+ *
+ * @param writerPtr A pointer to the writer.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void ioRingWriterDestroy(struct IoRingWriter * const writerPtr, char const * const callerDescription) {
+    guardNotNull(writerPtr, "writerPtr", "ioRingWriterDestroy");
+    guardNotNull(callerDescription, "callerDescription", "ioRingWriterDestroy");
+
+    while (writerPtr->inFlightCount > 0) {
+        ioRingWriterAwaitCompletion(writerPtr, callerDescription);
+    }
+
+    // Leave the file descriptor where a plain writer would have, so later writes to it follow the output
+    if (writerPtr->isSeekable) {
+        safeSeek(writerPtr->fileDescriptor, writerPtr->nextWriteOffset, callerDescription);
+    }
+
+    ioRingDestroy(&writerPtr->ring, callerDescription);
+    ioRingSlotsDestroy(writerPtr->slots, writerPtr->slotCount);
+    writerPtr->slots = NULL;
+}
+
+static struct io_uring_sqe *ioRingNextSubmissionEntry(
+    struct IoRing * const ringPtr,
+    char const * const callerDescription
+) {
+    unsigned int const tail = atomic_load_explicit(ringPtr->submissionTailPtr, memory_order_relaxed);
+    unsigned int const head = atomic_load_explicit(ringPtr->submissionHeadPtr, memory_order_acquire);
+    if (tail - head > ringPtr->submissionRingMask) {
+        ioRingSubmit(ringPtr, 0, callerDescription);
+    }
+
+    unsigned int const index = tail & ringPtr->submissionRingMask;
+    struct io_uring_sqe * const submissionEntries = ringPtr->submissionEntries;
+    struct io_uring_sqe * const submissionEntryPtr = &submissionEntries[index];
+    memset(submissionEntryPtr, 0, sizeof *submissionEntryPtr);
+    ringPtr->submissionIndices[index] = index;
+    return submissionEntryPtr;
+}
+
+static void ioRingQueue(
+    struct IoRing * const ringPtr,
+    unsigned char const readOrWriteOpcode,
+    unsigned char const fixedOpcode,
+    int const fileDescriptor,
+    struct IoRingSlot const * const slots,
+    size_t const slotIndex,
+    size_t const length,
+    long long const offset
+) {
+    guardNotNull(ringPtr, "ringPtr", "ioRingQueue");
+    guardNotNull(slots, "slots", "ioRingQueue");
+
+    struct io_uring_sqe * const submissionEntryPtr = ioRingNextSubmissionEntry(ringPtr, "ioRingQueue");
+    submissionEntryPtr->opcode = ringPtr->hasRegisteredBuffers ? fixedOpcode : readOrWriteOpcode;
+    submissionEntryPtr->fd = fileDescriptor;
+    submissionEntryPtr->addr = (unsigned long long)(uintptr_t)slots[slotIndex].buffer;
+    submissionEntryPtr->len = (unsigned int)length;
+    submissionEntryPtr->off = (unsigned long long)offset;
+    submissionEntryPtr->user_data = slotIndex;
+    if (ringPtr->hasRegisteredBuffers) {
+        submissionEntryPtr->buf_index = (unsigned short)slotIndex;
+    }
+
+    unsigned int const tail = atomic_load_explicit(ringPtr->submissionTailPtr, memory_order_relaxed);
+    atomic_store_explicit(ringPtr->submissionTailPtr, tail + 1, memory_order_release);
+    ringPtr->unsubmittedCount += 1;
+}
+
+static void ioRingUnmap(struct IoRing * const ringPtr) {
+    if (ringPtr->submissionEntries != MAP_FAILED) {
+        munmap(ringPtr->submissionEntries, ringPtr->submissionEntriesLength);
+    }
+    if (ringPtr->completionRingBytes != MAP_FAILED && ringPtr->completionRingBytes != ringPtr->submissionRingBytes) {
+        munmap(ringPtr->completionRingBytes, ringPtr->completionRingLength);
+    }
+    if (ringPtr->submissionRingBytes != MAP_FAILED) {
+        munmap(ringPtr->submissionRingBytes, ringPtr->submissionRingLength);
+    }
+    ringPtr->submissionEntries = MAP_FAILED;
+    ringPtr->completionRingBytes = MAP_FAILED;
+    ringPtr->submissionRingBytes = MAP_FAILED;
+}
+
+/**
+ * Allocate the given number of page-aligned slots. Each slot's length is set to its capacity, for buffer registration.
+ */
+static struct IoRingSlot *ioRingSlotsCreate(
+    size_t const slotCount,
+    size_t const slotCapacity,
+    char const * const callerDescription
+) {
+    struct IoRingSlot * const slots = safeMalloc(sizeof *slots * slotCount, callerDescription);
+    for (size_t slotIndex = 0; slotIndex < slotCount; slotIndex += 1) {
+        slots[slotIndex] = (struct IoRingSlot){
+            .buffer = safeAlignedMalloc(IO_RING_BUFFER_ALIGNMENT, slotCapacity, callerDescription),
+            .length = slotCapacity,
+            .consumedLength = 0,
+            .offset = 0,
+            .isInFlight = false,
+            .isComplete = false
+        };
+    }
+    return slots;
+}
+
+static void ioRingSlotsDestroy(struct IoRingSlot * const slots, size_t const slotCount) {
+    for (size_t slotIndex = 0; slotIndex < slotCount; slotIndex += 1) {
+        free(slots[slotIndex].buffer);
+    }
+    free(slots);
+}
+
+/**
+ * Start reads into free slots, in order, until every slot is busy. Reads at the current file position could be
+ * reordered, so a non-seekable file only ever has one read in flight.
+ */
+static void ioRingReaderSubmitReads(struct IoRingReader * const readerPtr, char const * const callerDescription) {
+    size_t const maxInFlightCount = readerPtr->isSeekable ? readerPtr->slotCount : 1;
+
+    bool isAnySubmitted = false;
+    while (!readerPtr->isEndOfFileSubmitted && readerPtr->inFlightCount < maxInFlightCount) {
+        struct IoRingSlot * const slotPtr = &readerPtr->slots[readerPtr->nextSubmitSlotIndex];
+        if (slotPtr->isInFlight || slotPtr->isComplete) {
+            break;
+        }
+
+        long long const offset = readerPtr->isSeekable ? (long long)readerPtr->nextReadOffset : -1;
+        ioRingQueueRead(
+            &readerPtr->ring,
+            readerPtr->fileDescriptor,
+            readerPtr->slots,
+            readerPtr->nextSubmitSlotIndex,
+            readerPtr->slotCapacity,
+            offset
+        );
+        isAnySubmitted = true;
+
+        slotPtr->isInFlight = true;
+        slotPtr->consumedLength = 0;
+        slotPtr->offset = readerPtr->nextReadOffset;
+        readerPtr->inFlightCount += 1;
+        readerPtr->nextSubmitSlotIndex = (readerPtr->nextSubmitSlotIndex + 1) % readerPtr->slotCount;
+        readerPtr->nextReadOffset += readerPtr->slotCapacity;
+    }
+
+    if (isAnySubmitted) {
+        ioRingSubmit(&readerPtr->ring, 0, callerDescription);
+    }
+}
+
+/**
+ * Wait for one read to complete and record its result in its slot.
+ */
+static void ioRingReaderAwaitCompletion(struct IoRingReader * const readerPtr, char const * const callerDescription) {
+    unsigned long long slotIndex;
+    int result;
+    while (!ioRingPopCompletion(&readerPtr->ring, &slotIndex, &result)) {
+        ioRingSubmit(&readerPtr->ring, 1, callerDescription);
+    }
+
+    struct IoRingSlot * const slotPtr = &readerPtr->slots[slotIndex];
+    slotPtr->isInFlight = false;
+    slotPtr->isComplete = true;
+    readerPtr->inFlightCount -= 1;
+    if (readerPtr->isEndOfFile) {
+        return;
+    }
+
+    if (result < 0) {
+        int const readErrorCode = -result;
+        char const * const readErrorMessage = strerror(readErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to read file descriptor %d using io_uring (error code: %d; error message: \"%s\")",
+            callerDescription,
+            readerPtr->fileDescriptor,
+            readErrorCode,
+            readErrorMessage
+        );
+        return;
+    }
+
+    slotPtr->length = (size_t)result;
+    if (result == 0) {
+        readerPtr->isEndOfFileSubmitted = true;
+    } else if (readerPtr->isSeekable && slotPtr->length < readerPtr->slotCapacity) {
+        ioRingReaderFinishShortRead(readerPtr, slotPtr, callerDescription);
+    } else if (!readerPtr->isSeekable) {
+        ioRingReaderSubmitReads(readerPtr, callerDescription);
+    }
+}
+
+/**
+ * Fill the rest of a slot whose read at an explicit offset came back short. Later slots were already submitted for the
+ * following offsets, so the gap must be closed here; a 0-byte read means the end of the file really was reached.
+ */
+static void ioRingReaderFinishShortRead(
+    struct IoRingReader * const readerPtr,
+    struct IoRingSlot * const slotPtr,
+    char const * const callerDescription
+) {
+    while (slotPtr->length < readerPtr->slotCapacity) {
+        ssize_t const readResult = pread(
+            readerPtr->fileDescriptor,
+            slotPtr->buffer + slotPtr->length,
+            readerPtr->slotCapacity - slotPtr->length,
+            (off_t)(slotPtr->offset + slotPtr->length)
+        );
+        if (readResult > 0) {
+            slotPtr->length += (size_t)readResult;
+            continue;
+        }
+        if (readResult == 0) {
+            readerPtr->isEndOfFileSubmitted = true;
+            return;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+
+        int const preadErrorCode = errno;
+        char const * const preadErrorMessage = strerror(preadErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to read file descriptor %d using pread (error code: %d; error message: \"%s\")",
+            callerDescription,
+            readerPtr->fileDescriptor,
+            preadErrorCode,
+            preadErrorMessage
+        );
+        return;
+    }
+}
+
+/**
+ * Wait for one write to complete. A short write has its remainder written synchronously, which keeps the output in
+ * order since later writes are at later explicit offsets (or, for non-seekable files, not yet submitted).
+ */
+static void ioRingWriterAwaitCompletion(struct IoRingWriter * const writerPtr, char const * const callerDescription) {
+    unsigned long long slotIndex;
+    int result;
+    while (!ioRingPopCompletion(&writerPtr->ring, &slotIndex, &result)) {
+        ioRingSubmit(&writerPtr->ring, 1, callerDescription);
+    }
+
+    struct IoRingSlot * const slotPtr = &writerPtr->slots[slotIndex];
+    writerPtr->inFlightCount -= 1;
+
+    if (result < 0) {
+        int const writeErrorCode = -result;
+        char const * const writeErrorMessage = strerror(writeErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to write %zu bytes to file descriptor %d using io_uring "
+                "(error code: %d; error message: \"%s\")",
+            callerDescription,
+            slotPtr->length,
+            writerPtr->fileDescriptor,
+            writeErrorCode,
+            writeErrorMessage
+        );
+        return;
+    }
+
+    size_t const writtenLength = (size_t)result;
+    if (writtenLength < slotPtr->length) {
+        if (writerPtr->isSeekable) {
+            safePwrite(
+                writerPtr->fileDescriptor,
+                slotPtr->buffer + writtenLength,
+                slotPtr->length - writtenLength,
+                slotPtr->offset + writtenLength,
+                callerDescription
+            );
+        } else {
+            safeWrite(
+                writerPtr->fileDescriptor,
+                slotPtr->buffer + writtenLength,
+                slotPtr->length - writtenLength,
+                callerDescription
+            );
+        }
+    }
+
+    slotPtr->isInFlight = false;
+    slotPtr->length = 0;
+}
@@ -38,6 +38,47 @@ void *safeMalloc(size_t const size, char const * const callerDescription) {
     return memory;
 }
 
+/**
+ * Allocate memory of the given size and alignment using aligned_alloc. The size is rounded up to a multiple of the
+ * alignment. If the allocation fails, abort the program with an error message.
+ *
+ * @param alignment The alignment, in bytes. Must be a power of two.
+ * @param size The size of the memory, in bytes.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The allocated memory, which may be freed using free.
+ */
+void *safeAlignedMalloc(size_t const alignment, size_t const size, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "safeAlignedMalloc");
+    guardFmt(
+        alignment > 0 && (alignment & (alignment - 1)) == 0,
+        "%s: safeAlignedMalloc alignment %zu is not a power of two",
+        callerDescription,
+        alignment
+    );
+
+    size_t const alignedSize = (size + alignment - 1) / alignment * alignment;
+    void * const memory = aligned_alloc(alignment, alignedSize);
+    if (memory == NULL) {
+        int const alignedAllocErrorCode = errno;
+        char const * const alignedAllocErrorMessage = strerror(alignedAllocErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to allocate %zu bytes of memory aligned to %zu bytes using aligned_alloc"
+            " (error code: %d; error message: \"%s\")",
+            callerDescription,
+            alignedSize,
+            alignment,
+            alignedAllocErrorCode,
+            alignedAllocErrorMessage
+        );
+        return NULL;
+    }
+
+    return memory;
+}
+
 /**
  * Resize the given memory using realloc. If the reallocation fails, abort the program with an error message.
  *
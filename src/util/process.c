@@ -0,0 +1,109 @@
+#define _GNU_SOURCE
+
+#include "../../include/util/process.h"
+
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <spawn.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+/**
+ * Start a program as a filter, with its standard input and output connected to the given file descriptors, using
+ * posix_spawnp. The program is looked up on the PATH. Close-on-exec file descriptors are not passed to it. If the
+ * operation fails, abort the program with an error message.
+ *
+ * @param arguments The NULL-terminated argument vector. The first argument is the program name.
+ * @param inFileDescriptor The file descriptor to become the program's standard input.
+ * @param outFileDescriptor The file descriptor to become the program's standard output.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The process ID of the program, to be waited for with safeWaitForSuccess.
+ */
+pid_t safeSpawnFilter(
+    char * const * const arguments,
+    int const inFileDescriptor,
+    int const outFileDescriptor,
+    char const * const callerDescription
+) {
+    guardNotNull(arguments, "arguments", "safeSpawnFilter");
+    guardNotNull(arguments[0], "arguments[0]", "safeSpawnFilter");
+    guardNotNull(callerDescription, "callerDescription", "safeSpawnFilter");
+
+    posix_spawn_file_actions_t fileActions;
+    int errorCode = posix_spawn_file_actions_init(&fileActions);
+    if (errorCode == 0) {
+        errorCode = posix_spawn_file_actions_adddup2(&fileActions, inFileDescriptor, STDIN_FILENO);
+    }
+    if (errorCode == 0) {
+        errorCode = posix_spawn_file_actions_adddup2(&fileActions, outFileDescriptor, STDOUT_FILENO);
+    }
+
+    pid_t processId = -1;
+    if (errorCode == 0) {
+        errorCode = posix_spawnp(&processId, arguments[0], &fileActions, NULL, arguments, environ);
+    }
+    posix_spawn_file_actions_destroy(&fileActions);
+
+    if (errorCode != 0) {
+        char const * const errorMessage = strerror(errorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to start \"%s\" using posix_spawnp (error code: %d; error message: \"%s\")",
+            callerDescription,
+            arguments[0],
+            errorCode,
+            errorMessage
+        );
+        return -1;
+    }
+
+    return processId;
+}
+
+/**
+ * Wait for the given child process to terminate using waitpid. If it did not exit successfully, or the operation
+ * fails, abort the program with an error message.
+ *
+ * @param processId The process ID.
+ * @param programName The name of the program, for the error message.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeWaitForSuccess(pid_t const processId, char const * const programName, char const * const callerDescription) {
+    guardNotNull(programName, "programName", "safeWaitForSuccess");
+    guardNotNull(callerDescription, "callerDescription", "safeWaitForSuccess");
+
+    int status;
+    while (waitpid(processId, &status, 0) == -1) {
+        if (errno == EINTR) {
+            continue;
+        }
+
+        int const waitpidErrorCode = errno;
+        char const * const waitpidErrorMessage = strerror(waitpidErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to wait for process %d using waitpid (error code: %d; error message: \"%s\")",
+            callerDescription,
+            (int)processId,
+            waitpidErrorCode,
+            waitpidErrorMessage
+        );
+        return;
+    }
+
+    if (WIFSIGNALED(status)) {
+        abortWithErrorFmt("%s: \"%s\" was killed by signal %d", callerDescription, programName, WTERMSIG(status));
+    } else if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        abortWithErrorFmt("%s: \"%s\" failed with exit status %d", callerDescription, programName, WEXITSTATUS(status));
+    }
+}
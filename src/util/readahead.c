@@ -0,0 +1,159 @@
+#include "../../include/util/readahead.h"
+
+#include "../../include/util/file.h"
+#include "../../include/util/thread.h"
+#include "../../include/util/memory.h"
+#include "../../include/util/guard.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <assert.h>
+
+static void *readAheadThreadStart(void *argAsVoidPtr);
+
+/**
+ * Initialize the given read-ahead reader and start its reading thread.
+ *
+ * @param readerOutPtr A pointer to the memory where the reader should be initialized. It must not move until the
+ *                     reader is destroyed.
+ * @param fileDescriptor The file descriptor, open for reading. The reader does not close it.
+ * @param capacity The size of each of the two buffers, in bytes.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void readAheadReaderInit(
+    struct ReadAheadReader * const readerOutPtr,
+    int const fileDescriptor,
+    size_t const capacity,
+    char const * const callerDescription
+) {
+    guardNotNull(readerOutPtr, "readerOutPtr", "readAheadReaderInit");
+    guardNotNull(callerDescription, "callerDescription", "readAheadReaderInit");
+    guardFmt(capacity > 0, "%s: readAheadReaderInit capacity must be positive", callerDescription);
+
+    readerOutPtr->fileDescriptor = fileDescriptor;
+    readerOutPtr->buffers[0] = safeMalloc(capacity, callerDescription);
+    readerOutPtr->buffers[1] = safeMalloc(capacity, callerDescription);
+    readerOutPtr->lengths[0] = 0;
+    readerOutPtr->lengths[1] = 0;
+    readerOutPtr->capacity = capacity;
+    readerOutPtr->fillIndex = 0;
+    readerOutPtr->consumeIndex = 0;
+    readerOutPtr->consumedLength = 0;
+    readerOutPtr->filledCount = 0;
+    readerOutPtr->isEndOfFile = false;
+
+    safeMutexInit(&readerOutPtr->mutex, NULL, callerDescription);
+    safeConditionInit(&readerOutPtr->filledCondition, NULL, callerDescription);
+    safeConditionInit(&readerOutPtr->emptiedCondition, NULL, callerDescription);
+    readerOutPtr->threadId = safePthreadCreate(NULL, readAheadThreadStart, readerOutPtr, callerDescription);
+}
+
+/**
+ * Copy up to `length` bytes of the file, in order, into the given buffer, waiting for the reading thread if neither
+ * buffer is filled yet. This has the same contract as safeRead.
+ *
+ * @param readerPtr A pointer to the reader.
+ * @param buffer The buffer into which to copy.
+ * @param length The maximum number of bytes to copy.
+ *
+ * @returns The number of bytes copied. 0 means the end of the file was reached.
+ */
+size_t readAheadReaderRead(struct ReadAheadReader * const readerPtr, void * const buffer, size_t const length) {
+    guardNotNull(readerPtr, "readerPtr", "readAheadReaderRead");
+    guardNotNull(buffer, "buffer", "readAheadReaderRead");
+
+    if (readerPtr->isEndOfFile || length == 0) {
+        return 0;
+    }
+
+    safeMutexLock(&readerPtr->mutex, "readAheadReaderRead");
+    while (readerPtr->filledCount == 0) {
+        safeConditionWait(&readerPtr->filledCondition, &readerPtr->mutex, "readAheadReaderRead");
+    }
+    safeMutexUnlock(&readerPtr->mutex, "readAheadReaderRead");
+
+    size_t const filledLength = readerPtr->lengths[readerPtr->consumeIndex];
+    if (filledLength == 0) {
+        // The reading thread has stopped after reading the end of the file into this buffer
+        readerPtr->isEndOfFile = true;
+        return 0;
+    }
+
+    size_t const remainingLength = filledLength - readerPtr->consumedLength;
+    size_t const copyLength = remainingLength < length ? remainingLength : length;
+    memcpy(buffer, readerPtr->buffers[readerPtr->consumeIndex] + readerPtr->consumedLength, copyLength);
+    readerPtr->consumedLength += copyLength;
+
+    if (readerPtr->consumedLength == filledLength) {
+        readerPtr->consumeIndex ^= 1;
+        readerPtr->consumedLength = 0;
+
+        safeMutexLock(&readerPtr->mutex, "readAheadReaderRead");
+        readerPtr->filledCount -= 1;
+        safeConditionSignal(&readerPtr->emptiedCondition, "readAheadReaderRead");
+        safeMutexUnlock(&readerPtr->mutex, "readAheadReaderRead");
+    }
+    return copyLength;
+}
+
+/**
+ * Wait for the reading thread to finish and destroy the given reader. The file must have been read to its end. The
+ * file descriptor is not closed.
+ *
+ * @param readerPtr A pointer to the reader.
+ */
+void readAheadReaderDestroy(struct ReadAheadReader * const readerPtr) {
+    guardNotNull(readerPtr, "readerPtr", "readAheadReaderDestroy");
+
+    safePthreadJoin(readerPtr->threadId, "readAheadReaderDestroy");
+
+    safeConditionDestroy(&readerPtr->emptiedCondition, "readAheadReaderDestroy");
+    safeConditionDestroy(&readerPtr->filledCondition, "readAheadReaderDestroy");
+    safeMutexDestroy(&readerPtr->mutex, "readAheadReaderDestroy");
+    free(readerPtr->buffers[0]);
+    free(readerPtr->buffers[1]);
+}
+
+static void *readAheadThreadStart(void * const argAsVoidPtr) {
+    assert(argAsVoidPtr != NULL);
+    struct ReadAheadReader * const readerPtr = argAsVoidPtr;
+
+    // Buffers are filled until one comes back empty, which marks the end of the file for the consumer
+    size_t length;
+    do {
+        safeMutexLock(&readerPtr->mutex, "readAheadThreadStart");
+        while (readerPtr->filledCount == 2) {
+            safeConditionWait(&readerPtr->emptiedCondition, &readerPtr->mutex, "readAheadThreadStart");
+        }
+        safeMutexUnlock(&readerPtr->mutex, "readAheadThreadStart");
+
+        // Pipes return what they hold, so keep reading until the buffer is over half full to amortize the handoff
+        char * const buffer = readerPtr->buffers[readerPtr->fillIndex];
+        length = 0;
+        while (length <= readerPtr->capacity / 2) {
+            size_t const readLength = safeRead(
+                readerPtr->fileDescriptor,
+                buffer + length,
+                readerPtr->capacity - length,
+                "readAheadThreadStart"
+            );
+            if (readLength == 0) {
+                break;
+            }
+            length += readLength;
+        }
+        readerPtr->lengths[readerPtr->fillIndex] = length;
+        readerPtr->fillIndex ^= 1;
+
+        safeMutexLock(&readerPtr->mutex, "readAheadThreadStart");
+        readerPtr->filledCount += 1;
+        safeConditionSignal(&readerPtr->filledCondition, "readAheadThreadStart");
+        safeMutexUnlock(&readerPtr->mutex, "readAheadThreadStart");
+    } while (length > 0);
+
+    return NULL;
+}
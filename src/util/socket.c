@@ -0,0 +1,210 @@
+#define _GNU_SOURCE
+
+#include "../../include/util/socket.h"
+
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static struct sockaddr_un unixSocketAddress(char const *socketPath, char const *callerDescription);
+
+/**
+ * Create a Unix domain stream socket listening at the given path. A socket file left at the path by an earlier server
+ * is removed first. If the operation fails, abort the program with an error message.
+ *
+ * @param socketPath The socket path. It must fit in sockaddr_un.sun_path.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The listening socket's file descriptor.
+ */
+int safeListenUnix(char const * const socketPath, char const * const callerDescription) {
+    guardNotNull(socketPath, "socketPath", "safeListenUnix");
+    guardNotNull(callerDescription, "callerDescription", "safeListenUnix");
+
+    struct sockaddr_un const address = unixSocketAddress(socketPath, callerDescription);
+
+    int const socketFileDescriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socketFileDescriptor == -1) {
+        int const socketErrorCode = errno;
+        char const * const socketErrorMessage = strerror(socketErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to create Unix socket using socket (error code: %d; error message: \"%s\")",
+            callerDescription,
+            socketErrorCode,
+            socketErrorMessage
+        );
+        return -1;
+    }
+
+    unlink(socketPath);
+    if (
+        bind(socketFileDescriptor, (struct sockaddr const *)&address, sizeof address) == -1
+        || listen(socketFileDescriptor, SOMAXCONN) == -1
+    ) {
+        int const listenErrorCode = errno;
+        char const * const listenErrorMessage = strerror(listenErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to listen at \"%s\" using bind/listen (error code: %d; error message: \"%s\")",
+            callerDescription,
+            socketPath,
+            listenErrorCode,
+            listenErrorMessage
+        );
+        return -1;
+    }
+
+    return socketFileDescriptor;
+}
+
+/**
+ * Accept a connection on the given listening socket, retrying if interrupted by a signal or if the connection was
+ * aborted before it was accepted. If the operation fails, abort the program with an error message.
+ *
+ * @param listenFileDescriptor The listening socket's file descriptor.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The connected socket's file descriptor.
+ */
+int safeAcceptUnix(int const listenFileDescriptor, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "safeAcceptUnix");
+
+    while (true) {
+        int const connectionFileDescriptor = accept4(listenFileDescriptor, NULL, NULL, SOCK_CLOEXEC);
+        if (connectionFileDescriptor != -1) {
+            return connectionFileDescriptor;
+        }
+        if (errno == EINTR || errno == ECONNABORTED) {
+            continue;
+        }
+
+        int const acceptErrorCode = errno;
+        char const * const acceptErrorMessage = strerror(acceptErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to accept connection using accept4 (error code: %d; error message: \"%s\")",
+            callerDescription,
+            acceptErrorCode,
+            acceptErrorMessage
+        );
+        return -1;
+    }
+}
+
+/**
+ * Connect to the Unix domain stream socket at the given path. If the operation fails, abort the program with an error
+ * message.
+ *
+ * @param socketPath The socket path. It must fit in sockaddr_un.sun_path.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The connected socket's file descriptor.
+ */
+int safeConnectUnix(char const * const socketPath, char const * const callerDescription) {
+    guardNotNull(socketPath, "socketPath", "safeConnectUnix");
+    guardNotNull(callerDescription, "callerDescription", "safeConnectUnix");
+
+    struct sockaddr_un const address = unixSocketAddress(socketPath, callerDescription);
+
+    int const socketFileDescriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (
+        socketFileDescriptor == -1
+        || connect(socketFileDescriptor, (struct sockaddr const *)&address, sizeof address) == -1
+    ) {
+        int const connectErrorCode = errno;
+        char const * const connectErrorMessage = strerror(connectErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to connect to \"%s\" using socket/connect (error code: %d; error message: \"%s\")",
+            callerDescription,
+            socketPath,
+            connectErrorCode,
+            connectErrorMessage
+        );
+        return -1;
+    }
+
+    return socketFileDescriptor;
+}
+
+/**
+ * Shut down the sending side of the given socket, so the peer reads the end of the stream. If the operation fails,
+ * abort the program with an error message.
+ *
+ * @param socketFileDescriptor The socket's file descriptor.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeShutdownWrite(int const socketFileDescriptor, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "safeShutdownWrite");
+
+    if (shutdown(socketFileDescriptor, SHUT_WR) == -1) {
+        int const shutdownErrorCode = errno;
+        char const * const shutdownErrorMessage = strerror(shutdownErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to shut down socket %d using shutdown (error code: %d; error message: \"%s\")",
+            callerDescription,
+            socketFileDescriptor,
+            shutdownErrorCode,
+            shutdownErrorMessage
+        );
+    }
+}
+
+/**
+ * Send all of the given bytes on the given socket, retrying if interrupted by a signal. Unlike the other functions
+ * here, a failure (e.g., the peer having disconnected) is reported rather than aborting, and never raises SIGPIPE, so
+ * a server can outlive a client that went away.
+ *
+ * @param socketFileDescriptor The socket's file descriptor.
+ * @param buffer The bytes to send.
+ * @param length The number of bytes to send.
+ *
+ * @returns Whether all of the bytes were sent.
+ */
+bool trySendAll(int const socketFileDescriptor, void const * const buffer, size_t const length) {
+    guardNotNull(buffer, "buffer", "trySendAll");
+
+    char const *cursor = buffer;
+    size_t remainingLength = length;
+    while (remainingLength > 0) {
+        ssize_t const sendResult = send(socketFileDescriptor, cursor, remainingLength, MSG_NOSIGNAL);
+        if (sendResult >= 0) {
+            cursor += sendResult;
+            remainingLength -= (size_t)sendResult;
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+static struct sockaddr_un unixSocketAddress(char const * const socketPath, char const * const callerDescription) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof address);
+    address.sun_family = AF_UNIX;
+    guardFmt(
+        strlen(socketPath) < sizeof address.sun_path,
+        "%s: Socket path \"%s\" is too long",
+        callerDescription,
+        socketPath
+    );
+    strcpy(address.sun_path, socketPath);
+    return address;
+}
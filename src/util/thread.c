@@ -1,10 +1,118 @@
+#define _GNU_SOURCE
+
 #include "../include/util/thread.h"
 
+#include "../include/util/memory.h"
 #include "../include/util/guard.h"
 #include "../include/util/error.h"
+#include "../include/util/file.h"
+#include "../include/util/string.h"
 
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <string.h>
+#include <errno.h>
 #include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <assert.h>
+#include <time.h>
+#include <fcntl.h>
+
+#define SPSC_QUEUE_MIN_SPIN_LIMIT 16u
+#define SPSC_QUEUE_MAX_SPIN_LIMIT 4096u
+#define NANOSECONDS_PER_SECOND 1000000000LL
+
+static enum SpscQueuePopResult spscQueuePopUntil(
+    struct SpscQueue *queuePtr,
+    void *elementOutPtr,
+    long long deadlineNanoseconds
+);
+static enum SpscQueuePopResult spscQueueWaitNotEmpty(
+    struct SpscQueue *queuePtr,
+    size_t head,
+    long long deadlineNanoseconds
+);
+static void spscQueueWaitNotFull(struct SpscQueue *queuePtr, size_t tail);
+static void spscQueueWake(atomic_uint *parkedPtr, atomic_uint *sequencePtr, char const *callerDescription);
+static unsigned int adaptSpinLimit(unsigned int spinLimit, bool spinSucceeded);
+static void spinPause(void);
+static void futexWait(
+    atomic_uint *wordPtr,
+    unsigned int expectedValue,
+    struct timespec const *timeoutPtr,
+    char const *callerDescription
+);
+static void futexWakeAll(atomic_uint *wordPtr, char const *callerDescription);
+static void *threadPoolThreadStart(void *poolAsVoidPtr);
+static long long monotonicNanoseconds(void);
+
+#ifdef MUTEX_PROFILE
+#define MUTEX_PROFILE_CAPACITY 128u
+#define MUTEX_PROFILE_HELD_CAPACITY 16u
+#define MUTEX_PROFILE_LINE_CAPACITY 256u
+
+/**
+ * Contention statistics for the mutexes locked with one callerDescription. The key is the string's address, which is
+ * what the callers pass every time; equal strings at different addresses are merged in the report.
+ */
+struct MutexProfileEntry {
+    _Atomic(char const *) callerDescription;
+    atomic_ullong acquisitionCount;
+    atomic_ullong contendedCount;
+    atomic_ullong waitNanoseconds;
+    atomic_ullong maxWaitNanoseconds;
+    atomic_ullong holdNanoseconds;
+};
+
+/**
+ * A mutex held by the current thread, and the entry its hold time goes to.
+ */
+struct MutexProfileHeld {
+    pthread_mutex_t const *mutexPtr;
+    struct MutexProfileEntry *entryPtr;
+    long long lockedNanoseconds;
+};
+
+/**
+ * The statistics of one lock, as reported.
+ */
+struct MutexProfileReport {
+    char const *callerDescription;
+    unsigned long long acquisitionCount;
+    unsigned long long contendedCount;
+    unsigned long long waitNanoseconds;
+    unsigned long long maxWaitNanoseconds;
+    unsigned long long holdNanoseconds;
+};
+
+static struct MutexProfileEntry mutexProfileEntries[MUTEX_PROFILE_CAPACITY];
+static struct MutexProfileEntry mutexProfileOverflowEntry;
+static pthread_once_t mutexProfileReportOnce = PTHREAD_ONCE_INIT;
+static _Thread_local struct MutexProfileHeld mutexProfileHeld[MUTEX_PROFILE_HELD_CAPACITY];
+static _Thread_local size_t mutexProfileHeldCount;
+
+static int profiledMutexLock(pthread_mutex_t *mutexPtr, char const *callerDescription);
+static void profileMutexUnlock(pthread_mutex_t const *mutexPtr);
+static void pauseMutexProfileHold(pthread_mutex_t const *mutexPtr);
+static void resumeMutexProfileHold(pthread_mutex_t const *mutexPtr);
+static struct MutexProfileEntry *findMutexProfileEntry(char const *callerDescription);
+static struct MutexProfileHeld *findMutexProfileHeld(pthread_mutex_t const *mutexPtr);
+static void storeMaxRelaxed(atomic_ullong *maxPtr, unsigned long long value);
+static void registerMutexProfileReport(void);
+static void reportMutexProfile(void);
+static size_t collectMutexProfileReports(struct MutexProfileReport *reports);
+static void mergeMutexProfileEntry(
+    struct MutexProfileReport *reports,
+    size_t *reportCountPtr,
+    struct MutexProfileEntry *entryPtr,
+    char const *callerDescription
+);
+static int compareMutexProfileReports(void const *leftPtr, void const *rightPtr);
+#endif
 
 /**
  * Create a new thread. If the operation fails, abort the program with an error message.
@@ -113,7 +221,11 @@ void safeMutexLock(pthread_mutex_t * const mutexPtr, char const * const callerDe
     guardNotNull(mutexPtr, "mutexPtr", "safeMutexLock");
     guardNotNull(callerDescription, "callerDescription", "safeMutexLock");
 
+#ifdef MUTEX_PROFILE
+    int const mutexLockErrorCode = profiledMutexLock(mutexPtr, callerDescription);
+#else
     int const mutexLockErrorCode = pthread_mutex_lock(mutexPtr);
+#endif
     if (mutexLockErrorCode != 0) {
         char const * const mutexLockErrorMessage = strerror(mutexLockErrorCode);
 
@@ -137,6 +249,9 @@ void safeMutexUnlock(pthread_mutex_t * const mutexPtr, char const * const caller
     guardNotNull(mutexPtr, "mutexPtr", "safeMutexUnlock");
     guardNotNull(callerDescription, "callerDescription", "safeMutexUnlock");
 
+#ifdef MUTEX_PROFILE
+    profileMutexUnlock(mutexPtr);
+#endif
     int const mutexUnlockErrorCode = pthread_mutex_unlock(mutexPtr);
     if (mutexUnlockErrorCode != 0) {
         char const * const mutexUnlockErrorMessage = strerror(mutexUnlockErrorCode);
@@ -227,6 +342,30 @@ void safeConditionSignal(pthread_cond_t * const conditionPtr, char const * const
     }
 }
 
+/**
+ * Signal every thread waiting on the given condition. If the operation fails, abort the program with an error message.
+ *
+ * @param conditionPtr A pointer to the condition.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeConditionBroadcast(pthread_cond_t * const conditionPtr, char const * const callerDescription) {
+    guardNotNull(conditionPtr, "conditionPtr", "safeConditionBroadcast");
+    guardNotNull(callerDescription, "callerDescription", "safeConditionBroadcast");
+
+    int const condBroadcastErrorCode = pthread_cond_broadcast(conditionPtr);
+    if (condBroadcastErrorCode != 0) {
+        char const * const condBroadcastErrorMessage = strerror(condBroadcastErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to broadcast condition using pthread_cond_broadcast (error code: %d; error message: \"%s\")",
+            callerDescription,
+            condBroadcastErrorCode,
+            condBroadcastErrorMessage
+        );
+    }
+}
+
 /**
  * Wait for the given condition. If the operation fails, abort the program with an error message.
  *
@@ -244,7 +383,14 @@ void safeConditionWait(
     guardNotNull(mutexPtr, "mutexPtr", "safeConditionWait");
     guardNotNull(callerDescription, "callerDescription", "safeConditionWait");
 
+#ifdef MUTEX_PROFILE
+    // The mutex is not held while waiting, and is reacquired out of sight: neither counts as holding nor waiting for it
+    pauseMutexProfileHold(mutexPtr);
+#endif
     int const condWaitErrorCode = pthread_cond_wait(conditionPtr, mutexPtr);
+#ifdef MUTEX_PROFILE
+    resumeMutexProfileHold(mutexPtr);
+#endif
     if (condWaitErrorCode != 0) {
         char const * const condWaitErrorMessage = strerror(condWaitErrorCode);
 
@@ -280,3 +426,761 @@ void safeConditionDestroy(pthread_cond_t * const conditionPtr, char const * cons
         );
     }
 }
+
+/**
+ * Initialize the given single-producer/single-consumer queue. If the operation fails, abort the program with an error
+ * message.
+ *
+ * @param queueOutPtr A pointer to the memory where the queue should be initialized. This pointer must be used directly
+ *                    in all queue-related functions (no copies).
+ * @param minCapacity The minimum number of elements the queue can hold. The capacity is rounded up to a power of two.
+ * @param elementSize The size of each element, in bytes.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void spscQueueInit(
+    struct SpscQueue * const queueOutPtr,
+    size_t const minCapacity,
+    size_t const elementSize,
+    char const * const callerDescription
+) {
+    guardNotNull(queueOutPtr, "queueOutPtr", "spscQueueInit");
+    guardNotNull(callerDescription, "callerDescription", "spscQueueInit");
+    guardFmt(minCapacity > 0, "%s: spscQueueInit minCapacity must be positive", callerDescription);
+    guardFmt(minCapacity <= SIZE_MAX / 2 + 1, "%s: spscQueueInit minCapacity is too large", callerDescription);
+    guardFmt(elementSize > 0, "%s: spscQueueInit elementSize must be positive", callerDescription);
+
+    size_t capacity = 1;
+    while (capacity < minCapacity) {
+        capacity *= 2;
+    }
+    guardFmt(capacity <= SIZE_MAX / elementSize, "%s: spscQueueInit capacity is too large", callerDescription);
+
+    atomic_init(&queueOutPtr->head, 0);
+    queueOutPtr->consumerCachedTail = 0;
+    queueOutPtr->consumerSpinLimit = SPSC_QUEUE_MAX_SPIN_LIMIT;
+
+    atomic_init(&queueOutPtr->tail, 0);
+    queueOutPtr->producerCachedHead = 0;
+    queueOutPtr->producerSpinLimit = SPSC_QUEUE_MAX_SPIN_LIMIT;
+
+    atomic_init(&queueOutPtr->consumerParked, 0);
+    atomic_init(&queueOutPtr->producerParked, 0);
+    atomic_init(&queueOutPtr->notEmptySequence, 0);
+    atomic_init(&queueOutPtr->notFullSequence, 0);
+    atomic_init(&queueOutPtr->closed, false);
+
+    queueOutPtr->elements = safeMalloc(capacity * elementSize, callerDescription);
+    queueOutPtr->elementSize = elementSize;
+    queueOutPtr->capacity = capacity;
+}
+
+/**
+ * Append a copy of the given element to the queue, waiting for space if the queue is full. Must only be called from
+ * the single producer thread.
+ *
+ * @param queuePtr A pointer to the queue.
+ * @param elementPtr A pointer to the element, which is `elementSize` bytes long.
+ */
+void spscQueuePush(struct SpscQueue * const queuePtr, void const * const elementPtr) {
+    guardNotNull(queuePtr, "queuePtr", "spscQueuePush");
+    guardNotNull(elementPtr, "elementPtr", "spscQueuePush");
+
+    size_t const tail = atomic_load_explicit(&queuePtr->tail, memory_order_relaxed);
+    if (tail - queuePtr->producerCachedHead == queuePtr->capacity) {
+        queuePtr->producerCachedHead = atomic_load_explicit(&queuePtr->head, memory_order_acquire);
+        if (tail - queuePtr->producerCachedHead == queuePtr->capacity) {
+            spscQueueWaitNotFull(queuePtr, tail);
+        }
+    }
+
+    size_t const slot = tail & (queuePtr->capacity - 1);
+    memcpy(queuePtr->elements + slot * queuePtr->elementSize, elementPtr, queuePtr->elementSize);
+    atomic_store_explicit(&queuePtr->tail, tail + 1, memory_order_release);
+
+    spscQueueWake(&queuePtr->consumerParked, &queuePtr->notEmptySequence, "spscQueuePush");
+}
+
+/**
+ * Mark the queue as closed. Once the consumer has popped every element pushed before the close, spscQueuePop returns
+ * false. Must only be called from the single producer thread, after its last push.
+ *
+ * @param queuePtr A pointer to the queue.
+ */
+void spscQueueClose(struct SpscQueue * const queuePtr) {
+    guardNotNull(queuePtr, "queuePtr", "spscQueueClose");
+
+    atomic_store_explicit(&queuePtr->closed, true, memory_order_release);
+    spscQueueWake(&queuePtr->consumerParked, &queuePtr->notEmptySequence, "spscQueueClose");
+}
+
+/**
+ * Remove the element at the head of the queue, waiting for one to be pushed if the queue is empty. Must only be called
+ * from the single consumer thread.
+ *
+ * @param queuePtr A pointer to the queue.
+ * @param elementOutPtr A pointer to the memory into which the `elementSize`-byte element should be copied.
+ *
+ * @returns Whether an element was removed. False means the queue is empty and has been closed.
+ */
+bool spscQueuePop(struct SpscQueue * const queuePtr, void * const elementOutPtr) {
+    guardNotNull(queuePtr, "queuePtr", "spscQueuePop");
+    guardNotNull(elementOutPtr, "elementOutPtr", "spscQueuePop");
+
+    return spscQueuePopUntil(queuePtr, elementOutPtr, -1) == SPSC_QUEUE_POPPED;
+}
+
+/**
+ * Remove the element at the head of the queue, waiting at most `timeoutNanoseconds` for one to be pushed if the queue
+ * is empty. Must only be called from the single consumer thread.
+ *
+ * @param queuePtr A pointer to the queue.
+ * @param elementOutPtr A pointer to the memory into which the `elementSize`-byte element should be copied.
+ * @param timeoutNanoseconds The longest time to wait, or a negative number to wait as long as it takes.
+ *
+ * @returns Whether an element was removed, the wait timed out, or the queue is empty and has been closed.
+ */
+enum SpscQueuePopResult spscQueuePopWithin(
+    struct SpscQueue * const queuePtr,
+    void * const elementOutPtr,
+    long long const timeoutNanoseconds
+) {
+    guardNotNull(queuePtr, "queuePtr", "spscQueuePopWithin");
+    guardNotNull(elementOutPtr, "elementOutPtr", "spscQueuePopWithin");
+
+    long long const deadlineNanoseconds = timeoutNanoseconds < 0 ? -1 : monotonicNanoseconds() + timeoutNanoseconds;
+    return spscQueuePopUntil(queuePtr, elementOutPtr, deadlineNanoseconds);
+}
+
+/**
+ * Destroy the given queue. Both the producer and the consumer must be done with it.
+ *
+ * @param queuePtr A pointer to the queue.
+ */
+void spscQueueDestroy(struct SpscQueue * const queuePtr) {
+    guardNotNull(queuePtr, "queuePtr", "spscQueueDestroy");
+
+    free(queuePtr->elements);
+    queuePtr->elements = NULL;
+}
+
+/**
+ * Remove the element at the head of the queue, waiting until the given monotonic time (or as long as it takes, if it is
+ * negative) for one to be pushed if the queue is empty.
+ */
+static enum SpscQueuePopResult spscQueuePopUntil(
+    struct SpscQueue * const queuePtr,
+    void * const elementOutPtr,
+    long long const deadlineNanoseconds
+) {
+    size_t const head = atomic_load_explicit(&queuePtr->head, memory_order_relaxed);
+    if (head == queuePtr->consumerCachedTail) {
+        queuePtr->consumerCachedTail = atomic_load_explicit(&queuePtr->tail, memory_order_acquire);
+        if (head == queuePtr->consumerCachedTail) {
+            enum SpscQueuePopResult const waitResult = spscQueueWaitNotEmpty(queuePtr, head, deadlineNanoseconds);
+            if (waitResult != SPSC_QUEUE_POPPED) {
+                return waitResult;
+            }
+        }
+    }
+
+    size_t const slot = head & (queuePtr->capacity - 1);
+    memcpy(elementOutPtr, queuePtr->elements + slot * queuePtr->elementSize, queuePtr->elementSize);
+    atomic_store_explicit(&queuePtr->head, head + 1, memory_order_release);
+
+    spscQueueWake(&queuePtr->producerParked, &queuePtr->notFullSequence, "spscQueuePopUntil");
+
+    return SPSC_QUEUE_POPPED;
+}
+
+/**
+ * Wait until the queue is non-empty or closed, or until the given monotonic time if it is not negative.
+ *
+ * @returns SPSC_QUEUE_POPPED if an element is available to pop, SPSC_QUEUE_CLOSED if the queue is empty and has been
+ *          closed, or SPSC_QUEUE_TIMED_OUT if the deadline passed first.
+ */
+static enum SpscQueuePopResult spscQueueWaitNotEmpty(
+    struct SpscQueue * const queuePtr,
+    size_t const head,
+    long long const deadlineNanoseconds
+) {
+    unsigned int spinCount = 0;
+    while (spinCount < queuePtr->consumerSpinLimit) {
+        spinPause();
+        spinCount += 1;
+
+        // Load closed before tail, so a close observed here implies every push before it is visible too
+        bool const closed = atomic_load_explicit(&queuePtr->closed, memory_order_acquire);
+        queuePtr->consumerCachedTail = atomic_load_explicit(&queuePtr->tail, memory_order_acquire);
+        if (queuePtr->consumerCachedTail != head || closed) {
+            queuePtr->consumerSpinLimit = adaptSpinLimit(queuePtr->consumerSpinLimit, true);
+            return queuePtr->consumerCachedTail != head ? SPSC_QUEUE_POPPED : SPSC_QUEUE_CLOSED;
+        }
+    }
+    queuePtr->consumerSpinLimit = adaptSpinLimit(queuePtr->consumerSpinLimit, false);
+
+    while (true) {
+        unsigned int const sequence = atomic_load_explicit(&queuePtr->notEmptySequence, memory_order_acquire);
+        atomic_store_explicit(&queuePtr->consumerParked, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        bool const closed = atomic_load_explicit(&queuePtr->closed, memory_order_acquire);
+        queuePtr->consumerCachedTail = atomic_load_explicit(&queuePtr->tail, memory_order_acquire);
+        if (queuePtr->consumerCachedTail != head || closed) {
+            atomic_store_explicit(&queuePtr->consumerParked, 0, memory_order_relaxed);
+            return queuePtr->consumerCachedTail != head ? SPSC_QUEUE_POPPED : SPSC_QUEUE_CLOSED;
+        }
+
+        struct timespec timeout;
+        struct timespec const *timeoutPtr = NULL;
+        if (deadlineNanoseconds >= 0) {
+            long long const remainingNanoseconds = deadlineNanoseconds - monotonicNanoseconds();
+            if (remainingNanoseconds <= 0) {
+                atomic_store_explicit(&queuePtr->consumerParked, 0, memory_order_relaxed);
+                return SPSC_QUEUE_TIMED_OUT;
+            }
+            timeout.tv_sec = (time_t)(remainingNanoseconds / NANOSECONDS_PER_SECOND);
+            timeout.tv_nsec = (long)(remainingNanoseconds % NANOSECONDS_PER_SECOND);
+            timeoutPtr = &timeout;
+        }
+        futexWait(&queuePtr->notEmptySequence, sequence, timeoutPtr, "spscQueueWaitNotEmpty");
+    }
+}
+
+/**
+ * Wait until the queue is not full.
+ */
+static void spscQueueWaitNotFull(struct SpscQueue * const queuePtr, size_t const tail) {
+    unsigned int spinCount = 0;
+    while (spinCount < queuePtr->producerSpinLimit) {
+        spinPause();
+        spinCount += 1;
+
+        queuePtr->producerCachedHead = atomic_load_explicit(&queuePtr->head, memory_order_acquire);
+        if (tail - queuePtr->producerCachedHead != queuePtr->capacity) {
+            queuePtr->producerSpinLimit = adaptSpinLimit(queuePtr->producerSpinLimit, true);
+            return;
+        }
+    }
+    queuePtr->producerSpinLimit = adaptSpinLimit(queuePtr->producerSpinLimit, false);
+
+    while (true) {
+        unsigned int const sequence = atomic_load_explicit(&queuePtr->notFullSequence, memory_order_acquire);
+        atomic_store_explicit(&queuePtr->producerParked, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        queuePtr->producerCachedHead = atomic_load_explicit(&queuePtr->head, memory_order_acquire);
+        if (tail - queuePtr->producerCachedHead != queuePtr->capacity) {
+            atomic_store_explicit(&queuePtr->producerParked, 0, memory_order_relaxed);
+            return;
+        }
+
+        futexWait(&queuePtr->notFullSequence, sequence, NULL, "spscQueueWaitNotFull");
+    }
+}
+
+/**
+ * Wake the other side of the queue if it is parked. Called after publishing a change to head, tail, or closed; the
+ * fence pairs with the one in the wait functions so that either the waiter sees the change or we see it parked.
+ */
+static void spscQueueWake(
+    atomic_uint * const parkedPtr,
+    atomic_uint * const sequencePtr,
+    char const * const callerDescription
+) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(parkedPtr, memory_order_relaxed) == 0) {
+        return;
+    }
+
+    atomic_fetch_add_explicit(sequencePtr, 1, memory_order_release);
+    futexWakeAll(sequencePtr, callerDescription);
+}
+
+/**
+ * Grow the spin limit after spinning paid off and shrink it after it did not, so a waiter that keeps ending up parked
+ * (e.g., on a single CPU) stops burning cycles first.
+ */
+static unsigned int adaptSpinLimit(unsigned int const spinLimit, bool const spinSucceeded) {
+    if (spinSucceeded) {
+        return spinLimit >= SPSC_QUEUE_MAX_SPIN_LIMIT / 2 ? SPSC_QUEUE_MAX_SPIN_LIMIT : spinLimit * 2;
+    }
+    return spinLimit <= SPSC_QUEUE_MIN_SPIN_LIMIT * 2 ? SPSC_QUEUE_MIN_SPIN_LIMIT : spinLimit / 2;
+}
+
+static void spinPause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/**
+ * Sleep until the given futex word is woken, unless it no longer holds the expected value. If the operation fails,
+ * abort the program with an error message.
+ */
+static void futexWait(
+    atomic_uint * const wordPtr,
+    unsigned int const expectedValue,
+    struct timespec const * const timeoutPtr,
+    char const * const callerDescription
+) {
+    long const futexResult = syscall(SYS_futex, wordPtr, FUTEX_WAIT_PRIVATE, expectedValue, timeoutPtr, NULL, 0);
+    if (futexResult == -1 && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT) {
+        int const futexErrorCode = errno;
+        char const * const futexErrorMessage = strerror(futexErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to wait on futex using FUTEX_WAIT_PRIVATE (error code: %d; error message: \"%s\")",
+            callerDescription,
+            futexErrorCode,
+            futexErrorMessage
+        );
+    }
+}
+
+/**
+ * Wake every thread sleeping on the given futex word. If the operation fails, abort the program with an error message.
+ */
+static void futexWakeAll(atomic_uint * const wordPtr, char const * const callerDescription) {
+    long const futexResult = syscall(SYS_futex, wordPtr, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+    if (futexResult == -1) {
+        int const futexErrorCode = errno;
+        char const * const futexErrorMessage = strerror(futexErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to wake futex using FUTEX_WAKE_PRIVATE (error code: %d; error message: \"%s\")",
+            callerDescription,
+            futexErrorCode,
+            futexErrorMessage
+        );
+    }
+}
+
+/**
+ * Get the number of processors currently online.
+ *
+ * @returns The number of online processors, or 1 if it cannot be determined.
+ */
+size_t onlineCpuCount(void) {
+    long const cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpuCount > 0 ? (size_t)cpuCount : 1;
+}
+
+/**
+ * Initialize the given thread pool and start its worker threads. If the operation fails, abort the program with an
+ * error message.
+ *
+ * @param poolOutPtr A pointer to the memory where the pool should be initialized. This pointer must be used directly in
+ *                   all pool-related functions (no copies).
+ * @param threadCount The number of worker threads, or 0 to use one per online processor.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void threadPoolInit(
+    struct ThreadPool * const poolOutPtr,
+    size_t const threadCount,
+    char const * const callerDescription
+) {
+    guardNotNull(poolOutPtr, "poolOutPtr", "threadPoolInit");
+    guardNotNull(callerDescription, "callerDescription", "threadPoolInit");
+
+    poolOutPtr->threadCount = threadCount == 0 ? onlineCpuCount() : threadCount;
+    poolOutPtr->threadIds = safeMalloc(sizeof *poolOutPtr->threadIds * poolOutPtr->threadCount, callerDescription);
+
+    poolOutPtr->taskCapacity = poolOutPtr->threadCount * 4;
+    poolOutPtr->tasks = safeMalloc(sizeof *poolOutPtr->tasks * poolOutPtr->taskCapacity, callerDescription);
+    poolOutPtr->taskHead = 0;
+    poolOutPtr->taskCount = 0;
+    poolOutPtr->isShuttingDown = false;
+
+    safeMutexInit(&poolOutPtr->mutex, NULL, callerDescription);
+    safeConditionInit(&poolOutPtr->taskAvailableCondition, NULL, callerDescription);
+
+    for (size_t threadIndex = 0; threadIndex < poolOutPtr->threadCount; threadIndex += 1) {
+        poolOutPtr->threadIds[threadIndex] = safePthreadCreate(
+            NULL,
+            threadPoolThreadStart,
+            poolOutPtr,
+            callerDescription
+        );
+    }
+}
+
+/**
+ * Queue the given task to be run by one of the pool's worker threads.
+ *
+ * @param poolPtr A pointer to the pool.
+ * @param routine The function to run.
+ * @param arg The argument to pass to routine.
+ */
+void threadPoolSubmit(struct ThreadPool * const poolPtr, ThreadPoolTaskRoutine const routine, void * const arg) {
+    guardNotNull(poolPtr, "poolPtr", "threadPoolSubmit");
+    guard(routine != NULL, "threadPoolSubmit: routine must not be NULL");
+
+    safeMutexLock(&poolPtr->mutex, "threadPoolSubmit");
+    guard(!poolPtr->isShuttingDown, "threadPoolSubmit: The pool is shutting down");
+
+    if (poolPtr->taskCount == poolPtr->taskCapacity) {
+        // Grow the ring, unwrapping it so the head is at index 0
+        size_t const newTaskCapacity = poolPtr->taskCapacity * 2;
+        struct ThreadPoolTask * const newTasks = safeMalloc(
+            sizeof *newTasks * newTaskCapacity,
+            "threadPoolSubmit"
+        );
+        for (size_t taskIndex = 0; taskIndex < poolPtr->taskCount; taskIndex += 1) {
+            newTasks[taskIndex] = poolPtr->tasks[(poolPtr->taskHead + taskIndex) % poolPtr->taskCapacity];
+        }
+        free(poolPtr->tasks);
+        poolPtr->tasks = newTasks;
+        poolPtr->taskCapacity = newTaskCapacity;
+        poolPtr->taskHead = 0;
+    }
+
+    size_t const taskTail = (poolPtr->taskHead + poolPtr->taskCount) % poolPtr->taskCapacity;
+    poolPtr->tasks[taskTail] = (struct ThreadPoolTask){ .routine = routine, .arg = arg };
+    poolPtr->taskCount += 1;
+
+    safeConditionSignal(&poolPtr->taskAvailableCondition, "threadPoolSubmit");
+    safeMutexUnlock(&poolPtr->mutex, "threadPoolSubmit");
+}
+
+/**
+ * Run every queued task, stop the pool's worker threads, and destroy the pool.
+ *
+ * @param poolPtr A pointer to the pool.
+ */
+void threadPoolDestroy(struct ThreadPool * const poolPtr) {
+    guardNotNull(poolPtr, "poolPtr", "threadPoolDestroy");
+
+    safeMutexLock(&poolPtr->mutex, "threadPoolDestroy");
+    poolPtr->isShuttingDown = true;
+    safeConditionBroadcast(&poolPtr->taskAvailableCondition, "threadPoolDestroy");
+    safeMutexUnlock(&poolPtr->mutex, "threadPoolDestroy");
+
+    for (size_t threadIndex = 0; threadIndex < poolPtr->threadCount; threadIndex += 1) {
+        safePthreadJoin(poolPtr->threadIds[threadIndex], "threadPoolDestroy");
+    }
+
+    safeMutexDestroy(&poolPtr->mutex, "threadPoolDestroy");
+    safeConditionDestroy(&poolPtr->taskAvailableCondition, "threadPoolDestroy");
+
+    free(poolPtr->tasks);
+    free(poolPtr->threadIds);
+}
+
+static void *threadPoolThreadStart(void * const poolAsVoidPtr) {
+    assert(poolAsVoidPtr != NULL);
+    struct ThreadPool * const poolPtr = poolAsVoidPtr;
+
+    safeMutexLock(&poolPtr->mutex, "threadPoolThreadStart");
+    while (true) {
+        while (poolPtr->taskCount == 0 && !poolPtr->isShuttingDown) {
+            safeConditionWait(&poolPtr->taskAvailableCondition, &poolPtr->mutex, "threadPoolThreadStart");
+        }
+        if (poolPtr->taskCount == 0) {
+            // Shutting down and every queued task has been taken
+            break;
+        }
+
+        struct ThreadPoolTask const task = poolPtr->tasks[poolPtr->taskHead];
+        poolPtr->taskHead = (poolPtr->taskHead + 1) % poolPtr->taskCapacity;
+        poolPtr->taskCount -= 1;
+
+        safeMutexUnlock(&poolPtr->mutex, "threadPoolThreadStart");
+        task.routine(task.arg);
+        safeMutexLock(&poolPtr->mutex, "threadPoolThreadStart");
+    }
+    safeMutexUnlock(&poolPtr->mutex, "threadPoolThreadStart");
+
+    return NULL;
+}
+
+static long long monotonicNanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec;
+}
+
+#ifdef MUTEX_PROFILE
+/**
+ * Lock the given mutex, recording the acquisition. If it cannot be taken at once, the acquisition is contended, and
+ * the time spent blocking on it is recorded as wait time.
+ *
+ * @returns The error code of the lock operation.
+ */
+static int profiledMutexLock(pthread_mutex_t * const mutexPtr, char const * const callerDescription) {
+    struct MutexProfileEntry * const entryPtr = findMutexProfileEntry(callerDescription);
+
+    bool isContended = false;
+    unsigned long long waitNanoseconds = 0;
+    int errorCode = pthread_mutex_trylock(mutexPtr);
+    if (errorCode == EBUSY) {
+        isContended = true;
+        long long const waitStartNanoseconds = monotonicNanoseconds();
+        errorCode = pthread_mutex_lock(mutexPtr);
+        waitNanoseconds = (unsigned long long)(monotonicNanoseconds() - waitStartNanoseconds);
+    }
+    if (errorCode != 0) {
+        return errorCode;
+    }
+
+    atomic_fetch_add_explicit(&entryPtr->acquisitionCount, 1, memory_order_relaxed);
+    if (isContended) {
+        atomic_fetch_add_explicit(&entryPtr->contendedCount, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&entryPtr->waitNanoseconds, waitNanoseconds, memory_order_relaxed);
+        storeMaxRelaxed(&entryPtr->maxWaitNanoseconds, waitNanoseconds);
+    }
+
+    // Too deeply nested locks are still counted, but their hold time is not
+    if (mutexProfileHeldCount < MUTEX_PROFILE_HELD_CAPACITY) {
+        struct MutexProfileHeld * const heldPtr = &mutexProfileHeld[mutexProfileHeldCount];
+        heldPtr->mutexPtr = mutexPtr;
+        heldPtr->entryPtr = entryPtr;
+        heldPtr->lockedNanoseconds = monotonicNanoseconds();
+        mutexProfileHeldCount += 1;
+    }
+    return 0;
+}
+
+/**
+ * Record the hold time of a mutex the current thread is about to unlock. It goes to the entry the mutex was locked
+ * with, whatever the callerDescription of the unlock.
+ */
+static void profileMutexUnlock(pthread_mutex_t const * const mutexPtr) {
+    struct MutexProfileHeld * const heldPtr = findMutexProfileHeld(mutexPtr);
+    if (heldPtr == NULL) {
+        return;
+    }
+
+    unsigned long long const holdNanoseconds =
+        (unsigned long long)(monotonicNanoseconds() - heldPtr->lockedNanoseconds);
+    atomic_fetch_add_explicit(&heldPtr->entryPtr->holdNanoseconds, holdNanoseconds, memory_order_relaxed);
+
+    // Mutexes need not be unlocked in reverse order, so fill the gap with the last held one
+    mutexProfileHeldCount -= 1;
+    *heldPtr = mutexProfileHeld[mutexProfileHeldCount];
+}
+
+/**
+ * Record the hold time of a mutex so far, before a condition wait releases it.
+ */
+static void pauseMutexProfileHold(pthread_mutex_t const * const mutexPtr) {
+    struct MutexProfileHeld * const heldPtr = findMutexProfileHeld(mutexPtr);
+    if (heldPtr != NULL) {
+        unsigned long long const holdNanoseconds =
+        (unsigned long long)(monotonicNanoseconds() - heldPtr->lockedNanoseconds);
+        atomic_fetch_add_explicit(&heldPtr->entryPtr->holdNanoseconds, holdNanoseconds, memory_order_relaxed);
+    }
+}
+
+/**
+ * Start counting the hold time of a mutex again, once a condition wait has reacquired it.
+ */
+static void resumeMutexProfileHold(pthread_mutex_t const * const mutexPtr) {
+    struct MutexProfileHeld * const heldPtr = findMutexProfileHeld(mutexPtr);
+    if (heldPtr != NULL) {
+        heldPtr->lockedNanoseconds = monotonicNanoseconds();
+    }
+}
+
+/**
+ * Find the entry for the given callerDescription, adding it if it is new. Once the table is full, new descriptions
+ * share a single overflow entry.
+ */
+static struct MutexProfileEntry *findMutexProfileEntry(char const * const callerDescription) {
+    size_t const startIndex = (size_t)(((uintptr_t)callerDescription >> 3) % MUTEX_PROFILE_CAPACITY);
+    for (size_t probeCount = 0; probeCount < MUTEX_PROFILE_CAPACITY; probeCount += 1) {
+        struct MutexProfileEntry * const entryPtr =
+            &mutexProfileEntries[(startIndex + probeCount) % MUTEX_PROFILE_CAPACITY];
+
+        char const *entryDescription = atomic_load_explicit(&entryPtr->callerDescription, memory_order_acquire);
+        if (entryDescription == NULL) {
+            bool const isClaimed = atomic_compare_exchange_strong_explicit(
+                &entryPtr->callerDescription,
+                &entryDescription,
+                callerDescription,
+                memory_order_acq_rel,
+                memory_order_acquire
+            );
+            if (isClaimed) {
+                pthread_once(&mutexProfileReportOnce, registerMutexProfileReport);
+                return entryPtr;
+            }
+        }
+        if (entryDescription == callerDescription) {
+            return entryPtr;
+        }
+    }
+    return &mutexProfileOverflowEntry;
+}
+
+/**
+ * Find the given mutex among those the current thread holds.
+ *
+ * @returns The held mutex, or null if it is not tracked.
+ */
+static struct MutexProfileHeld *findMutexProfileHeld(pthread_mutex_t const * const mutexPtr) {
+    for (size_t heldIndex = mutexProfileHeldCount; heldIndex > 0; heldIndex -= 1) {
+        if (mutexProfileHeld[heldIndex - 1].mutexPtr == mutexPtr) {
+            return &mutexProfileHeld[heldIndex - 1];
+        }
+    }
+    return NULL;
+}
+
+static void storeMaxRelaxed(atomic_ullong * const maxPtr, unsigned long long const value) {
+    unsigned long long currentValue = atomic_load_explicit(maxPtr, memory_order_relaxed);
+    while (value > currentValue) {
+        bool const isStored = atomic_compare_exchange_weak_explicit(
+            maxPtr,
+            &currentValue,
+            value,
+            memory_order_relaxed,
+            memory_order_relaxed
+        );
+        if (isStored) {
+            break;
+        }
+    }
+}
+
+static void registerMutexProfileReport(void) {
+    atexit(reportMutexProfile);
+}
+
+/**
+ * Report the statistics of every lock, most waited for first, with a single write(2): to standard error, or appended
+ * to the file named by the MUTEX_PROFILE_FILE environment variable.
+ */
+static void reportMutexProfile(void) {
+    struct MutexProfileReport * const reports = safeMalloc(
+        (MUTEX_PROFILE_CAPACITY + 1) * sizeof *reports,
+        "reportMutexProfile"
+    );
+    size_t const reportCount = collectMutexProfileReports(reports);
+    qsort(reports, reportCount, sizeof *reports, compareMutexProfileReports);
+
+    size_t const reportCapacity = (reportCount + 2) * MUTEX_PROFILE_LINE_CAPACITY;
+    char * const report = safeMalloc(reportCapacity, "reportMutexProfile");
+    size_t reportLength = safeSnprintf(
+        report,
+        reportCapacity,
+        "reportMutexProfile",
+        "mutex profile: %zu locks\n  %-28s %12s %12s %7s %10s %12s %12s %10s %12s\n",
+        reportCount,
+        "lock",
+        "acquired",
+        "contended",
+        "%",
+        "wait s",
+        "mean wait us",
+        "max wait us",
+        "hold s",
+        "mean hold us"
+    );
+    for (size_t reportIndex = 0; reportIndex < reportCount; reportIndex += 1) {
+        struct MutexProfileReport const * const reportPtr = &reports[reportIndex];
+        double const acquisitionCount = (double)reportPtr->acquisitionCount;
+        double const contendedCount = (double)reportPtr->contendedCount;
+        double const waitNanoseconds = (double)reportPtr->waitNanoseconds;
+        double const holdNanoseconds = (double)reportPtr->holdNanoseconds;
+        reportLength += safeSnprintf(
+            report + reportLength,
+            reportCapacity - reportLength,
+            "reportMutexProfile",
+            "  %-28s %12llu %12llu %7.2f %10.3f %12.2f %12.2f %10.3f %12.2f\n",
+            reportPtr->callerDescription,
+            reportPtr->acquisitionCount,
+            reportPtr->contendedCount,
+            acquisitionCount > 0 ? contendedCount * 100 / acquisitionCount : 0,
+            waitNanoseconds / (double)NANOSECONDS_PER_SECOND,
+            contendedCount > 0 ? waitNanoseconds / 1000 / contendedCount : 0,
+            (double)reportPtr->maxWaitNanoseconds / 1000,
+            holdNanoseconds / (double)NANOSECONDS_PER_SECOND,
+            acquisitionCount > 0 ? holdNanoseconds / 1000 / acquisitionCount : 0
+        );
+    }
+
+    char const * const reportFilePath = getenv("MUTEX_PROFILE_FILE");
+    int const fileDescriptor = reportFilePath == NULL
+        ? STDERR_FILENO
+        : safeOpen(reportFilePath, O_WRONLY | O_CREAT | O_APPEND, "reportMutexProfile");
+    safeWrite(fileDescriptor, report, reportLength, "reportMutexProfile");
+    if (fileDescriptor != STDERR_FILENO) {
+        safeClose(fileDescriptor, "reportMutexProfile");
+    }
+    free(report);
+    free(reports);
+}
+
+/**
+ * Snapshot the table into reports, one per distinct callerDescription.
+ *
+ * @param reports Room for MUTEX_PROFILE_CAPACITY + 1 reports.
+ *
+ * @returns The number of reports.
+ */
+static size_t collectMutexProfileReports(struct MutexProfileReport * const reports) {
+    size_t reportCount = 0;
+    for (size_t entryIndex = 0; entryIndex < MUTEX_PROFILE_CAPACITY; entryIndex += 1) {
+        struct MutexProfileEntry * const entryPtr = &mutexProfileEntries[entryIndex];
+        char const * const callerDescription =
+            atomic_load_explicit(&entryPtr->callerDescription, memory_order_acquire);
+        if (callerDescription != NULL) {
+            mergeMutexProfileEntry(reports, &reportCount, entryPtr, callerDescription);
+        }
+    }
+    if (atomic_load_explicit(&mutexProfileOverflowEntry.acquisitionCount, memory_order_relaxed) > 0) {
+        mergeMutexProfileEntry(reports, &reportCount, &mutexProfileOverflowEntry, "(others)");
+    }
+    return reportCount;
+}
+
+/**
+ * Add an entry to the report with the same callerDescription text, or to a new report if there is none.
+ */
+static void mergeMutexProfileEntry(
+    struct MutexProfileReport * const reports,
+    size_t * const reportCountPtr,
+    struct MutexProfileEntry * const entryPtr,
+    char const * const callerDescription
+) {
+    struct MutexProfileReport *reportPtr = NULL;
+    for (size_t reportIndex = 0; reportIndex < *reportCountPtr; reportIndex += 1) {
+        if (strcmp(reports[reportIndex].callerDescription, callerDescription) == 0) {
+            reportPtr = &reports[reportIndex];
+            break;
+        }
+    }
+    if (reportPtr == NULL) {
+        reportPtr = &reports[*reportCountPtr];
+        *reportCountPtr += 1;
+        *reportPtr = (struct MutexProfileReport){ .callerDescription = callerDescription };
+    }
+
+    reportPtr->acquisitionCount += atomic_load_explicit(&entryPtr->acquisitionCount, memory_order_relaxed);
+    reportPtr->contendedCount += atomic_load_explicit(&entryPtr->contendedCount, memory_order_relaxed);
+    reportPtr->waitNanoseconds += atomic_load_explicit(&entryPtr->waitNanoseconds, memory_order_relaxed);
+    reportPtr->holdNanoseconds += atomic_load_explicit(&entryPtr->holdNanoseconds, memory_order_relaxed);
+    unsigned long long const maxWaitNanoseconds =
+        atomic_load_explicit(&entryPtr->maxWaitNanoseconds, memory_order_relaxed);
+    if (maxWaitNanoseconds > reportPtr->maxWaitNanoseconds) {
+        reportPtr->maxWaitNanoseconds = maxWaitNanoseconds;
+    }
+}
+
+/**
+ * Order reports by total wait time, then by total hold time, largest first.
+ */
+static int compareMutexProfileReports(void const * const leftPtr, void const * const rightPtr) {
+    struct MutexProfileReport const * const leftReportPtr = leftPtr;
+    struct MutexProfileReport const * const rightReportPtr = rightPtr;
+    if (leftReportPtr->waitNanoseconds != rightReportPtr->waitNanoseconds) {
+        return leftReportPtr->waitNanoseconds > rightReportPtr->waitNanoseconds ? -1 : 1;
+    }
+    if (leftReportPtr->holdNanoseconds != rightReportPtr->holdNanoseconds) {
+        return leftReportPtr->holdNanoseconds > rightReportPtr->holdNanoseconds ? -1 : 1;
+    }
+    return strcmp(leftReportPtr->callerDescription, rightReportPtr->callerDescription);
+}
+#endif